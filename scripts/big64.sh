@@ -0,0 +1,23 @@
+#!/bin/bash
+######################
+# The 64-bit executables on files of 64-bit integers, made by gen -H.
+# To add a technique, simply append the file name of your executable to the commands array below
+#######################
+DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+mkdir -p ${DIR}/../bigtmp64
+find ${DIR}/../bigtmp64 -size 0c -delete
+for (( index = 0; index < 100; index++ ))
+do
+  filename=${DIR}/../bigtmp64/bigtmp${index}.txt
+  if [ ! -f ${filename} ]
+  then
+    echo "creating file ${index}"
+    ${DIR}/../gen -N 1000000 -M 1000000000 -H 1024 > ${filename}
+  fi
+done
+declare -a commands=('stl_vector64_benchmarks' 'stl_hashset64_benchmarks' 'roaring64_benchmarks' 'roaring64_benchmarks -r' );
+echo "# For each data set, we print data size (in bits per value), successive intersections, successive unions and total unions [we compute the total  union first naively and then (if supported) using a heap-based approach], followed by quartile point queries (in cycles per input value), successive differences, successive symmetric differences, iterations through all values, then we have pairwise count aggregates for successive intersections, successive unions, successive differences, successive symmetric differences, and finally the construction of the bitmaps (in cycles per input value) "
+for t in "${commands[@]}"; do
+     echo "#" $t
+    ./$t bigtmp64;
+done
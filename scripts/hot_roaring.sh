@@ -7,7 +7,7 @@ for f in  census-income census-income_srt census1881  census1881_srt  weather_se
   for mode in intersection union difference symdifference wideunion wideunionheap intersectioncount unioncount differencecount symdifferencecount ; do
   for t in "${commands[@]}"; do
      echo "#" $t " -m " $mode "CRoaring/benchmarks/realdata/"$f
-    perf record -q ./$t -m $mode  CRoaring/benchmarks/realdata/$f;
+    perf record -q ./$t -b -m $mode  CRoaring/benchmarks/realdata/$f;
     perf report -F Overhead,Symbol |cat |grep -v '^#'|head -3
   done
   done
@@ -0,0 +1,152 @@
+#!/bin/bash
+######################
+# Compare the performance of a run against a stored baseline, e.g., before
+# and after updating the CRoaring or BitMagic submodule:
+#
+#   ./scripts/regression.sh record baseline      # runs the suite, stores results/baseline.csv
+#   (update a submodule, make)
+#   ./scripts/regression.sh compare baseline     # runs the suite again and compares
+#
+# Results are the CSV output (-o csv) of scripts/all.sh, run with repeated
+# measurements so that each metric comes with a confidence interval of its
+# median. A metric is reported as slower (or faster) when the confidence
+# intervals of the two runs do not overlap and the medians differ by more
+# than the threshold; the memory usage and the cardinalities have no
+# interval, so any change beyond the threshold (any change at all, for
+# cardinalities) is reported. Timings measured once, without samples (the
+# construction of the bitmaps), have no interval either: a change beyond
+# the threshold is shown as "slower?" or "faster?" but does not fail the
+# comparison, since a single measurement cannot establish it. A metric of the baseline that the new run
+# lacks (e.g., an executable crashed) is reported as missing. Metrics are
+# matched on the library, its flags, the dataset and the metric, leaving
+# out -n, -w and -b, which only change how the results were measured. The
+# script exits with status 1 if anything got slower, went missing or any
+# cardinality changed, so it can gate an upgrade.
+#######################
+DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+cd "$DIR/.."
+RESULTS=results
+REPETITIONS=15
+WARMUPS=2
+THRESHOLD=5
+
+usage() {
+  echo "usage: $0 [-n repetitions] [-w warmups] record NAME [FILE]"
+  echo "       $0 [-n repetitions] [-w warmups] [-t percent] compare BASELINE [NAME]"
+  echo "record runs the suite (or takes the CSV output in FILE) and stores it as $RESULTS/NAME.csv"
+  echo "compare checks NAME (or a new run) against BASELINE; -t sets the threshold (default $THRESHOLD%)"
+  exit 1
+}
+
+while getopts "n:w:t:h" opt; do
+  case $opt in
+    n) REPETITIONS=$OPTARG ;;
+    w) WARMUPS=$OPTARG ;;
+    t) THRESHOLD=$OPTARG ;;
+    *) usage ;;
+  esac
+done
+shift $((OPTIND - 1))
+[ $# -ge 2 ] || usage
+
+# run the suite, or copy the given file, into $RESULTS/$1.csv
+record() {
+  mkdir -p $RESULTS
+  if [ -n "$2" ]; then
+    cp "$2" $RESULTS/$1.csv || exit 1
+  else
+    ./scripts/all.sh csv -n $REPETITIONS -w $WARMUPS > $RESULTS/$1.csv
+  fi
+  git submodule status > $RESULTS/$1.revisions 2>/dev/null
+  echo "# stored $RESULTS/$1.csv"
+}
+
+case $1 in
+  record)
+    record "$2" "$3"
+    ;;
+  compare)
+    BASELINE=$RESULTS/$2.csv
+    [ -f $BASELINE ] || { echo "# no baseline $BASELINE"; exit 1; }
+    NAME=${3:-current}
+    [ -n "$3" ] || record $NAME
+    [ -f $RESULTS/$NAME.csv ] || { echo "# no results $RESULTS/$NAME.csv"; exit 1; }
+    if [ -f $RESULTS/$2.revisions ] && [ -f $RESULTS/$NAME.revisions ]; then
+      diff $RESULTS/$2.revisions $RESULTS/$NAME.revisions | sed -n 's/^[<>]/# &/p'
+    fi
+    awk -v threshold=$THRESHOLD '
+      # split a CSV line into f[1..n], honoring quoted fields
+      function split_csv(line, f,    n, i, c, field, quoted) {
+        n = 0; field = ""; quoted = 0
+        for (i = 1; i <= length(line); i++) {
+          c = substr(line, i, 1)
+          if (quoted) {
+            if (c == "\"") {
+              if (substr(line, i + 1, 1) == "\"") { field = field c; i++ } else quoted = 0
+            } else field = field c
+          } else if (c == "\"") quoted = 1
+          else if (c == ",") { f[++n] = field; field = "" }
+          else field = field c
+        }
+        f[++n] = field
+        return n
+      }
+      FNR == 1 { file++ }
+      /^library,/ { next }   # headers
+      {
+        split_csv($0, f)
+        dataset = f[3]; sub(/.*\//, "", dataset)
+        flags = " " f[2] " "  # without the repetition settings and the cache
+        gsub(/ -[nw] ?[0-9]+/, "", flags); gsub(/ -b /, " ", flags)
+        gsub(/^ +| +$/, "", flags)
+        key = f[1] (flags == "" ? "" : " " flags) SUBSEP dataset SUBSEP f[5]
+        sampled = (f[9] != "")
+        if (sampled) { value = f[10]; low = f[12]; high = f[13] }
+        else { value = f[7]; low = value; high = value }
+        if (file == 1) {
+          if (!(key in base)) order[++keys] = key
+          base[key] = value; baselow[key] = low; basehigh[key] = high
+          unit[key] = f[6]; basesampled[key] = sampled
+        } else if (key in base) {
+          new[key] = value; newlow[key] = low; newhigh[key] = high
+          newsampled[key] = sampled
+        }
+      }
+      END {
+        printf("# %-40s %-24s %-34s %14s %14s %9s\n", "library", "dataset",
+               "metric", "baseline", "new", "change")
+        bad = 0
+        for (k = 1; k <= keys; k++) {
+          key = order[k]
+          split(key, part, SUBSEP)
+          b = base[key]
+          if (!(key in new)) {
+            printf("  %-40s %-24s %-34s %14s %14s %9s %s\n", part[1], part[2],
+                   part[3], b, "-", "-", "MISSING")
+            bad = 1
+            continue
+          }
+          n = new[key]
+          change = (b > 0) ? 100.0 * (n - b) / b : 0
+          verdict = ""
+          if (unit[key] == "cardinality") {
+            if (n != b) { verdict = "MISMATCH"; bad = 1 }
+          } else if ((unit[key] !~ /^bits/) && !(basesampled[key] && newsampled[key])) {
+            # a single measurement: shown, never gated
+            if (change > threshold) verdict = "slower?"
+            else if (change < -threshold) verdict = "faster?"
+          } else if ((change > threshold) && (newlow[key] > basehigh[key])) {
+            verdict = (unit[key] ~ /^bits/) ? "LARGER" : "SLOWER"; bad = 1
+          } else if ((change < -threshold) && (newhigh[key] < baselow[key])) {
+            verdict = (unit[key] ~ /^bits/) ? "smaller" : "faster"
+          }
+          printf("  %-40s %-24s %-34s %14s %14s %8.1f%% %s\n", part[1], part[2],
+                 part[3], b, n, change, verdict)
+        }
+        exit bad
+      }' $BASELINE $RESULTS/$NAME.csv
+    ;;
+  *)
+    usage
+    ;;
+esac
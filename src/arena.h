@@ -0,0 +1,176 @@
+#ifndef INCLUDE_ARENA_H
+#define INCLUDE_ARENA_H
+
+/*
+ * A bump allocator for the temporary results of the benchmarks, enabled
+ * with the -A flag of roaring_benchmarks, bitmagic_benchmarks and
+ * stl_vector_benchmarks, to see how much of the cost of an operation is
+ * the system allocator.
+ *
+ * The phases that materialize results call arena_start and arena_stop
+ * and, between two operations, arena_reset. While the arena is active,
+ * allocations are carved out of large chunks and freeing them does
+ * nothing; arena_reset makes the whole arena available again, so every
+ * result must be dead by then. Blocks allocated elsewhere, such as the
+ * bitmaps themselves, go back to the system allocator. When the arena
+ * had to grow, arena_reset replaces its chunks by a single one, so that
+ * it stops allocating after the first operations. The total unions
+ * (phases 3 and 4) are single operations whose intermediate results stay
+ * in the arena until arena_stop: their first run includes the growth of
+ * the arena, later runs (see -w and -n) reuse it. The arena is not
+ * thread-safe: phases run on several threads leave it inactive.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_CHUNK_SIZE (1 << 20)
+#define ARENA_HEADER 16  // before each block: its size
+
+typedef struct arena_chunk_s {
+    struct arena_chunk_s *next;
+    size_t size;  // bytes of data, which start 64 bytes after the chunk
+    size_t used;
+} arena_chunk_t;
+
+static bool arena_enabled = false;  // set by -A
+static bool arena_active = false;
+static arena_chunk_t *arena_chunks = NULL;  // the current chunk first
+
+static inline char *arena_data(arena_chunk_t *c) { return (char *)c + 64; }
+
+static inline arena_chunk_t *arena_new_chunk(size_t size, arena_chunk_t *next) {
+    void *p = NULL;
+    if (posix_memalign(&p, 64, 64 + size) != 0) return NULL;
+    arena_chunk_t *c = (arena_chunk_t *)p;
+    c->next = next;
+    c->size = size;
+    c->used = 0;
+    return c;
+}
+
+static inline void *arena_alloc(size_t size, size_t alignment) {
+    if (alignment < ARENA_HEADER) alignment = ARENA_HEADER;
+    arena_chunk_t *c = arena_chunks;
+    uintptr_t p = 0;
+    if (c != NULL) {
+        const uintptr_t base = (uintptr_t)arena_data(c);
+        p = (base + c->used + ARENA_HEADER + alignment - 1) & ~(uintptr_t)(alignment - 1);
+        if (p + size > base + c->size) c = NULL;
+    }
+    if (c == NULL) {
+        size_t chunksize = arena_chunks != NULL ? 2 * arena_chunks->size : ARENA_CHUNK_SIZE;
+        while (chunksize < size + alignment + ARENA_HEADER) chunksize *= 2;
+        c = arena_new_chunk(chunksize, arena_chunks);
+        if (c == NULL) return NULL;
+        arena_chunks = c;
+        const uintptr_t base = (uintptr_t)arena_data(c);
+        p = (base + ARENA_HEADER + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    }
+    memcpy((char *)p - ARENA_HEADER, &size, sizeof(size));
+    c->used = p + size - (uintptr_t)arena_data(c);
+    return (void *)p;
+}
+
+static inline bool arena_owns(const void *p) {
+    for (arena_chunk_t *c = arena_chunks; c != NULL; c = c->next) {
+        if (((const char *)p >= arena_data(c)) && ((const char *)p < arena_data(c) + c->size)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline size_t arena_block_size(const void *p) {
+    size_t size;
+    memcpy(&size, (const char *)p - ARENA_HEADER, sizeof(size));
+    return size;
+}
+
+// the last block grows in place, others move
+static inline void *arena_realloc(void *p, size_t size) {
+    const size_t oldsize = arena_block_size(p);
+    arena_chunk_t *c = arena_chunks;
+    if ((char *)p + oldsize == arena_data(c) + c->used &&
+        (char *)p + size <= arena_data(c) + c->size) {
+        memcpy((char *)p - ARENA_HEADER, &size, sizeof(size));
+        c->used = (char *)p + size - arena_data(c);
+        return p;
+    }
+    void *answer = arena_alloc(size, ARENA_HEADER);
+    if (answer != NULL) memcpy(answer, p, oldsize < size ? oldsize : size);
+    return answer;
+}
+
+static inline void arena_reset(void) {
+    arena_chunk_t *c = arena_chunks;
+    if (c == NULL) return;
+    if (c->next != NULL) {
+        size_t total = 0;
+        while (c != NULL) {
+            arena_chunk_t *next = c->next;
+            total += c->size;
+            free(c);
+            c = next;
+        }
+        arena_chunks = arena_new_chunk(total, NULL);
+        return;
+    }
+    c->used = 0;
+}
+
+static inline void arena_start(void) { arena_active = arena_enabled; }
+
+static inline void arena_stop(void) {
+    arena_reset();
+    arena_active = false;
+}
+
+#ifdef __cplusplus
+#include <memory>
+
+/*
+ * An STL allocator taking its memory from the arena while it is active,
+ * and from Base otherwise.
+ */
+template <class T, class Base = std::allocator<T> >
+class ArenaAllocator {
+public:
+    typedef T value_type;
+
+    template <class U> struct rebind {
+        typedef ArenaAllocator<U, typename std::allocator_traits<Base>::template rebind_alloc<U> > other;
+    };
+
+    ArenaAllocator() : base() {}
+    template <class U, class B>
+    ArenaAllocator(const ArenaAllocator<U, B> &) : base() {}
+
+    T *allocate(std::size_t num) {
+        if (arena_active) return (T *)arena_alloc(num * sizeof(T), alignof(T));
+        return std::allocator_traits<Base>::allocate(base, num);
+    }
+
+    void deallocate(T *p, std::size_t num) {
+        if (arena_owns(p)) return;
+        std::allocator_traits<Base>::deallocate(base, p, num);
+    }
+
+    Base base;
+};
+
+template <class T1, class B1, class T2, class B2>
+bool operator==(const ArenaAllocator<T1, B1> &, const ArenaAllocator<T2, B2> &) {
+    return true;
+}
+
+template <class T1, class B1, class T2, class B2>
+bool operator!=(const ArenaAllocator<T1, B1> &, const ArenaAllocator<T2, B2> &) {
+    return false;
+}
+#endif
+
+#endif
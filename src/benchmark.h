@@ -2,8 +2,81 @@
 #ifndef BENCHMARKS_INCLUDE_BENCHMARK_H_
 #define BENCHMARKS_INCLUDE_BENCHMARK_H_
 
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
 const int quartile_test_repetitions = 10;
 
+/*
+ * The measured phases of the benchmark executables. Phase k, for
+ * 0 < k < 13, is reported in column k (data[k]); column 0 reports the
+ * memory usage of the bitmaps. Phase 0, the construction of the bitmaps,
+ * is column 13, and phase 13, the parallel union of roaring_benchmarks -t,
+ * an optional column 14 (see column_phase). Phases 14 to 16 are the
+ * serialization phases (-s), phases 17 to 22 the queries over a mapped
+ * file (-m), phases 23 and 24 the many-way intersections (-k), phases 25
+ * to 27 the threshold queries (-T), phases 28 to 30 the range queries
+ * (-R), phases 31 and 32 the rank and select queries (-q) and phases 33
+ * to 37 the updates (-u), reported apart from the columns (see
+ * serialization_report, mapped_report, wide_and_report, threshold_report,
+ * range_report, rank_select_report and mutation_report).
+ */
+#define BENCHMARK_PHASES 38
+
+static const char *phase_names[BENCHMARK_PHASES] = {
+    "construction",          "successive intersections",
+    "successive unions",     "total union (naive)",
+    "total union (heap)",    "quartile queries",
+    "successive differences", "successive symmetric differences",
+    "iteration",             "intersection counts",
+    "union counts",          "difference counts",
+    "symmetric difference counts", "total union (parallel)",
+    "serialization",         "deserialization",
+    "frozen view",
+    "mapped successive intersections (cold)", "mapped union counts (cold)",
+    "mapped quartile queries (cold)",
+    "mapped successive intersections (warm)", "mapped union counts (warm)",
+    "mapped quartile queries (warm)",
+    "k-way intersections",   "total intersection",
+    "threshold (T=2)",       "threshold (T=N/2)",
+    "threshold (T=N-1)",     "range counts",
+    "range tests",           "range extraction",
+    "rank queries",          "select queries",
+    "sorted inserts",        "random inserts",
+    "bulk inserts",          "random removals",
+    "optimization after updates"};
+
+#define PHASE_SERIALIZATION 14
+#define PHASE_DESERIALIZATION 15
+#define PHASE_FROZEN_VIEW 16
+#define PHASE_MAPPED_COLD 17  // then union counts and quartile queries
+#define PHASE_MAPPED_WARM 20
+#define MAPPED_QUERIES 3
+#define PHASE_WIDE_AND 23
+#define PHASE_TOTAL_AND 24
+#define PHASE_THRESHOLD 25
+#define THRESHOLD_QUERIES 3
+#define PHASE_RANGE 28
+#define RANGE_QUERIES 3
+#define PHASE_RANK 31
+#define PHASE_SELECT 32
+#define PHASE_MUTATION 33
+#define MUTATION_PHASES 5
+
+// the output format (-o), see benchmark_report
+enum { REPORT_TEXT, REPORT_JSON, REPORT_CSV };
+
+static int report_format = REPORT_TEXT;
+
 
 #define RDTSC_START(cycles)                                                   \
     do {                                                                      \
@@ -46,6 +119,939 @@ const int quartile_test_repetitions = 10;
    outputvar = min_diff;\
    }
 
+/*
+ * Hardware performance counters (Linux perf_event_open), enabled with the
+ * -p flag of the benchmark executables. For each phase we record cycles,
+ * instructions, branch misses, L1 data cache read misses and last-level
+ * cache misses, so that a slow phase can be attributed to the memory
+ * hierarchy or to branch prediction.
+ */
+enum {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_BRANCH_MISSES,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_EVENTS
+};
+
+static const char *perf_event_names[PERF_EVENTS] = {
+    "cycles", "instructions", "branch-misses", "L1D-misses", "LLC-misses"};
+
+static bool perf_counters_enabled = false;
+static int perf_fds[PERF_EVENTS] = {-1, -1, -1, -1, -1};
+static uint64_t perf_phase_counts[BENCHMARK_PHASES][PERF_EVENTS];
+static bool perf_phase_measured[BENCHMARK_PHASES];
+
+/*
+ * Open the counters as one group led by the cycle counter, so that they
+ * are scheduled together. Events the processor does not support are left
+ * out. Returns false (and prints why on stderr, away from the results)
+ * if no counter could be opened.
+ */
+static inline bool perf_counters_init(void) {
+#ifdef __linux__
+    const uint32_t types[PERF_EVENTS] = {
+        PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+        PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE};
+    const uint64_t configs[PERF_EVENTS] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_BRANCH_MISSES,
+        PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+            (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+        PERF_COUNT_HW_CACHE_MISSES};
+    for (int e = 0; e < PERF_EVENTS; e++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = types[e];
+        attr.config = configs[e];
+        attr.disabled = (perf_fds[PERF_CYCLES] < 0);  // only the leader
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID;
+        int fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1,
+                              perf_fds[PERF_CYCLES], 0);
+        if ((e == PERF_CYCLES) && (fd < 0)) {
+            fprintf(stderr, "# hardware counters are unavailable (see "
+                            "/proc/sys/kernel/perf_event_paranoid)\n");
+            return false;
+        }
+        perf_fds[e] = fd;
+    }
+    memset(perf_phase_counts, 0, sizeof(perf_phase_counts));
+    memset(perf_phase_measured, 0, sizeof(perf_phase_measured));
+    return true;
+#else
+    fprintf(stderr, "# hardware counters are only supported under Linux\n");
+    return false;
+#endif
+}
+
+static inline void perf_counters_start(void) {
+#ifdef __linux__
+    if (!perf_counters_enabled) return;
+    ioctl(perf_fds[PERF_CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(perf_fds[PERF_CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+
+/*
+ * Stop the counters and attribute their values to the given phase,
+ * averaged over the number of repetitions the phase went through.
+ */
+static inline void perf_counters_stop(int phase, int repetitions) {
+#ifdef __linux__
+    if (!perf_counters_enabled) return;
+    ioctl(perf_fds[PERF_CYCLES], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    uint64_t buffer[1 + 2 * PERF_EVENTS];
+    if (read(perf_fds[PERF_CYCLES], buffer, sizeof(buffer)) <= 0) return;
+    uint64_t ids[PERF_EVENTS];
+    for (int e = 0; e < PERF_EVENTS; e++) {
+        ids[e] = (uint64_t)-1;
+        if (perf_fds[e] >= 0) ioctl(perf_fds[e], PERF_EVENT_IOC_ID, &ids[e]);
+    }
+    for (uint64_t i = 0; i < buffer[0]; i++) {
+        uint64_t value = buffer[1 + 2 * i];
+        uint64_t id = buffer[2 + 2 * i];
+        for (int e = 0; e < PERF_EVENTS; e++) {
+            if ((perf_fds[e] >= 0) && (ids[e] == id)) {
+                perf_phase_counts[phase][e] = value / (uint64_t)repetitions;
+            }
+        }
+    }
+    perf_phase_measured[phase] = true;
+#else
+    (void)phase;
+    (void)repetitions;
+#endif
+}
+
+/*
+ * Print the counters of every measured phase, as '#' comments.
+ */
+static inline void perf_counters_print(void) {
+    if (!perf_counters_enabled || (report_format != REPORT_TEXT)) return;
+    printf("# %-34s", "phase");
+    for (int e = 0; e < PERF_EVENTS; e++) printf(" %16s", perf_event_names[e]);
+    printf(" %8s\n", "IPC");
+    for (int p = 0; p < BENCHMARK_PHASES; p++) {
+        if (!perf_phase_measured[p]) continue;
+        printf("# %-34s", phase_names[p]);
+        for (int e = 0; e < PERF_EVENTS; e++) {
+            if (perf_fds[e] >= 0) {
+                printf(" %16llu", (unsigned long long)perf_phase_counts[p][e]);
+            } else {
+                printf(" %16s", "n/a");
+            }
+        }
+        uint64_t cycles = perf_phase_counts[p][PERF_CYCLES];
+        printf(" %8.2f\n",
+               cycles > 0 ? perf_phase_counts[p][PERF_INSTRUCTIONS] * 1.0 / cycles
+                          : 0.0);
+    }
+}
+
+/*
+ * Allocation counters, when the executable counts its allocations:
+ * cmemcounter.h, included before this header, defines MALLOC_COUNTERS.
+ * For each phase we record the allocations and the bytes they requested,
+ * per repetition, and the peak memory usage above the usage at the start
+ * of the phase, so that allocation churn can be told apart from compute.
+ */
+typedef struct alloc_phase_counts_s {
+    bool measured;
+    uint64_t allocations;
+    uint64_t bytes;
+    uint64_t peak;
+} alloc_phase_counts_t;
+
+static alloc_phase_counts_t alloc_phase_counts[BENCHMARK_PHASES];
+
+#ifdef MALLOC_COUNTERS
+static memcounters_t alloc_start;
+
+static inline void alloc_counters_start(void) {
+    memcounters_reset_peak();
+    alloc_start = memcounters_read();
+}
+
+static inline void alloc_counters_stop(int phase, int repetitions) {
+    const memcounters_t end = memcounters_read();
+    alloc_phase_counts_t *a = &alloc_phase_counts[phase];
+    a->allocations = (end.allocations - alloc_start.allocations) / (uint64_t)repetitions;
+    a->bytes = (end.bytes - alloc_start.bytes) / (uint64_t)repetitions;
+    a->peak = (uint64_t)(end.peak - alloc_start.usage);
+    a->measured = true;
+}
+#else
+static inline void alloc_counters_start(void) {}
+
+static inline void alloc_counters_stop(int phase, int repetitions) {
+    (void)phase;
+    (void)repetitions;
+}
+#endif
+
+/*
+ * The operations of a phase, to report allocations per operation: the
+ * bitmaps built, the pairs of the successive phases, or else one run.
+ */
+static inline uint64_t alloc_phase_operations(int phase, size_t count) {
+    switch (phase) {
+        case 0:
+            return count;
+        case 1:
+        case 2:
+        case 6:
+        case 7:
+        case 9:
+        case 10:
+        case 11:
+        case 12:
+            return count > 1 ? count - 1 : 1;
+        default:
+            return 1;
+    }
+}
+
+/*
+ * Print the allocations of every measured phase, as '#' comments.
+ */
+static inline void alloc_counters_print(size_t count) {
+    if (report_format != REPORT_TEXT) return;
+    bool header = false;
+    for (int p = 0; p < BENCHMARK_PHASES; p++) {
+        const alloc_phase_counts_t *a = &alloc_phase_counts[p];
+        if (!a->measured) continue;
+        if (!header) {
+            printf("# %-34s %14s %14s %14s %14s\n", "phase (allocations)",
+                   "mallocs", "bytes", "peak bytes", "mallocs/op");
+            header = true;
+        }
+        printf("# %-34s %14llu %14llu %14llu %14.2f\n", phase_names[p],
+               (unsigned long long)a->allocations, (unsigned long long)a->bytes,
+               (unsigned long long)a->peak,
+               a->allocations * 1.0 / alloc_phase_operations(p, count));
+    }
+}
+
+/*
+ * Repeated measurements, set with the -n (repetitions) and -w (warmup)
+ * flags of the benchmark executables. By default every phase is timed
+ * once. With more repetitions, each phase keeps all of its samples and
+ * phase_stats_print reports their minimum, median, 95th percentile and a
+ * 95% confidence interval for the median; the result columns keep
+ * reporting the minimum.
+ */
+static int benchmark_repetitions = 1;
+static int benchmark_warmups = 0;
+
+typedef struct phase_stats_s {
+    bool measured;
+    int samples;
+    uint64_t min;
+    uint64_t median;
+    uint64_t p95;
+    uint64_t ci_low;
+    uint64_t ci_high;
+} phase_stats_t;
+
+static phase_stats_t phase_stats[BENCHMARK_PHASES];
+
+static inline int phase_sample_compare(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static inline int phase_isqrt(int x) {
+    int r = 0;
+    while ((r + 1) * (r + 1) <= x) r++;
+    return r;
+}
+
+/*
+ * Summarize the samples of a phase (sorting them in place). The
+ * confidence interval of the median is distribution-free: its bounds are
+ * the order statistics of rank n/2 -+ 0.98 sqrt(n) (Le Boudec,
+ * "Performance Evaluation of Computer and Communication Systems", 2.2),
+ * rounded outwards; with few samples it degenerates to [min, max].
+ */
+static inline void phase_stats_record(int phase, uint64_t *samples,
+                                      int howmany) {
+    qsort(samples, (size_t)howmany, sizeof(uint64_t), phase_sample_compare);
+    phase_stats_t *st = &phase_stats[phase];
+    st->measured = true;
+    st->samples = howmany;
+    st->min = samples[0];
+    st->median = (howmany % 2 == 1)
+                     ? samples[howmany / 2]
+                     : (samples[howmany / 2 - 1] + samples[howmany / 2]) / 2;
+    st->p95 = samples[(95 * howmany + 99) / 100 - 1];
+    int halfwidth = phase_isqrt((9604 * howmany + 9999) / 10000) + 1;
+    int low = howmany / 2 - halfwidth;
+    int high = (howmany + 1) / 2 + halfwidth + 1;
+    if (low < 1) low = 1;
+    if (high > howmany) high = howmany;
+    st->ci_low = samples[low - 1];
+    st->ci_high = samples[high - 1];
+}
+
+/*
+ * Print the statistics of every phase that was measured more than once,
+ * in cycles, as '#' comments, when repetitions were requested with -n.
+ */
+static inline void phase_stats_print(void) {
+    if ((benchmark_repetitions < 2) || (report_format != REPORT_TEXT)) return;
+    bool header = false;
+    for (int p = 0; p < BENCHMARK_PHASES; p++) {
+        const phase_stats_t *st = &phase_stats[p];
+        if (!st->measured || (st->samples < 2)) continue;
+        if (!header) {
+            printf("# %-34s %8s %14s %14s %14s %31s\n", "phase (cycles)",
+                   "samples", "min", "median", "p95", "95% CI of median");
+            header = true;
+        }
+        printf("# %-34s %8d %14llu %14llu %14llu  [%13llu, %13llu]\n",
+               phase_names[p], st->samples, (unsigned long long)st->min,
+               (unsigned long long)st->median, (unsigned long long)st->p95,
+               (unsigned long long)st->ci_low, (unsigned long long)st->ci_high);
+    }
+}
+
+/*
+ * Result output, chosen with the -o flag of the benchmark executables: the
+ * default row of %20.2f columns ("text"), one JSON object per line
+ * ("json"), or CSV with one row per metric ("csv"). The structured formats
+ * name every metric, give the raw cycles (bytes for the memory usage)
+ * next to the normalized value, the cardinalities that the executables
+ * check, and, when measured, the statistics of -n and the counters of -p.
+ * In those formats, the '#' comments are left out.
+ */
+static char report_flags[256];
+static bool report_csv_header_printed = false;
+
+#define REPORT_CHECKS 7
+
+static const char *report_check_names[REPORT_CHECKS] = {
+    "successive_and", "successive_or",  "total_or",   "quartcount",
+    "successive_andnot", "successive_xor", "total_count"};
+
+static uint64_t report_check_values[REPORT_CHECKS];
+static bool report_checks_recorded = false;
+
+static inline bool report_set_format(const char *name) {
+    if (strcmp(name, "text") == 0) {
+        report_format = REPORT_TEXT;
+    } else if (strcmp(name, "json") == 0) {
+        report_format = REPORT_JSON;
+    } else if (strcmp(name, "csv") == 0) {
+        report_format = REPORT_CSV;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// the library is named after the executable
+static inline const char *report_basename(const char *path) {
+    const char *slash = strrchr(path, '/');
+    return slash != NULL ? slash + 1 : path;
+}
+
+/*
+ * Keep the flags that precede the first operand (getopt moves the
+ * operands last), except -o, so that results can be told apart.
+ */
+static inline void report_record_flags(int argc, char **argv, int operand) {
+    size_t length = 0;
+    report_flags[0] = '\0';
+    for (int i = 1; (i < operand) && (i < argc); i++) {
+        if (strncmp(argv[i], "-o", 2) == 0) {
+            if (argv[i][2] == '\0') i++;  // the format is the next argument
+            continue;
+        }
+        int written = snprintf(report_flags + length,
+                               sizeof(report_flags) - length, "%s%s",
+                               length > 0 ? " " : "", argv[i]);
+        if ((written < 0) || ((size_t)written >= sizeof(report_flags) - length))
+            break;
+        length += (size_t)written;
+    }
+}
+
+/*
+ * The cardinalities computed by the phases, as a check that every library
+ * computed the same thing.
+ */
+static inline void report_cardinalities(uint64_t successive_and,
+                                        uint64_t successive_or,
+                                        uint64_t total_or, uint64_t quartcount,
+                                        uint64_t successive_andnot,
+                                        uint64_t successive_xor,
+                                        uint64_t total_count) {
+    report_check_values[0] = successive_and;
+    report_check_values[1] = successive_or;
+    report_check_values[2] = total_or;
+    report_check_values[3] = quartcount;
+    report_check_values[4] = successive_andnot;
+    report_check_values[5] = successive_xor;
+    report_check_values[6] = total_count;
+    report_checks_recorded = true;
+}
+
+/*
+ * Serialization (-s): the executables that support it serialize all
+ * bitmaps into one buffer (phase 14), deserialize them all (phase 15) and,
+ * if the library has a format that can be used in place, make a read-only
+ * view of each serialized bitmap (phase 16). The sizes are in bytes, for
+ * all bitmaps; benchmark_report prints them in bits per value and the
+ * phases in cycles per value.
+ */
+typedef struct serialization_results_s {
+    bool measured;
+    uint64_t bytes;
+    uint64_t cycles[2];  // serialization, deserialization
+    bool frozen;         // whether there is a frozen format
+    uint64_t frozen_bytes;
+    uint64_t frozen_cycles;
+} serialization_results_t;
+
+static serialization_results_t serialization_report;
+
+/*
+ * Queries over a mapped file of serialized bitmaps (-m, see mappedstore.h):
+ * successive intersections, union counts and quartile queries, normalized
+ * as columns 1, 10 and 5. Each is measured once cold, including the
+ * mapping of the file, and then warm, over a mapping whose pages are
+ * already in memory.
+ */
+typedef struct mapped_results_s {
+    bool measured;
+    uint64_t bytes;                    // of the file
+    uint64_t cycles[2][MAPPED_QUERIES];  // cold, warm
+} mapped_results_t;
+
+static mapped_results_t mapped_report;
+
+static const int mapped_query_columns[MAPPED_QUERIES] = {1, 10, 5};
+
+/*
+ * Many-way intersections (-k of unified_benchmarks): the intersection of
+ * every window of k successive bitmaps (phase 23), and of all bitmaps
+ * (phase 24), in cycles per input value, counting the values of every
+ * bitmap of every window.
+ */
+typedef struct wide_and_results_s {
+    bool measured;
+    int k;
+    uint64_t cycles[2];       // windows, all bitmaps
+    uint64_t inputcard[2];    // values in the inputs
+    uint64_t cardinality[2];  // of the results (summed over the windows)
+} wide_and_results_t;
+
+static wide_and_results_t wide_and_report;
+
+/*
+ * Threshold queries (-T of unified_benchmarks): for every window of N
+ * successive bitmaps, the values in at least T of them, for T = 2, N/2
+ * (rounded up) and N - 1 (phases 25 to 27), in cycles per input value.
+ */
+typedef struct threshold_results_s {
+    bool measured;
+    int n;
+    int t[THRESHOLD_QUERIES];
+    uint64_t cycles[THRESHOLD_QUERIES];
+    uint64_t inputcard;                       // values in the windows
+    uint64_t cardinality[THRESHOLD_QUERIES];  // summed over the windows
+} threshold_results_t;
+
+static threshold_results_t threshold_report;
+
+/*
+ * Range queries (-R of unified_benchmarks) over random ranges [a, b) of
+ * widths from 1 to the largest value: the number of values in the range,
+ * whether there is any, and the values themselves (phases 28 to 30), in
+ * cycles per query.
+ */
+typedef struct range_results_s {
+    bool measured;
+    uint64_t queries;
+    uint64_t cycles[RANGE_QUERIES];
+    uint64_t results[RANGE_QUERIES];  // values counted, ranges hit, values extracted
+} range_results_t;
+
+static range_results_t range_report;
+
+/*
+ * Rank and select queries (-q of unified_benchmarks): the number of values
+ * at most x, and the value of rank i, for random x and i (phases 31 and
+ * 32), in cycles per query. The indexes that some backends build for them
+ * are counted in column 0 as well as in indexbytes.
+ */
+typedef struct rank_select_results_s {
+    bool measured;
+    uint64_t queries;
+    uint64_t cycles[2];
+    uint64_t indexbytes;
+} rank_select_results_t;
+
+static rank_select_results_t rank_select_report;
+
+/*
+ * Updates (-u of unified_benchmarks): batches of random values inserted one
+ * at a time in increasing order, then in random order, then all at once,
+ * then removals, followed by the optimization of the library (phases 33 to
+ * 37), in cycles per update (the optimization is amortized over all the
+ * updates). bytes and cardinality describe the bitmaps afterwards.
+ */
+typedef struct mutation_results_s {
+    bool measured;
+    uint64_t updates;  // per batch
+    uint64_t cycles[MUTATION_PHASES];
+    uint64_t bytes;
+    uint64_t cardinality;
+} mutation_results_t;
+
+static mutation_results_t mutation_report;
+
+/*
+ * The phase reported in a column, or -1 for the memory usage.
+ */
+static inline int column_phase(int column) {
+    switch (column) {
+        case 0:
+            return -1;
+        case 13:
+            return 0;
+        case 14:
+            return 13;
+        default:
+            return column;
+    }
+}
+
+/*
+ * Column 0 is in bits per value, column 5 in cycles per query and the
+ * others in cycles per input value (of a pair, for the pairwise phases).
+ */
+static inline double report_normalize(int column, uint64_t value, size_t count,
+                                      uint64_t totalcard,
+                                      uint64_t successivecard) {
+    switch (column) {
+        case 0:
+            return value * 8.0 / totalcard;
+        case 3:
+        case 4:
+        case 8:
+        case 13:
+        case 14:
+            return value * 1.0 / totalcard;
+        case 5:
+            return value * 1.0 / (3 * count);
+        default:
+            return value * 1.0 / successivecard;
+    }
+}
+
+static inline const char *report_unit(int column) {
+    if (column == 0) return "bits per value";
+    if (column == 5) return "cycles per query";
+    return "cycles per value";
+}
+
+static inline void report_json_string(const char *s) {
+    putchar('"');
+    for (; *s != '\0'; s++) {
+        if ((*s == '"') || (*s == '\\')) {
+            printf("\\%c", *s);
+        } else if ((unsigned char)*s < 0x20) {
+            printf("\\u%04x", (unsigned char)*s);
+        } else {
+            putchar(*s);
+        }
+    }
+    putchar('"');
+}
+
+static inline void report_json_number(double x) {
+    if ((x == x) && (x - x == 0)) {
+        printf("%.4f", x);
+    } else {
+        printf("null");  // not finite, e.g. on an empty data set
+    }
+}
+
+static inline void report_csv_string(const char *s) {
+    putchar('"');
+    for (; *s != '\0'; s++) {
+        if (*s == '"') putchar('"');
+        putchar(*s);
+    }
+    putchar('"');
+}
+
+/*
+ * One metric: phase is the phase whose statistics and counters go with it,
+ * or -1.
+ */
+static inline void report_metric(const char *library, const char *dataset,
+                                 int column, const char *metric,
+                                 const char *unit, uint64_t raw,
+                                 double normalized, int phase, bool first) {
+    const phase_stats_t *st =
+        ((phase >= 0) && phase_stats[phase].measured &&
+         (phase_stats[phase].samples > 1))
+            ? &phase_stats[phase]
+            : NULL;
+    if (report_format == REPORT_CSV) {
+        report_csv_string(library);
+        putchar(',');
+        report_csv_string(report_flags);
+        putchar(',');
+        report_csv_string(dataset);
+        if (column >= 0) {
+            printf(",%d,", column);
+        } else {
+            printf(",,");
+        }
+        report_csv_string(metric);
+        putchar(',');
+        report_csv_string(unit);
+        printf(",%llu,%.4f", (unsigned long long)raw, normalized);
+        if (st != NULL) {
+            printf(",%d,%llu,%llu,%llu,%llu\n", st->samples,
+                   (unsigned long long)st->median, (unsigned long long)st->p95,
+                   (unsigned long long)st->ci_low, (unsigned long long)st->ci_high);
+        } else {
+            printf(",,,,,\n");
+        }
+        return;
+    }
+    printf("%s{\"metric\":", first ? "" : ",");
+    report_json_string(metric);
+    if (column >= 0) printf(",\"column\":%d", column);
+    printf(",\"unit\":");
+    report_json_string(unit);
+    printf(",\"raw\":%llu,\"normalized\":", (unsigned long long)raw);
+    report_json_number(normalized);
+    if (st != NULL) {
+        printf(",\"samples\":%d,\"min\":%llu,\"median\":%llu,\"p95\":%llu,"
+               "\"median_ci\":[%llu,%llu]",
+               st->samples, (unsigned long long)st->min,
+               (unsigned long long)st->median, (unsigned long long)st->p95,
+               (unsigned long long)st->ci_low, (unsigned long long)st->ci_high);
+    }
+    if ((phase >= 0) && perf_counters_enabled && perf_phase_measured[phase]) {
+        printf(",\"counters\":{");
+        bool firstcounter = true;
+        for (int e = 0; e < PERF_EVENTS; e++) {
+            if (perf_fds[e] < 0) continue;
+            printf("%s\"%s\":%llu", firstcounter ? "" : ",", perf_event_names[e],
+                   (unsigned long long)perf_phase_counts[phase][e]);
+            firstcounter = false;
+        }
+        printf("}");
+    }
+    if ((phase >= 0) && alloc_phase_counts[phase].measured) {
+        const alloc_phase_counts_t *a = &alloc_phase_counts[phase];
+        printf(",\"allocations\":{\"mallocs\":%llu,\"bytes\":%llu,\"peak\":%llu}",
+               (unsigned long long)a->allocations, (unsigned long long)a->bytes,
+               (unsigned long long)a->peak);
+    }
+    printf("}");
+}
+
+/*
+ * Report the results of one run: data[0] is the memory usage in bytes and
+ * data[k], for 0 < k < columns, the cycles of phase column_phase(k).
+ */
+static inline void benchmark_report(const char *library, const char *dataset,
+                                    const uint64_t *data, int columns,
+                                    size_t count, uint64_t totalcard,
+                                    uint64_t successivecard) {
+    if (report_format == REPORT_TEXT) {
+        double r[BENCHMARK_PHASES];
+        for (int k = 0; k < columns; k++) {
+            r[k] = report_normalize(k, data[k], count, totalcard, successivecard);
+        }
+        printf(" %20.2f %20.2f %20.2f %20.2f %20.2f %20.2f  %20.2f  %20.2f     %20.2f    %20.2f  %20.2f  %20.2f  %20.2f",
+               r[0], r[1], r[2], r[3], r[4], r[5], r[6], r[7], r[8], r[9],
+               r[10], r[11], r[12]);
+        for (int k = 13; k < columns; k++) printf(" %20.2f", r[k]);
+        printf("\n");
+        if (serialization_report.measured) {
+            printf("# serialized size %.2f bits/value, serialization %.2f cycles/value, "
+                   "deserialization %.2f cycles/value\n",
+                   serialization_report.bytes * 8.0 / totalcard,
+                   serialization_report.cycles[0] * 1.0 / totalcard,
+                   serialization_report.cycles[1] * 1.0 / totalcard);
+            if (serialization_report.frozen) {
+                printf("# frozen size %.2f bits/value, frozen view %.2f cycles/value\n",
+                       serialization_report.frozen_bytes * 8.0 / totalcard,
+                       serialization_report.frozen_cycles * 1.0 / totalcard);
+            }
+        }
+        if (mapped_report.measured) {
+            printf("# mapped file %.2f bits/value\n", mapped_report.bytes * 8.0 / totalcard);
+            for (int w = 0; w < 2; w++) {
+                printf("# %s", w == 0 ? "cold" : "warm");
+                for (int q = 0; q < MAPPED_QUERIES; q++) {
+                    const int column = mapped_query_columns[q];
+                    printf("%s %s %.2f %s", q == 0 ? ":" : ",",
+                           phase_names[column],
+                           report_normalize(column, mapped_report.cycles[w][q],
+                                            count, totalcard, successivecard),
+                           report_unit(column));
+                }
+                printf("\n");
+            }
+        }
+        if (wide_and_report.measured) {
+            printf("# %d-way intersections %.2f cycles/value, total intersection %.2f cycles/value\n",
+                   wide_and_report.k,
+                   wide_and_report.cycles[0] * 1.0 / wide_and_report.inputcard[0],
+                   wide_and_report.cycles[1] * 1.0 / wide_and_report.inputcard[1]);
+        }
+        if (threshold_report.measured) {
+            printf("# threshold queries over %d bitmaps:", threshold_report.n);
+            for (int q = 0; q < THRESHOLD_QUERIES; q++) {
+                printf("%s T=%d %.2f cycles/value", q == 0 ? "" : ",", threshold_report.t[q],
+                       threshold_report.cycles[q] * 1.0 / threshold_report.inputcard);
+            }
+            printf("\n");
+        }
+        if (range_report.measured) {
+            printf("# %llu range queries: counts %.2f, tests %.2f, extraction %.2f cycles/query\n",
+                   (unsigned long long)range_report.queries,
+                   range_report.cycles[0] * 1.0 / range_report.queries,
+                   range_report.cycles[1] * 1.0 / range_report.queries,
+                   range_report.cycles[2] * 1.0 / range_report.queries);
+        }
+        if (rank_select_report.measured) {
+            printf("# %llu rank and select queries: rank %.2f, select %.2f cycles/query, index %.2f bits/value\n",
+                   (unsigned long long)rank_select_report.queries,
+                   rank_select_report.cycles[0] * 1.0 / rank_select_report.queries,
+                   rank_select_report.cycles[1] * 1.0 / rank_select_report.queries,
+                   rank_select_report.indexbytes * 8.0 / totalcard);
+        }
+        if (mutation_report.measured) {
+            printf("# %llu updates per batch:", (unsigned long long)mutation_report.updates);
+            for (int q = 0; q < MUTATION_PHASES; q++) {
+                const uint64_t updates = mutation_report.updates * (q == MUTATION_PHASES - 1 ? MUTATION_PHASES - 1 : 1);
+                printf("%s %s %.2f", q == 0 ? "" : ",", phase_names[PHASE_MUTATION + q],
+                       mutation_report.cycles[q] * 1.0 / updates);
+            }
+            printf(" cycles/update, then %.2f bits/value\n",
+                   mutation_report.bytes * 8.0 / mutation_report.cardinality);
+        }
+        report_checks_recorded = false;
+        serialization_report.measured = false;
+        mapped_report.measured = false;
+        wide_and_report.measured = false;
+        threshold_report.measured = false;
+        range_report.measured = false;
+        rank_select_report.measured = false;
+        mutation_report.measured = false;
+        return;
+    }
+    if (report_format == REPORT_CSV) {
+        if (!report_csv_header_printed) {
+            printf("library,flags,dataset,column,metric,unit,raw,normalized,"
+                   "samples,median,p95,median_ci_low,median_ci_high\n");
+            report_csv_header_printed = true;
+        }
+    } else {
+        printf("{\"library\":");
+        report_json_string(library);
+        printf(",\"flags\":");
+        report_json_string(report_flags);
+        printf(",\"dataset\":");
+        report_json_string(dataset);
+        printf(",\"bitmaps\":%llu,\"values\":%llu,\"metrics\":[",
+               (unsigned long long)count, (unsigned long long)totalcard);
+    }
+    for (int k = 0; k < columns; k++) {
+        const int phase = column_phase(k);
+        report_metric(library, dataset, k, phase < 0 ? "memory usage" : phase_names[phase],
+                      report_unit(k), data[k],
+                      report_normalize(k, data[k], count, totalcard, successivecard),
+                      phase, k == 0);
+    }
+    if (serialization_report.measured) {
+        const serialization_results_t *sr = &serialization_report;
+        report_metric(library, dataset, -1, "serialized size", "bits per value",
+                      sr->bytes, sr->bytes * 8.0 / totalcard, -1, false);
+        report_metric(library, dataset, -1, phase_names[PHASE_SERIALIZATION],
+                      "cycles per value", sr->cycles[0],
+                      sr->cycles[0] * 1.0 / totalcard, PHASE_SERIALIZATION, false);
+        report_metric(library, dataset, -1, phase_names[PHASE_DESERIALIZATION],
+                      "cycles per value", sr->cycles[1],
+                      sr->cycles[1] * 1.0 / totalcard, PHASE_DESERIALIZATION, false);
+        if (sr->frozen) {
+            report_metric(library, dataset, -1, "frozen size", "bits per value",
+                          sr->frozen_bytes, sr->frozen_bytes * 8.0 / totalcard,
+                          -1, false);
+            report_metric(library, dataset, -1, phase_names[PHASE_FROZEN_VIEW],
+                          "cycles per value", sr->frozen_cycles,
+                          sr->frozen_cycles * 1.0 / totalcard, PHASE_FROZEN_VIEW,
+                          false);
+        }
+    }
+    if (mapped_report.measured) {
+        report_metric(library, dataset, -1, "mapped file", "bits per value",
+                      mapped_report.bytes, mapped_report.bytes * 8.0 / totalcard,
+                      -1, false);
+        for (int w = 0; w < 2; w++) {
+            for (int q = 0; q < MAPPED_QUERIES; q++) {
+                const int column = mapped_query_columns[q];
+                const int phase = (w == 0 ? PHASE_MAPPED_COLD : PHASE_MAPPED_WARM) + q;
+                report_metric(library, dataset, -1, phase_names[phase],
+                              report_unit(column), mapped_report.cycles[w][q],
+                              report_normalize(column, mapped_report.cycles[w][q],
+                                               count, totalcard, successivecard),
+                              phase, false);
+            }
+        }
+    }
+    if (wide_and_report.measured) {
+        for (int w = 0; w < 2; w++) {
+            const int phase = PHASE_WIDE_AND + w;
+            report_metric(library, dataset, -1, phase_names[phase],
+                          "cycles per value", wide_and_report.cycles[w],
+                          wide_and_report.cycles[w] * 1.0 / wide_and_report.inputcard[w],
+                          phase, false);
+        }
+    }
+    if (threshold_report.measured) {
+        for (int q = 0; q < THRESHOLD_QUERIES; q++) {
+            const int phase = PHASE_THRESHOLD + q;
+            report_metric(library, dataset, -1, phase_names[phase],
+                          "cycles per value", threshold_report.cycles[q],
+                          threshold_report.cycles[q] * 1.0 / threshold_report.inputcard,
+                          phase, false);
+        }
+    }
+    if (range_report.measured) {
+        for (int q = 0; q < RANGE_QUERIES; q++) {
+            const int phase = PHASE_RANGE + q;
+            report_metric(library, dataset, -1, phase_names[phase],
+                          "cycles per query", range_report.cycles[q],
+                          range_report.cycles[q] * 1.0 / range_report.queries,
+                          phase, false);
+        }
+    }
+    if (rank_select_report.measured) {
+        report_metric(library, dataset, -1, "rank/select index", "bits per value",
+                      rank_select_report.indexbytes,
+                      rank_select_report.indexbytes * 8.0 / totalcard, -1, false);
+        for (int q = 0; q < 2; q++) {
+            const int phase = PHASE_RANK + q;
+            report_metric(library, dataset, -1, phase_names[phase],
+                          "cycles per query", rank_select_report.cycles[q],
+                          rank_select_report.cycles[q] * 1.0 / rank_select_report.queries,
+                          phase, false);
+        }
+    }
+    if (mutation_report.measured) {
+        for (int q = 0; q < MUTATION_PHASES; q++) {
+            const int phase = PHASE_MUTATION + q;
+            const uint64_t updates = mutation_report.updates * (q == MUTATION_PHASES - 1 ? MUTATION_PHASES - 1 : 1);
+            report_metric(library, dataset, -1, phase_names[phase], "cycles per update",
+                          mutation_report.cycles[q], mutation_report.cycles[q] * 1.0 / updates,
+                          phase, false);
+        }
+        report_metric(library, dataset, -1, "memory usage after updates", "bits per value",
+                      mutation_report.bytes,
+                      mutation_report.bytes * 8.0 / mutation_report.cardinality, -1, false);
+    }
+    if (report_format == REPORT_CSV) {
+        for (int i = 0; report_checks_recorded && (i < REPORT_CHECKS); i++) {
+            report_csv_string(library);
+            putchar(',');
+            report_csv_string(report_flags);
+            putchar(',');
+            report_csv_string(dataset);
+            printf(",,\"%s\",\"cardinality\",%llu,%llu,,,,,\n", report_check_names[i],
+                   (unsigned long long)report_check_values[i],
+                   (unsigned long long)report_check_values[i]);
+        }
+    } else {
+        printf("]");
+        if (report_checks_recorded) {
+            printf(",\"checks\":{");
+            for (int i = 0; i < REPORT_CHECKS; i++) {
+                printf("%s\"%s\":%llu", i == 0 ? "" : ",", report_check_names[i],
+                       (unsigned long long)report_check_values[i]);
+            }
+            printf("}");
+        }
+        printf("}\n");
+    }
+    report_checks_recorded = false;
+    serialization_report.measured = false;
+    mapped_report.measured = false;
+    wide_and_report.measured = false;
+    threshold_report.measured = false;
+    range_report.measured = false;
+    rank_select_report.measured = false;
+    mutation_report.measured = false;
+}
+
+/*
+ * A measured phase. The code between BEGIN_PHASE and END_PHASE is timed
+ * with the time stamp counter (and, if enabled, the hardware counters);
+ * it runs benchmark_warmups times untimed, then benchmark_repetitions
+ * times, and the smallest number of cycles goes to outputvar. The code
+ * must therefore reset whatever it accumulates.
+ */
+#define BEGIN_PHASE(phase) BEGIN_REPEATED_PHASE(phase, 1)
+
+/*
+ * Same as BEGIN_PHASE, but the code is run at least the given number of
+ * times (as STARTBEST does).
+ */
+#define BEGIN_REPEATED_PHASE(phase, repetitions)                             \
+    BEGIN_MEASURED_PHASE(phase,                                              \
+                         ((repetitions) > benchmark_repetitions              \
+                              ? (repetitions)                                \
+                              : benchmark_repetitions),                      \
+                         benchmark_warmups)
+
+/*
+ * A phase that must run exactly once, such as the construction of the
+ * bitmaps.
+ */
+#define BEGIN_SINGLE_PHASE(phase) BEGIN_MEASURED_PHASE(phase, 1, 0)
+
+#define BEGIN_MEASURED_PHASE(phase, repetitions, warmups)                    \
+    {                                                                        \
+        const int phase_repetitions = (repetitions);                         \
+        uint64_t *phase_samples =                                            \
+            (uint64_t *)malloc(phase_repetitions * sizeof(uint64_t));        \
+        for (int phase_rep = -(warmups); phase_rep < phase_repetitions;      \
+             phase_rep++) {                                                  \
+            if (phase_rep == 0) {                                            \
+                perf_counters_start();                                       \
+                alloc_counters_start();                                      \
+            }                                                                \
+            uint64_t phase_cycles_start = 0, phase_cycles_final = 0;         \
+            RDTSC_START(phase_cycles_start);
+
+#define END_PHASE(phase, outputvar)                                          \
+            RDTSC_FINAL(phase_cycles_final);                                 \
+            if (phase_rep >= 0)                                              \
+                phase_samples[phase_rep] =                                   \
+                    phase_cycles_final - phase_cycles_start;                 \
+        }                                                                    \
+        perf_counters_stop(phase, phase_repetitions);                        \
+        alloc_counters_stop(phase, phase_repetitions);                       \
+        phase_stats_record(phase, phase_samples, phase_repetitions);         \
+        outputvar = phase_stats[phase].min;                                  \
+        free(phase_samples);                                                 \
+    }
+
 /*
  * Prints the best number of operations per cycle where
  * test is the function call, answer is the expected answer generated by
@@ -15,6 +15,7 @@ extern "C" {
 #endif
 #include "benchmark.h"
 #include "numbersfromtextfiles.h"
+#include "mappedstore.h"
 #ifdef __cplusplus
 }
 #endif
@@ -26,7 +27,36 @@ extern "C" {
 #include "bm.h" /* bit magic */
 #include "bmserial.h" /* bit magic, serialization routines */
 
-typedef bm::bvector<> bvect;
+#include "arena.h"
+
+/**
+ * With -A, the blocks of the temporary results come from the arena (see
+ * arena.h); otherwise, and for the bitmaps, from the default allocators.
+ */
+struct arena_block_allocator {
+    static bm::word_t *allocate(size_t n, const void *) {
+        if (arena_active) return (bm::word_t *) arena_alloc(n * sizeof(bm::word_t), 64);
+        return bm::block_allocator::allocate(n, 0);
+    }
+    static void deallocate(bm::word_t *p, size_t n) {
+        if (!arena_owns(p)) bm::block_allocator::deallocate(p, n);
+    }
+};
+
+struct arena_ptr_allocator {
+    static void *allocate(size_t n, const void *) {
+        if (arena_active) return arena_alloc(n * sizeof(void *), sizeof(void *));
+        return bm::ptr_allocator::allocate(n, 0);
+    }
+    static void deallocate(void *p, size_t n) {
+        if (!arena_owns(p)) bm::ptr_allocator::deallocate(p, n);
+    }
+};
+
+typedef bm::mem_alloc<arena_block_allocator, arena_ptr_allocator,
+                      bm::alloc_pool<arena_block_allocator, arena_ptr_allocator> > arena_allocator;
+
+typedef bm::bvector<arena_allocator> bvect;
 
 /**
  * Once you have collected all the integers, build the bitmaps.
@@ -41,10 +71,8 @@ static std::vector<bvect > create_all_bitmaps(size_t *howmany,
         if(memorysavingmode) {
           bm.set_new_blocks_strat(bm::BM_GAP);
         }
-        uint32_t * mynumbers = numbers[i];
-        for(size_t j = 0; j < howmany[i] ; ++j) {
-          bm.set(mynumbers[j]);
-        }
+        // bulk import, hinting that the values are sorted
+        bm.set(numbers[i], (bm::id_t)howmany[i], bm::BM_SORTED);
         if(memorysavingmode) {
           bm.optimize();// this might be useless, redundant...
         }
@@ -106,14 +134,78 @@ static bvect  fast_logicalor(size_t n, bvect **inputs) {
 
 
 
+/**
+ * An upper bound on the bytes taken by the serialization of all bitmaps.
+ */
+static size_t max_serialized_size(const std::vector<bvect> &bitmaps) {
+    size_t capacity = 0;
+    for (size_t i = 0; i < bitmaps.size(); ++i) {
+        bvect::statistics st;
+        bitmaps[i].calc_stat(&st);
+        capacity += st.max_serialize_mem;
+    }
+    return capacity;
+}
+
+/**
+ * The queries of the -m flag over the serialized bitmaps, bitmap i starting
+ * at buffer + offsets[i]: successive intersections, union counts and
+ * quartile queries, as in phases 1, 10 and 5. BitMagic cannot query a
+ * serialized bitmap in place, but it can combine one with a bitmap as it
+ * decodes it: the intersections and the union counts decode the first
+ * bitmap of each pair and combine the second one with it. The quartile
+ * queries decode each bitmap.
+ */
+static uint64_t mapped_query(int query, const unsigned char *buffer,
+                             const std::vector<size_t> &offsets, size_t count,
+                             uint32_t maxvalue, bm::word_t *tb) {
+    bm::operation_deserializer<bvect> od;
+    uint64_t answer = 0;
+    switch (query) {
+        case 0:
+            for (size_t i = 0; i + 1 < count; ++i) {
+                bvect tempand;
+                bm::deserialize(tempand, buffer + offsets[i], tb);
+                od.deserialize(tempand, buffer + offsets[i + 1], tb, bm::set_AND);
+                answer += tempand.count();
+            }
+            break;
+        case 1:
+            for (size_t i = 0; i + 1 < count; ++i) {
+                bvect first;
+                bm::deserialize(first, buffer + offsets[i], tb);
+                answer += od.deserialize(first, buffer + offsets[i + 1], tb, bm::set_COUNT_OR);
+            }
+            break;
+        default:
+            for (size_t i = 0; i < count; ++i) {
+                bvect bv;
+                bm::deserialize(bv, buffer + offsets[i], tb);
+                answer += bv.get_bit(maxvalue / 4);
+                answer += bv.get_bit(maxvalue / 2);
+                answer += bv.get_bit(3 * maxvalue / 4);
+            }
+    }
+    return answer;
+}
+
 static void printusage(char *command) {
     printf(
         " Try %s directory \n where directory could be "
         "benchmarks/realdata/census1881\n",
         command);
     ;
-    printf("the -v flag turns on verbose mode");
-    printf("the -r flag turns on memory-saving mode");
+    printf("the -v flag turns on verbose mode\n");
+    printf("the -b flag reads the data from a binary cache next to the directory, creating it if needed\n");
+    printf("the -j flag sets the number of threads parsing the data files (0: one per processor)\n");
+    printf("the -p flag records hardware performance counters for each phase\n");
+    printf("the -n flag followed by a number repeats each phase that many times and reports statistics\n");
+    printf("the -w flag followed by a number runs each phase that many times before measuring it\n");
+    printf("the -o flag followed by text, json or csv sets the output format\n");
+    printf("the -r flag turns on memory-saving mode\n");
+    printf("the -s flag measures serialization and deserialization\n");
+    printf("the -m flag followed by a file name writes the serialized bitmaps to that file and queries them through a mapping, cold and warm\n");
+    printf("the -A flag takes the temporary results from an arena reset between operations\n");
 
 
 }
@@ -123,17 +215,51 @@ int main(int argc, char **argv) {
     const char *extension = ".txt";
     bool verbose = false;
     bool memorysavingmode = false;
-    uint64_t data[13];
-    while ((c = getopt(argc, argv, "rve:h")) != -1) switch (c) {
+    bool serialize = false;
+    const char *mappedfile = NULL;
+    uint64_t data[14];
+    while ((c = getopt(argc, argv, "bj:pn:w:o:m:rsAve:h")) != -1) switch (c) {
         case 'e':
             extension = optarg;
             break;
+        case 'b':
+            use_binary_cache = true;
+            break;
+        case 'j':
+            loader_threads = atoi(optarg);
+            break;
+        case 'p':
+            perf_counters_enabled = perf_counters_init();
+            break;
+        case 'n':
+            benchmark_repetitions = atoi(optarg);
+            if (benchmark_repetitions < 1) benchmark_repetitions = 1;
+            break;
+        case 'w':
+            benchmark_warmups = atoi(optarg);
+            if (benchmark_warmups < 0) benchmark_warmups = 0;
+            break;
+        case 'o':
+            if (!report_set_format(optarg)) {
+                printf("Unknown output format %s (text, json or csv).\n", optarg);
+                return -1;
+            }
+            break;
+        case 'A':
+            arena_enabled = true;
+            break;
         case 'v':
             verbose = true;
             break;
         case 'r':
             memorysavingmode = true;
             break;
+        case 's':
+            serialize = true;
+            break;
+        case 'm':
+            mappedfile = optarg;
+            break;
         case 'h':
             printusage(argv[0]);
             return 0;
@@ -146,6 +272,7 @@ int main(int argc, char **argv) {
     }
     if(verbose) printf("memorysavingmode=%d\n",memorysavingmode);
     char *dirname = argv[optind];
+    report_record_flags(argc, argv, optind);
     size_t count;
 
     size_t *howmany = NULL;
@@ -174,13 +301,14 @@ int main(int argc, char **argv) {
     for (size_t i = 1; i < count; i++) {
        successivecard += howmany[i-1] + howmany[i];
     }
-    uint64_t cycles_start = 0, cycles_final = 0;
 
-    RDTSC_START(cycles_start);
-    std::vector<bvect > bitmaps = create_all_bitmaps(howmany, numbers, count, memorysavingmode);
-    RDTSC_FINAL(cycles_final);
+    std::vector<bvect > bitmaps;
+    BEGIN_SINGLE_PHASE(0)
+    bitmaps = create_all_bitmaps(howmany, numbers, count, memorysavingmode);
+    END_PHASE(0, data[13])
     if (bitmaps.empty()) return -1;
     if(verbose) printf("Loaded %d bitmaps from directory %s \n", (int)count, dirname);
+    if(verbose) printf("Building the bitmaps took %" PRIu64 " cycles\n", data[13]);
     uint64_t totalsize = 0;
 
     for (int i = 0; i < (int) count; ++i) {
@@ -198,27 +326,34 @@ int main(int argc, char **argv) {
     uint64_t total_or = 0;
     uint64_t total_count = 0;
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(1)
+    arena_start();
+    successive_and = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
+        arena_reset(); // the previous result is gone
         bvect tempand = bitmaps[i] & bitmaps[i + 1];
         successive_and += tempand.count();
     }
-    RDTSC_FINAL(cycles_final);
-    data[1] = cycles_final - cycles_start;
+    arena_stop();
+    END_PHASE(1, data[1])
     if(verbose) printf("Successive intersections on %zu bitmaps took %" PRIu64 " cycles\n", count,
-                           cycles_final - cycles_start);
+                           data[1]);
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(2)
+    arena_start();
+    successive_or = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
+        arena_reset(); // the previous result is gone
         bvect tempor = bitmaps[i] | bitmaps[i + 1];
         successive_or += tempor.count();
     }
-    RDTSC_FINAL(cycles_final);
-    data[2] = cycles_final - cycles_start;
+    arena_stop();
+    END_PHASE(2, data[2])
     if(verbose) printf("Successive unions on %zu bitmaps took %" PRIu64 " cycles\n", count,
-                           cycles_final - cycles_start);
+                           data[2]);
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(3)
+    arena_start(); // intermediate results pile up until arena_stop (see arena.h)
     if(count>1) {
         bvect totalorbitmap = bitmaps[0] | bitmaps[1];
         for (int i = 2; i < (int)count ; ++i) {
@@ -226,11 +361,12 @@ int main(int argc, char **argv) {
         }
         total_or = totalorbitmap.count();
     }
-    RDTSC_FINAL(cycles_final);
-    data[3] = cycles_final - cycles_start;
+    arena_stop();
+    END_PHASE(3, data[3])
     if(verbose) printf("Total naive unions on %zu bitmaps took %" PRIu64 " cycles\n", count,
-                           cycles_final - cycles_start);
-    RDTSC_START(cycles_start);
+                           data[3]);
+    BEGIN_PHASE(4)
+    arena_start(); // intermediate results pile up until arena_stop (see arena.h)
     if(count>1) {
         bvect  ** allofthem = new bvect* [count];
         for(int i = 0 ; i < (int) count; ++i) allofthem[i] = & bitmaps[i];
@@ -238,20 +374,20 @@ int main(int argc, char **argv) {
         total_or = totalorbitmap.count();
         delete[] allofthem;
     }
-    RDTSC_FINAL(cycles_final);
-    data[4] = cycles_final - cycles_start;
+    arena_stop();
+    END_PHASE(4, data[4])
     if(verbose) printf("Total heap unions on %zu bitmaps took %" PRIu64 " cycles\n", count,
-                           cycles_final - cycles_start);
+                           data[4]);
 
-    uint64_t quartcount;
-    STARTBEST(quartile_test_repetitions)
+    uint64_t quartcount = 0;
+    BEGIN_REPEATED_PHASE(5, quartile_test_repetitions)
     quartcount = 0;
     for (size_t i = 0; i < count ; ++i) {
       quartcount += bitmaps[i].get_bit(maxvalue/4);
       quartcount += bitmaps[i].get_bit(maxvalue/2);
       quartcount += bitmaps[i].get_bit(3*maxvalue/4);
     }
-    ENDBEST(data[5])
+    END_PHASE(5, data[5])
 
     if(verbose) printf("Quartile queries on %zu bitmaps took %" PRIu64 " cycles\n", count,
            data[5]);
@@ -263,40 +399,46 @@ int main(int argc, char **argv) {
     uint64_t successive_andnot = 0;
     uint64_t successive_xor = 0;
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(6)
+    arena_start();
+    successive_andnot = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
+        arena_reset(); // the previous result is gone
         bvect tempandnot = bitmaps[i] - bitmaps[i + 1];
         successive_andnot += tempandnot.count();
     }
-    RDTSC_FINAL(cycles_final);
-    data[6] = cycles_final - cycles_start;
+    arena_stop();
+    END_PHASE(6, data[6])
     if(verbose) printf("Successive differences on %zu bitmaps took %" PRIu64 " cycles\n", count,
-                           cycles_final - cycles_start);
+                           data[6]);
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(7)
+    arena_start();
+    successive_xor = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
+        arena_reset(); // the previous result is gone
         bvect tempxor = bitmaps[i] ^ bitmaps[i + 1];
         successive_xor += tempxor.count();
     }
-    RDTSC_FINAL(cycles_final);
-    data[7] = cycles_final - cycles_start;
+    arena_stop();
+    END_PHASE(7, data[7])
     if(verbose) printf("Successive symmetric differences on %zu bitmaps took %" PRIu64 " cycles\n", count,
-                           cycles_final - cycles_start);
+                           data[7]);
 
 
     /**
     * end of andnot and xor
     */
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(8)
+    total_count = 0;
     for (size_t i = 0; i < count; ++i) {
         const bvect & b = bitmaps[i];
         for(auto j = b.first(); j != b.end(); ++j)
           total_count ++;
     }
-    RDTSC_FINAL(cycles_final);
-    data[8] = cycles_final - cycles_start;
+    END_PHASE(8, data[8])
     if(verbose) printf("Iterating over %zu bitmaps took %" PRIu64 " cycles\n", count,
-                           cycles_final - cycles_start);
+                           data[8]);
 
     assert(totalcard == total_count);
 
@@ -313,33 +455,33 @@ int main(int argc, char **argv) {
     uint64_t successive_andnotcard = 0;
     uint64_t successive_xorcard = 0;
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(9)
+    successive_andcard = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         successive_andcard += count_and(bitmaps[i], bitmaps[i + 1]);
     }
-    RDTSC_FINAL(cycles_final);
-    data[9] = cycles_final - cycles_start;
+    END_PHASE(9, data[9])
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(10)
+    successive_orcard = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         successive_orcard += count_or(bitmaps[i], bitmaps[i + 1]);
     }
-    RDTSC_FINAL(cycles_final);
-    data[10] = cycles_final - cycles_start;
+    END_PHASE(10, data[10])
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(11)
+    successive_andnotcard = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         successive_andnotcard += count_sub(bitmaps[i], bitmaps[i + 1]);
     }
-    RDTSC_FINAL(cycles_final);
-    data[11] = cycles_final - cycles_start;
+    END_PHASE(11, data[11])
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(12)
+    successive_xorcard = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         successive_xorcard += count_xor(bitmaps[i], bitmaps[i + 1]);
     }
-    RDTSC_FINAL(cycles_final);
-    data[12] = cycles_final - cycles_start;
+    END_PHASE(12, data[12])
 
     assert(successive_andcard == successive_and);
     assert(successive_orcard == successive_or);
@@ -350,22 +492,102 @@ int main(int argc, char **argv) {
     * end and, or, andnot and xor cardinality
     */
 
+    if (serialize) {
+        /**
+        * serialize all bitmaps, one after the other, into a single buffer,
+        * then read them back (BitMagic has no format that can be used in
+        * place)
+        */
+        std::vector<size_t> offsets(count + 1, 0);
+        unsigned char *buffer = (unsigned char *)malloc(max_serialized_size(bitmaps) + 1);
+        BM_DECLARE_TEMP_BLOCK(tb)
+        BEGIN_PHASE(PHASE_SERIALIZATION)
+        for (int i = 0; i < (int)count; ++i) {
+            offsets[i + 1] = offsets[i] + bm::serialize(bitmaps[i], buffer + offsets[i], tb);
+        }
+        END_PHASE(PHASE_SERIALIZATION, serialization_report.cycles[0])
+        uint64_t deserializedcard = 0;
+        BEGIN_PHASE(PHASE_DESERIALIZATION)
+        deserializedcard = 0;
+        for (int i = 0; i < (int)count; ++i) {
+            bvect bv;
+            bm::deserialize(bv, buffer + offsets[i]);
+            deserializedcard += bv.count();
+        }
+        END_PHASE(PHASE_DESERIALIZATION, serialization_report.cycles[1])
+        assert(deserializedcard == totalcard);
+        if(verbose) printf("Deserialized cardinality %" PRIu64 " \n", deserializedcard);
+        serialization_report.measured = true;
+        serialization_report.bytes = offsets[count];
+        serialization_report.frozen = false;
+        free(buffer);
+    }
+
+    if (mappedfile != NULL) {
+        /**
+        * write the serialized bitmaps to a file and query them through a
+        * mapping of it: cold, mapping the file anew after evicting it from
+        * the page cache, then warm, over a mapping whose pages were all
+        * touched
+        */
+        std::vector<size_t> offsets(count + 1, 0);
+        unsigned char *buffer = (unsigned char *)malloc(max_serialized_size(bitmaps) + 1);
+        BM_DECLARE_TEMP_BLOCK(tb)
+        for (int i = 0; i < (int)count; ++i) {
+            offsets[i + 1] = offsets[i] + bm::serialize(bitmaps[i], buffer + offsets[i], tb);
+        }
+        if (!mapped_store_create(mappedfile, (const char *)buffer, offsets[count])) {
+            return -1;
+        }
+        free(buffer);
+        const uint64_t expected[MAPPED_QUERIES] = {successive_and, successive_or, quartcount};
+        mapped_store_t store;
+        for (int q = 0; q < MAPPED_QUERIES; ++q) {
+            uint64_t answer = 0;
+            bool mapped = false;
+            mapped_store_drop_cache(mappedfile);
+            BEGIN_SINGLE_PHASE(PHASE_MAPPED_COLD + q)
+            mapped = mapped_store_map(&store, mappedfile);
+            if (mapped) {
+                answer = mapped_query(q, (const unsigned char *)store.data, offsets, count,
+                                      maxvalue, tb);
+            }
+            END_PHASE(PHASE_MAPPED_COLD + q, mapped_report.cycles[0][q])
+            mapped_store_unmap(&store);
+            if (!mapped) {
+                printf("I could not map %s.\n", mappedfile);
+                return -1;
+            }
+            assert(answer == expected[q]);
+        }
+        if (!mapped_store_map(&store, mappedfile)) {
+            printf("I could not map %s.\n", mappedfile);
+            return -1;
+        }
+        const unsigned char *mapped = (const unsigned char *)store.data;
+        for (int q = 0; q < MAPPED_QUERIES; ++q) {
+            mapped_query(q, mapped, offsets, count, maxvalue, tb);  // touch the pages
+        }
+        for (int q = 0; q < MAPPED_QUERIES; ++q) {
+            uint64_t answer = 0;
+            BEGIN_REPEATED_PHASE(PHASE_MAPPED_WARM + q, q == 2 ? quartile_test_repetitions : 1)
+            answer = mapped_query(q, mapped, offsets, count, maxvalue, tb);
+            END_PHASE(PHASE_MAPPED_WARM + q, mapped_report.cycles[1][q])
+            assert(answer == expected[q]);
+        }
+        if(verbose) printf("Mapped %zu bytes from %s\n", store.length, mappedfile);
+        mapped_report.measured = true;
+        mapped_report.bytes = store.length;
+        mapped_store_unmap(&store);
+        unlink(mappedfile);
+    }
 
-    printf(" %20.2f %20.2f %20.2f %20.2f %20.2f %20.2f  %20.2f  %20.2f     %20.2f    %20.2f  %20.2f  %20.2f  %20.2f\n",
-      data[0]*8.0/totalcard,
-      data[1]*1.0/successivecard,
-      data[2]*1.0/successivecard,
-      data[3]*1.0/totalcard,
-      data[4]*1.0/totalcard,
-      data[5]*1.0/(3*count),
-      data[6]*1.0/successivecard,
-      data[7]*1.0/successivecard,
-      data[8]*1.0/totalcard,
-      data[9]*1.0/successivecard,
-      data[10]*1.0/successivecard,
-      data[11]*1.0/successivecard,
-      data[12]*1.0/successivecard
-     );
+    report_cardinalities(successive_and, successive_or, total_or, quartcount,
+                         successive_andnot, successive_xor, total_count);
+    benchmark_report(report_basename(argv[0]), dirname, data, 14, count,
+                     totalcard, successivecard);
+    perf_counters_print();
+    phase_stats_print();
 
 
     for (int i = 0; i < (int)count; ++i) {
@@ -0,0 +1,236 @@
+#ifndef INCLUDE_BITMAGICBACKEND_H
+#define INCLUDE_BITMAGICBACKEND_H
+
+/*
+ * Backends over BitMagic, as in bitmagic_benchmarks: the default block
+ * strategy, and the memory-saving (GAP) mode of its -r flag.
+ */
+
+#include <algorithm>
+#include <queue>
+#include <utility>
+
+#include "bitmapbackend.h"
+
+// flags recommended by BitMagic author.
+#define BM64OPT
+#define BMSSE42OPT
+
+#include "bm.h" /* bit magic */
+
+template <bool memorysavingmode>
+struct bitmagic_backend {
+    typedef bm::bvector<> bitmap;
+
+    static const char *name() {
+        return memorysavingmode ? "bitmagic_gap" : "bitmagic";
+    }
+
+    static void build(bitmap &b, const uint32_t *values, size_t n) {
+        if(memorysavingmode) {
+          b.set_new_blocks_strat(bm::BM_GAP);
+        }
+        b.set(values, (bm::id_t)n, bm::BM_SORTED);
+        if(memorysavingmode) {
+          b.optimize();
+        }
+    }
+
+    static void release(bitmap &b) { bitmap().swap(b); }
+
+    static uint64_t size_in_bytes(const bitmap &b) {
+        bitmap::statistics st;
+        b.calc_stat(&st);
+        return st.memory_used;
+    }
+
+    static uint64_t and_op(const bitmap &a, const bitmap &b) {
+        bitmap tempand = a & b;
+        return tempand.count();
+    }
+
+    static uint64_t or_op(const bitmap &a, const bitmap &b) {
+        bitmap tempor = a | b;
+        return tempor.count();
+    }
+
+    static uint64_t andnot_op(const bitmap &a, const bitmap &b) {
+        bitmap tempandnot = a - b;
+        return tempandnot.count();
+    }
+
+    static uint64_t xor_op(const bitmap &a, const bitmap &b) {
+        bitmap tempxor = a ^ b;
+        return tempxor.count();
+    }
+
+    static uint64_t and_count(const bitmap &a, const bitmap &b) {
+        return bm::count_and(a, b);
+    }
+
+    static uint64_t or_count(const bitmap &a, const bitmap &b) {
+        return bm::count_or(a, b);
+    }
+
+    static uint64_t andnot_count(const bitmap &a, const bitmap &b) {
+        return bm::count_sub(a, b);
+    }
+
+    static uint64_t xor_count(const bitmap &a, const bitmap &b) {
+        return bm::count_xor(a, b);
+    }
+
+    static uint64_t wide_or(const std::vector<bitmap> &all) {
+        if (all.size() < 2) return all.empty() ? 0 : all[0].count();
+        bitmap totalorbitmap = all[0] | all[1];
+        for (size_t i = 2; i < all.size(); ++i) {
+            totalorbitmap |= all[i];
+        }
+        return totalorbitmap.count();
+    }
+
+    // merge the two smallest bitmaps first, as fast_logicalor does in
+    // bitmagic_benchmarks
+    static uint64_t wide_or_heap(const std::vector<bitmap> &all) {
+        struct bitmap_ptr {
+            const bitmap *ptr;
+            bitmap *owned;
+            bool operator<(const bitmap_ptr &o) const {
+                return o.ptr->size() < ptr->size(); // backward on purpose
+            }
+        };
+        if (all.size() < 2) return all.empty() ? 0 : all[0].count();
+        std::priority_queue<bitmap_ptr> pq;
+        for (size_t i = 0; i < all.size(); i++) {
+            bitmap_ptr p = {&all[i], NULL};
+            pq.push(p);
+        }
+        while (pq.size() > 1) {
+            bitmap_ptr x1 = pq.top();
+            pq.pop();
+            bitmap_ptr x2 = pq.top();
+            pq.pop();
+            if (x1.owned != NULL) {
+                x1.owned->bit_or(*x2.ptr);
+                delete x2.owned;
+                pq.push(x1);
+            } else if (x2.owned != NULL) {
+                x2.owned->bit_or(*x1.ptr);
+                pq.push(x2);
+            } else {
+                bitmap *buffer = new bitmap();
+                bitmap ans = *x1.ptr | *x2.ptr;
+                buffer->swap(ans);
+                bitmap_ptr p = {buffer, buffer};
+                pq.push(p);
+            }
+        }
+        bitmap_ptr x = pq.top();
+        uint64_t card = x.ptr->count();
+        delete x.owned;
+        return card;
+    }
+
+    // the smallest bitmaps first, in place, stopping once the intersection
+    // is empty
+    static uint64_t wide_and(const bitmap *first, size_t n) {
+        std::vector<std::pair<uint64_t, const bitmap *> > sorted(n);
+        for (size_t i = 0; i < n; ++i) sorted[i] = std::make_pair((uint64_t)first[i].count(), &first[i]);
+        std::sort(sorted.begin(), sorted.end());
+        if (n == 1) return sorted[0].first;
+        bitmap tempand = *sorted[0].second & *sorted[1].second;
+        for (size_t i = 2; (i < n) && tempand.any(); ++i) {
+            tempand &= *sorted[i].second;
+        }
+        return tempand.count();
+    }
+
+    struct sliced_ops {
+        typedef bm::bvector<> bitmap;
+        static void and_op(const bitmap &a, const bitmap &b, bitmap &out) { out = a & b; }
+        static void or_op(const bitmap &a, const bitmap &b, bitmap &out) { out = a | b; }
+        static void andnot_op(const bitmap &a, const bitmap &b, bitmap &out) { out = a - b; }
+        static void xor_op(const bitmap &a, const bitmap &b, bitmap &out) { out = a ^ b; }
+        static uint64_t cardinality(const bitmap &b) { return b.count(); }
+    };
+
+    // bit-sliced counters
+    static uint64_t threshold(const bitmap *first, size_t n, size_t t) {
+        return bit_sliced_threshold<sliced_ops>(first, n, t);
+    }
+
+    static uint64_t range_count(const bitmap &b, uint64_t lo, uint64_t hi) {
+        return b.count_range((bm::id_t)lo, (bm::id_t)(hi - 1));
+    }
+
+    static bool range_intersects(const bitmap &b, uint64_t lo, uint64_t hi) {
+        typename bitmap::enumerator j = b.get_enumerator((bm::id_t)lo);
+        return j.valid() && (*j < hi);
+    }
+
+    static void range_values(const bitmap &b, uint64_t lo, uint64_t hi,
+                             std::vector<uint32_t> &out) {
+        for (typename bitmap::enumerator j = b.get_enumerator((bm::id_t)lo); j.valid() && (*j < hi); ++j) {
+            out.push_back(*j);
+        }
+    }
+
+    typedef typename bitmap::rs_index_type rank_index;
+
+    static void build_rank_index(const bitmap &b, rank_index &idx) {
+        b.build_rs_index(&idx);
+    }
+
+    // an estimate: rs_index keeps two 32-bit counts for each block of 2^16
+    // bits up to the last value (the running count, and the packed counts
+    // of the sub-blocks)
+    static uint64_t rank_index_bytes(const bitmap &b, const rank_index &) {
+        bm::id_t last = 0;
+        if (!b.find_reverse(last)) return 0;
+        return ((uint64_t)(last >> 16) + 1) * 2 * sizeof(uint32_t);
+    }
+
+    static uint64_t rank(const bitmap &b, const rank_index &idx, uint32_t x) {
+        return b.count_to(x, idx);
+    }
+
+    static uint32_t select(const bitmap &b, const rank_index &idx, uint64_t i) {
+        bm::id_t value = 0;
+        b.select((bm::id_t)(i + 1), value, idx);  // ranks count from 1
+        return value;
+    }
+
+    static void add(bitmap &b, uint32_t value) { b.set_bit(value); }
+
+    static void remove(bitmap &b, uint32_t value) { b.set_bit(value, false); }
+
+    static void add_many(bitmap &b, const uint32_t *values, size_t n) {
+        b.set(values, (bm::id_t)n, bm::BM_UNKNOWN);
+    }
+
+    static void optimize(bitmap &b) {
+        if(memorysavingmode) {
+          b.optimize();
+        }
+    }
+
+    static bool contains(const bitmap &b, uint32_t value) {
+        return b.get_bit(value);
+    }
+
+    static uint64_t iterate(const bitmap &b) {
+        uint64_t card = 0;
+        for (auto j = b.first(); j != b.end(); ++j) {
+            card++;
+        }
+        return card;
+    }
+};
+
+typedef bitmagic_backend<false> bitmagic_plain_backend;
+typedef bitmagic_backend<true> bitmagic_gap_backend;
+
+REGISTER_BACKEND(bitmagic_plain_backend)
+REGISTER_BACKEND(bitmagic_gap_backend)
+
+#endif
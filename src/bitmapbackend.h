@@ -0,0 +1,867 @@
+#ifndef INCLUDE_BITMAPBACKEND_H
+#define INCLUDE_BITMAPBACKEND_H
+
+/*
+ * The benchmark suite of the *_benchmarks executables, written once against
+ * a small backend interface so that unified_benchmarks can run it on every
+ * bitmap library from the same process and the same parsed data.
+ *
+ * A backend is a class with only static members:
+ *
+ *   typedef ... bitmap;   // default-constructible, stored in a std::vector
+ *   static const char *name();
+ *   static void build(bitmap &b, const uint32_t *values, size_t n); // sorted
+ *   static void release(bitmap &b);
+ *   static uint64_t size_in_bytes(const bitmap &b);
+ *   // compute the intersection (union, difference, symmetric difference)
+ *   // as a new bitmap, and return its cardinality
+ *   static uint64_t and_op(const bitmap &a, const bitmap &b);
+ *   static uint64_t or_op(const bitmap &a, const bitmap &b);
+ *   static uint64_t andnot_op(const bitmap &a, const bitmap &b);
+ *   static uint64_t xor_op(const bitmap &a, const bitmap &b);
+ *   // the same cardinalities, without materializing the result
+ *   static uint64_t and_count(const bitmap &a, const bitmap &b);
+ *   static uint64_t or_count(const bitmap &a, const bitmap &b);
+ *   static uint64_t andnot_count(const bitmap &a, const bitmap &b);
+ *   static uint64_t xor_count(const bitmap &a, const bitmap &b);
+ *   // cardinality of the union of all bitmaps, naively and with a heap
+ *   static uint64_t wide_or(const std::vector<bitmap> &all);
+ *   static uint64_t wide_or_heap(const std::vector<bitmap> &all);
+ *   // compute the intersection of the n >= 1 bitmaps starting at first as
+ *   // a new bitmap, with the best strategy of the library, and return its
+ *   // cardinality
+ *   static uint64_t wide_and(const bitmap *first, size_t n);
+ *   // compute, as a new bitmap, the values in at least t of the n bitmaps
+ *   // starting at first (2 <= t <= n), and return its cardinality
+ *   static uint64_t threshold(const bitmap *first, size_t n, size_t t);
+ *   // the number of values in [lo, hi), whether there is any, and these
+ *   // values appended to out (lo < hi <= 2^32)
+ *   static uint64_t range_count(const bitmap &b, uint64_t lo, uint64_t hi);
+ *   static bool range_intersects(const bitmap &b, uint64_t lo, uint64_t hi);
+ *   static void range_values(const bitmap &b, uint64_t lo, uint64_t hi,
+ *                            std::vector<uint32_t> &out);
+ *   // the number of values at most x, and the value of rank i (0-based,
+ *   // i < cardinality)
+ *   static uint64_t rank(const bitmap &b, uint32_t x);
+ *   static uint32_t select(const bitmap &b, uint64_t i);
+ *   // updates: add or remove one value, add many (in any order), and
+ *   // optimize the bitmap afterwards as the library recommends
+ *   static void add(bitmap &b, uint32_t value);
+ *   static void remove(bitmap &b, uint32_t value);
+ *   static void add_many(bitmap &b, const uint32_t *values, size_t n);
+ *   static void optimize(bitmap &b);
+ *   static bool contains(const bitmap &b, uint32_t value);
+ *   static uint64_t iterate(const bitmap &b); // number of values visited
+ *
+ * The suite is a template over the backend, so the timed loops make direct
+ * (inlinable) calls; the only indirection is the function pointer that the
+ * registry keeps for the whole suite.
+ *
+ * A backend whose read-only operations are not safe to call concurrently on
+ * the same bitmaps declares
+ *
+ *   static const bool concurrent_reads = false;
+ *
+ * and is left out of the multi-threaded phases.
+ *
+ * A backend that answers rank and select with an index built next to each
+ * bitmap declares instead
+ *
+ *   typedef ... rank_index;  // default-constructible
+ *   static void build_rank_index(const bitmap &b, rank_index &idx);
+ *   static uint64_t rank_index_bytes(const bitmap &b, const rank_index &idx);
+ *   static uint64_t rank(const bitmap &b, const rank_index &idx, uint32_t x);
+ *   static uint32_t select(const bitmap &b, const rank_index &idx, uint64_t i);
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <inttypes.h>
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+extern "C" {
+#include "benchmark.h"
+}
+#include "threadpool.h"
+
+/*
+ * The parsed data, shared by all backends.
+ */
+struct benchmark_dataset {
+    uint32_t **numbers;
+    size_t *howmany;
+    size_t count;
+    uint32_t maxvalue;
+    uint64_t totalcard;
+    uint64_t successivecard;
+};
+
+static inline benchmark_dataset make_benchmark_dataset(uint32_t **numbers,
+                                                       size_t *howmany,
+                                                       size_t count) {
+    benchmark_dataset ds;
+    ds.numbers = numbers;
+    ds.howmany = howmany;
+    ds.count = count;
+    ds.maxvalue = 0;
+    ds.totalcard = 0;
+    ds.successivecard = 0;
+    for (size_t i = 0; i < count; i++) {
+        if ((howmany[i] > 0) && (ds.maxvalue < numbers[i][howmany[i] - 1])) {
+            ds.maxvalue = numbers[i][howmany[i] - 1];
+        }
+        ds.totalcard += howmany[i];
+    }
+    for (size_t i = 1; i < count; i++) {
+        ds.successivecard += howmany[i - 1] + howmany[i];
+    }
+    return ds;
+}
+
+/*
+ * Multi-threaded successive operations (-t): the pairs (i, i + 1) are
+ * handed out one at a time, from a shared atomic counter, to the threads of
+ * a pool, so that a thread that draws cheap pairs keeps taking more. Each
+ * pairwise phase is timed with 1, 2, 4... and benchmark_threads threads;
+ * we report the aggregate cycles per input value and the scaling efficiency
+ * (speedup over one thread, divided by the number of threads).
+ */
+static int benchmark_threads = 0;
+
+#define PARALLEL_PHASES 8
+#define PARALLEL_MAX_RUNS 16
+
+static const int parallel_phase_ids[PARALLEL_PHASES] = {1, 2, 6, 7, 9, 10, 11, 12};
+
+struct parallel_results {
+    bool measured;
+    int runs;
+    int threads[PARALLEL_MAX_RUNS];
+    double cycles_per_value[PARALLEL_PHASES][PARALLEL_MAX_RUNS];
+};
+
+static parallel_results parallel_report;
+
+template <class B, class = void>
+struct backend_concurrent_reads {
+    static const bool value = true;
+};
+
+template <class B>
+struct backend_concurrent_reads<B, typename std::enable_if<!B::concurrent_reads>::type> {
+    static const bool value = false;
+};
+
+template <class T>
+struct backend_void {
+    typedef void type;
+};
+
+// rank and select through the index of the backend, if it has one
+template <class B, class = void>
+struct backend_rank_select {
+    struct rank_index {};
+    static void build_rank_index(const typename B::bitmap &, rank_index &) {}
+    static uint64_t rank_index_bytes(const typename B::bitmap &, const rank_index &) { return 0; }
+    static uint64_t rank(const typename B::bitmap &b, const rank_index &, uint32_t x) {
+        return B::rank(b, x);
+    }
+    static uint32_t select(const typename B::bitmap &b, const rank_index &, uint64_t i) {
+        return B::select(b, i);
+    }
+};
+
+template <class B>
+struct backend_rank_select<B, typename backend_void<typename B::rank_index>::type> : B {};
+
+template <class B>
+struct parallel_pairs_job {
+    typedef typename B::bitmap bitmap;
+    typedef uint64_t (*operation)(const bitmap &, const bitmap &);
+
+    const std::vector<bitmap> *bitmaps;
+    operation op;
+    std::atomic<size_t> next;
+    std::atomic<uint64_t> cardinality;
+
+    void operator()(int) {
+        const std::vector<bitmap> &b = *bitmaps;
+        uint64_t card = 0;
+        for (size_t i = next.fetch_add(1); i + 1 < b.size(); i = next.fetch_add(1)) {
+            card += op(b[i], b[i + 1]);
+        }
+        cardinality += card;
+    }
+};
+
+/*
+ * Time one pairwise operation on the given number of threads (the best of
+ * benchmark_repetitions runs); the cardinality is checked against
+ * the single-threaded phase.
+ */
+template <class B>
+static uint64_t time_parallel_pairs(const std::vector<typename B::bitmap> &bitmaps,
+                                    typename parallel_pairs_job<B>::operation op,
+                                    int threads, uint64_t expected) {
+    benchmark_thread_pool pool(threads);
+    uint64_t best = (uint64_t)-1;
+    for (int rep = -benchmark_warmups; rep < benchmark_repetitions; rep++) {
+        parallel_pairs_job<B> job;
+        job.bitmaps = &bitmaps;
+        job.op = op;
+        job.next = 0;
+        job.cardinality = 0;
+        uint64_t cycles = pool.run(job);
+        assert(job.cardinality == expected);
+        (void)expected;
+        if ((rep >= 0) && (cycles < best)) best = cycles;
+    }
+    return best;
+}
+
+template <class B>
+static void run_parallel_pairs(const std::vector<typename B::bitmap> &bitmaps,
+                               const benchmark_dataset &ds,
+                               const uint64_t *expected) {
+    parallel_report.measured = false;
+    if (benchmark_threads < 1) return;
+    if (!backend_concurrent_reads<B>::value) {
+        if (report_format == REPORT_TEXT) printf("# %s does not support concurrent reads, skipping -t\n", B::name());
+        return;
+    }
+    const typename parallel_pairs_job<B>::operation ops[PARALLEL_PHASES] = {
+        B::and_op, B::or_op, B::andnot_op, B::xor_op,
+        B::and_count, B::or_count, B::andnot_count, B::xor_count};
+    int runs = 0;
+    for (int t = 1; (runs < PARALLEL_MAX_RUNS); t *= 2) {
+        if (t > benchmark_threads) t = benchmark_threads;
+        parallel_report.threads[runs++] = t;
+        if (t == benchmark_threads) break;
+    }
+    parallel_report.runs = runs;
+    for (int p = 0; p < PARALLEL_PHASES; p++) {
+        for (int r = 0; r < runs; r++) {
+            uint64_t cycles = time_parallel_pairs<B>(bitmaps, ops[p],
+                                                     parallel_report.threads[r],
+                                                     expected[p]);
+            parallel_report.cycles_per_value[p][r] = cycles * 1.0 / ds.successivecard;
+        }
+    }
+    parallel_report.measured = true;
+}
+
+/*
+ * Print the multi-threaded results as '#' comments: for each number of
+ * threads, the cycles per input value and, in parentheses, the efficiency.
+ */
+static inline void parallel_results_print() {
+    if (!parallel_report.measured || (report_format != REPORT_TEXT)) return;
+    printf("# %-34s", "parallel (cycles/value, eff.)");
+    for (int r = 0; r < parallel_report.runs; r++) {
+        printf(" %10d thread%s", parallel_report.threads[r],
+               parallel_report.threads[r] > 1 ? "s" : " ");
+    }
+    printf("\n");
+    for (int p = 0; p < PARALLEL_PHASES; p++) {
+        printf("# %-34s", phase_names[parallel_phase_ids[p]]);
+        const double single = parallel_report.cycles_per_value[p][0];
+        for (int r = 0; r < parallel_report.runs; r++) {
+            const double cpv = parallel_report.cycles_per_value[p][r];
+            printf(" %9.2f (%4.2f)", cpv,
+                   cpv > 0 ? single / (cpv * parallel_report.threads[r]) : 0.0);
+        }
+        printf("\n");
+    }
+}
+
+/*
+ * Many-way intersections (-k): every window of k successive bitmaps, then
+ * all bitmaps, intersected with B::wide_and. The result cardinalities of a
+ * data set do not depend on the backend; -v prints them.
+ */
+static int wide_and_window = 0;
+
+template <class B>
+static void run_wide_and(const std::vector<typename B::bitmap> &bitmaps,
+                         const benchmark_dataset &ds, bool verbose) {
+    wide_and_report.measured = false;
+    if (wide_and_window < 2) return;
+    const size_t k = wide_and_window;
+    const size_t count = ds.count;
+    if (count < k) {
+        if (report_format == REPORT_TEXT) printf("# fewer than %zu bitmaps, skipping -k\n", k);
+        return;
+    }
+    uint64_t windowinput = 0;
+    for (size_t i = 0; i + k <= count; ++i) {
+        for (size_t j = i; j < i + k; ++j) windowinput += ds.howmany[j];
+    }
+
+    uint64_t windowcard = 0;
+    BEGIN_PHASE(PHASE_WIDE_AND)
+    windowcard = 0;
+    for (size_t i = 0; i + k <= count; ++i) {
+        windowcard += B::wide_and(&bitmaps[i], k);
+    }
+    END_PHASE(PHASE_WIDE_AND, wide_and_report.cycles[0])
+
+    uint64_t total_and = 0;
+    BEGIN_PHASE(PHASE_TOTAL_AND)
+    total_and = B::wide_and(bitmaps.data(), count);
+    END_PHASE(PHASE_TOTAL_AND, wide_and_report.cycles[1])
+    if(verbose) printf("%zu-way intersections %" PRIu64 ", total intersection %" PRIu64 "\n", k,
+                           windowcard, total_and);
+
+    wide_and_report.k = (int)k;
+    wide_and_report.inputcard[0] = windowinput > 0 ? windowinput : 1;
+    wide_and_report.inputcard[1] = ds.totalcard > 0 ? ds.totalcard : 1;
+    wide_and_report.cardinality[0] = windowcard;
+    wide_and_report.cardinality[1] = total_and;
+    wide_and_report.measured = true;
+}
+
+/*
+ * Threshold queries (-T): every window of N successive bitmaps, for each of
+ * the thresholds of threshold_report.
+ */
+static int threshold_window = 0;
+
+template <class B>
+static void run_threshold(const std::vector<typename B::bitmap> &bitmaps,
+                          const benchmark_dataset &ds, bool verbose) {
+    threshold_report.measured = false;
+    if (threshold_window < 3) return;
+    const size_t n = threshold_window;
+    const size_t count = ds.count;
+    if (count < n) {
+        if (report_format == REPORT_TEXT) printf("# fewer than %zu bitmaps, skipping -T\n", n);
+        return;
+    }
+    const size_t thresholds[THRESHOLD_QUERIES] = {2, (n + 1) / 2, n - 1};
+    uint64_t windowinput = 0;
+    for (size_t i = 0; i + n <= count; ++i) {
+        for (size_t j = i; j < i + n; ++j) windowinput += ds.howmany[j];
+    }
+    for (int q = 0; q < THRESHOLD_QUERIES; q++) {
+        const size_t t = thresholds[q];
+        uint64_t card = 0;
+        BEGIN_PHASE(PHASE_THRESHOLD + q)
+        card = 0;
+        for (size_t i = 0; i + n <= count; ++i) {
+            card += B::threshold(&bitmaps[i], n, t);
+        }
+        END_PHASE(PHASE_THRESHOLD + q, threshold_report.cycles[q])
+        if(verbose) printf("Values in at least %zu of %zu bitmaps %" PRIu64 "\n", t, n, card);
+        threshold_report.t[q] = (int)t;
+        threshold_report.cardinality[q] = card;
+    }
+    threshold_report.n = (int)n;
+    threshold_report.inputcard = windowinput > 0 ? windowinput : 1;
+    threshold_report.measured = true;
+}
+
+/*
+ * The threshold query on bit-sliced counters, for backends whose bitmaps
+ * only offer logical operations: slice j holds bit j of the number of
+ * bitmaps that contain each value, and adding a bitmap ripples a carry
+ * through the slices. Ops is a class with static members
+ *
+ *   typedef ... bitmap;
+ *   static void and_op(const bitmap &a, const bitmap &b, bitmap &out);
+ *   static void or_op(const bitmap &a, const bitmap &b, bitmap &out);
+ *   static void andnot_op(const bitmap &a, const bitmap &b, bitmap &out);
+ *   static void xor_op(const bitmap &a, const bitmap &b, bitmap &out);
+ *   static uint64_t cardinality(const bitmap &b);
+ */
+template <class Ops>
+static uint64_t bit_sliced_threshold(const typename Ops::bitmap *first,
+                                     size_t n, size_t t) {
+    typedef typename Ops::bitmap bitmap;
+    std::vector<bitmap> slices;
+    for (size_t i = 0; i < n; ++i) {
+        bitmap carry(first[i]);
+        for (size_t j = 0; ; ++j) {
+            if (j == slices.size()) {
+                slices.push_back(carry);
+                break;
+            }
+            bitmap newcarry, newslice;
+            Ops::and_op(slices[j], carry, newcarry);
+            Ops::xor_op(slices[j], carry, newslice);
+            slices[j].swap(newslice);
+            if (Ops::cardinality(newcarry) == 0) break;
+            carry.swap(newcarry);
+        }
+    }
+    // compare the counts with t, from the most significant bit: greater
+    // holds the values whose count is already known to exceed t, equal
+    // those whose count matches the bits of t seen so far
+    size_t top = 0;
+    while ((t >> (top + 1)) != 0) top++;
+    bitmap greater, equal;
+    for (size_t j = top + 1; j < slices.size(); ++j) {
+        bitmap tmp;
+        Ops::or_op(greater, slices[j], tmp);
+        greater.swap(tmp);
+    }
+    if (top < slices.size()) Ops::andnot_op(slices[top], greater, equal);
+    for (size_t j = top; (j-- > 0) && (j < slices.size());) {
+        bitmap tmp;
+        if ((t >> j) & 1) {
+            Ops::and_op(equal, slices[j], tmp);
+            equal.swap(tmp);
+        } else {
+            bitmap above;
+            Ops::and_op(equal, slices[j], above);
+            Ops::or_op(greater, above, tmp);
+            greater.swap(tmp);
+            bitmap rest;
+            Ops::andnot_op(equal, slices[j], rest);
+            equal.swap(rest);
+        }
+    }
+    bitmap result;
+    Ops::or_op(greater, equal, result);
+    return Ops::cardinality(result);
+}
+
+/*
+ * Random queries, the same for every backend: splitmix64 from a fixed seed.
+ */
+static inline uint64_t query_random(uint64_t *state) {
+    uint64_t z = (*state += UINT64_C(0x9E3779B97F4A7C15));
+    z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+    z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+    return z ^ (z >> 31);
+}
+
+/*
+ * Range queries (-R): that many random ranges, each on one bitmap in turn.
+ * The widths are spread evenly on a logarithmic scale, from 1 to the
+ * largest value.
+ */
+static int range_queries = 0;
+
+struct range_query {
+    size_t bitmap;
+    uint64_t lo, hi;
+};
+
+static inline std::vector<range_query> make_range_queries(const benchmark_dataset &ds,
+                                                          size_t howmany) {
+    std::vector<range_query> queries(howmany);
+    const uint64_t universe = (uint64_t)ds.maxvalue + 1;
+    int bits = 0;
+    while ((UINT64_C(1) << bits) < universe) bits++;
+    uint64_t state = 1234;
+    for (size_t q = 0; q < howmany; q++) {
+        const uint64_t width = 1 + query_random(&state) % (UINT64_C(1) << (query_random(&state) % (bits + 1)));
+        queries[q].bitmap = q % ds.count;
+        queries[q].lo = query_random(&state) % universe;
+        queries[q].hi = std::min(queries[q].lo + width, universe);
+    }
+    return queries;
+}
+
+template <class B>
+static void run_ranges(const std::vector<typename B::bitmap> &bitmaps,
+                       const benchmark_dataset &ds, bool verbose) {
+    range_report.measured = false;
+    if ((range_queries <= 0) || (ds.count == 0)) return;
+    const std::vector<range_query> queries = make_range_queries(ds, range_queries);
+    uint64_t counted = 0, hits = 0, extracted = 0;
+    BEGIN_PHASE(PHASE_RANGE)
+    counted = 0;
+    for (size_t q = 0; q < queries.size(); q++) {
+        counted += B::range_count(bitmaps[queries[q].bitmap], queries[q].lo, queries[q].hi);
+    }
+    END_PHASE(PHASE_RANGE, range_report.cycles[0])
+    BEGIN_PHASE(PHASE_RANGE + 1)
+    hits = 0;
+    for (size_t q = 0; q < queries.size(); q++) {
+        hits += B::range_intersects(bitmaps[queries[q].bitmap], queries[q].lo, queries[q].hi);
+    }
+    END_PHASE(PHASE_RANGE + 1, range_report.cycles[1])
+    std::vector<uint32_t> out;
+    BEGIN_PHASE(PHASE_RANGE + 2)
+    extracted = 0;
+    for (size_t q = 0; q < queries.size(); q++) {
+        out.clear();
+        B::range_values(bitmaps[queries[q].bitmap], queries[q].lo, queries[q].hi, out);
+        extracted += out.size();
+    }
+    END_PHASE(PHASE_RANGE + 2, range_report.cycles[2])
+    if(verbose) printf("Range queries: %" PRIu64 " values counted, %" PRIu64 " ranges hit, %" PRIu64 " values extracted\n",
+                       counted, hits, extracted);
+    range_report.queries = queries.size();
+    range_report.results[0] = counted;
+    range_report.results[1] = hits;
+    range_report.results[2] = extracted;
+    range_report.measured = true;
+}
+
+/*
+ * Rank and select queries (-q): that many of each, each on one (non-empty)
+ * bitmap in turn, for random values up to the largest one and random ranks.
+ * The size of the indexes is added to column 0 (data[0]).
+ */
+static int rank_select_queries = 0;
+
+template <class B>
+static void run_rank_select(const std::vector<typename B::bitmap> &bitmaps,
+                            const benchmark_dataset &ds, bool verbose,
+                            uint64_t *data) {
+    typedef backend_rank_select<B> RS;
+    rank_select_report.measured = false;
+    if (rank_select_queries <= 0) return;
+    std::vector<size_t> nonempty;
+    for (size_t i = 0; i < ds.count; i++) {
+        if (ds.howmany[i] > 0) nonempty.push_back(i);
+    }
+    if (nonempty.empty()) return;
+    std::vector<size_t> targets(rank_select_queries);
+    std::vector<uint32_t> values(rank_select_queries);
+    std::vector<uint64_t> ranks(rank_select_queries);
+    uint64_t state = 4321;
+    uint64_t expectedrank = 0, expectedselect = 0;
+    for (size_t q = 0; q < targets.size(); q++) {
+        const size_t b = nonempty[q % nonempty.size()];
+        const uint32_t *numbers = ds.numbers[b];
+        targets[q] = b;
+        values[q] = (uint32_t)(query_random(&state) % ((uint64_t)ds.maxvalue + 1));
+        ranks[q] = query_random(&state) % ds.howmany[b];
+        expectedrank += std::upper_bound(numbers, numbers + ds.howmany[b], values[q]) - numbers;
+        expectedselect += numbers[ranks[q]];
+    }
+
+    std::vector<typename RS::rank_index> indexes(ds.count);
+    uint64_t indexbytes = 0;
+    for (size_t i = 0; i < ds.count; i++) {
+        RS::build_rank_index(bitmaps[i], indexes[i]);
+        indexbytes += RS::rank_index_bytes(bitmaps[i], indexes[i]);
+    }
+    uint64_t ranksum = 0, selectsum = 0;
+    BEGIN_PHASE(PHASE_RANK)
+    ranksum = 0;
+    for (size_t q = 0; q < targets.size(); q++) {
+        ranksum += RS::rank(bitmaps[targets[q]], indexes[targets[q]], values[q]);
+    }
+    END_PHASE(PHASE_RANK, rank_select_report.cycles[0])
+    BEGIN_PHASE(PHASE_SELECT)
+    selectsum = 0;
+    for (size_t q = 0; q < targets.size(); q++) {
+        selectsum += RS::select(bitmaps[targets[q]], indexes[targets[q]], ranks[q]);
+    }
+    END_PHASE(PHASE_SELECT, rank_select_report.cycles[1])
+    if(verbose) printf("Rank and select queries: ranks sum to %" PRIu64 ", values to %" PRIu64 ", index of %" PRIu64 " bytes\n",
+                       ranksum, selectsum, indexbytes);
+    assert(ranksum == expectedrank);
+    assert(selectsum == expectedselect);
+    (void)expectedrank;
+    (void)expectedselect;
+    data[0] += indexbytes;
+    rank_select_report.queries = targets.size();
+    rank_select_report.indexbytes = indexbytes;
+    rank_select_report.measured = true;
+}
+
+/*
+ * Updates (-u): for each bitmap, batches of that many random values up to
+ * the largest one, inserted one at a time in increasing order, one at a
+ * time in random order, and all at once; then as many removals, half of
+ * them of values the bitmap held. The bitmaps are modified, so this runs
+ * last, and each phase runs once.
+ */
+static int mutation_batch = 0;
+
+template <class B>
+static void run_mutations(std::vector<typename B::bitmap> &bitmaps,
+                          const benchmark_dataset &ds, bool verbose) {
+    mutation_report.measured = false;
+    if ((mutation_batch <= 0) || (ds.count == 0)) return;
+    const size_t count = ds.count;
+    const size_t batch = mutation_batch;
+    // batches[i * 4 + k]: batch k of bitmap i
+    std::vector<std::vector<uint32_t> > batches(count * 4);
+    uint64_t state = 5678;
+    uint64_t expected = 0;
+    for (size_t i = 0; i < count; i++) {
+        for (size_t k = 0; k < 4; k++) {
+            std::vector<uint32_t> &values = batches[i * 4 + k];
+            values.resize(batch);
+            for (size_t j = 0; j < batch; j++) {
+                if ((k == 3) && (j % 2 == 0) && (ds.howmany[i] > 0)) {
+                    values[j] = ds.numbers[i][query_random(&state) % ds.howmany[i]];
+                } else {
+                    values[j] = (uint32_t)(query_random(&state) % ((uint64_t)ds.maxvalue + 1));
+                }
+            }
+        }
+        std::sort(batches[i * 4].begin(), batches[i * 4].end());
+        std::vector<uint32_t> after(ds.numbers[i], ds.numbers[i] + ds.howmany[i]);
+        for (size_t k = 0; k < 3; k++) {
+            after.insert(after.end(), batches[i * 4 + k].begin(), batches[i * 4 + k].end());
+        }
+        std::sort(after.begin(), after.end());
+        after.erase(std::unique(after.begin(), after.end()), after.end());
+        std::vector<uint32_t> removed(batches[i * 4 + 3]);
+        std::sort(removed.begin(), removed.end());
+        std::vector<uint32_t> left;
+        std::set_difference(after.begin(), after.end(), removed.begin(), removed.end(),
+                            std::back_inserter(left));
+        expected += left.size();
+    }
+
+    BEGIN_SINGLE_PHASE(PHASE_MUTATION)
+    for (size_t i = 0; i < count; i++) {
+        const std::vector<uint32_t> &values = batches[i * 4];
+        for (size_t j = 0; j < batch; j++) B::add(bitmaps[i], values[j]);
+    }
+    END_PHASE(PHASE_MUTATION, mutation_report.cycles[0])
+    BEGIN_SINGLE_PHASE(PHASE_MUTATION + 1)
+    for (size_t i = 0; i < count; i++) {
+        const std::vector<uint32_t> &values = batches[i * 4 + 1];
+        for (size_t j = 0; j < batch; j++) B::add(bitmaps[i], values[j]);
+    }
+    END_PHASE(PHASE_MUTATION + 1, mutation_report.cycles[1])
+    BEGIN_SINGLE_PHASE(PHASE_MUTATION + 2)
+    for (size_t i = 0; i < count; i++) {
+        B::add_many(bitmaps[i], batches[i * 4 + 2].data(), batch);
+    }
+    END_PHASE(PHASE_MUTATION + 2, mutation_report.cycles[2])
+    BEGIN_SINGLE_PHASE(PHASE_MUTATION + 3)
+    for (size_t i = 0; i < count; i++) {
+        const std::vector<uint32_t> &values = batches[i * 4 + 3];
+        for (size_t j = 0; j < batch; j++) B::remove(bitmaps[i], values[j]);
+    }
+    END_PHASE(PHASE_MUTATION + 3, mutation_report.cycles[3])
+    BEGIN_SINGLE_PHASE(PHASE_MUTATION + 4)
+    for (size_t i = 0; i < count; i++) {
+        B::optimize(bitmaps[i]);
+    }
+    END_PHASE(PHASE_MUTATION + 4, mutation_report.cycles[4])
+
+    uint64_t card = 0, bytes = 0;
+    for (size_t i = 0; i < count; i++) {
+        card += B::iterate(bitmaps[i]);
+        bytes += B::size_in_bytes(bitmaps[i]);
+    }
+    if(verbose) printf("After the updates: %" PRIu64 " values in %" PRIu64 " bytes\n", card, bytes);
+    assert(card == expected);
+    (void)expected;
+    mutation_report.updates = (uint64_t)batch * count;
+    mutation_report.bytes = bytes;
+    mutation_report.cardinality = card > 0 ? card : 1;
+    mutation_report.measured = true;
+}
+
+/*
+ * Run the 13 phases of the benchmark on backend B, filling data[0..13] as
+ * the *_benchmarks executables do (data[13] is the construction).
+ */
+template <class B>
+static void run_benchmark_suite(const benchmark_dataset &ds, bool verbose,
+                                uint64_t *data) {
+    typedef typename B::bitmap bitmap;
+    const size_t count = ds.count;
+    const uint32_t maxvalue = ds.maxvalue;
+
+    std::vector<bitmap> bitmaps(count);
+    BEGIN_SINGLE_PHASE(0)
+    for (size_t i = 0; i < count; i++) {
+        B::build(bitmaps[i], ds.numbers[i], ds.howmany[i]);
+    }
+    END_PHASE(0, data[13])
+    if(verbose) printf("Building the bitmaps took %" PRIu64 " cycles\n", data[13]);
+    uint64_t totalsize = 0;
+    for (size_t i = 0; i < count; i++) {
+        totalsize += B::size_in_bytes(bitmaps[i]);
+    }
+    data[0] = totalsize;
+    if(verbose) printf("Total size in bytes =  %" PRIu64 " \n", totalsize);
+
+    uint64_t successive_and = 0;
+    uint64_t successive_or = 0;
+    uint64_t total_or = 0;
+    uint64_t total_or_heap = 0;
+    uint64_t quartcount = 0;
+    uint64_t successive_andnot = 0;
+    uint64_t successive_xor = 0;
+    uint64_t total_count = 0;
+
+    BEGIN_PHASE(1)
+    successive_and = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+        successive_and += B::and_op(bitmaps[i], bitmaps[i + 1]);
+    }
+    END_PHASE(1, data[1])
+    if(verbose) printf("Successive intersections on %zu bitmaps took %" PRIu64 " cycles\n", count,
+                           data[1]);
+
+    BEGIN_PHASE(2)
+    successive_or = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+        successive_or += B::or_op(bitmaps[i], bitmaps[i + 1]);
+    }
+    END_PHASE(2, data[2])
+    if(verbose) printf("Successive unions on %zu bitmaps took %" PRIu64 " cycles\n", count,
+                           data[2]);
+
+    BEGIN_PHASE(3)
+    total_or = B::wide_or(bitmaps);
+    END_PHASE(3, data[3])
+    if(verbose) printf("Total naive unions on %zu bitmaps took %" PRIu64 " cycles\n", count,
+                           data[3]);
+
+    BEGIN_PHASE(4)
+    total_or_heap = B::wide_or_heap(bitmaps);
+    END_PHASE(4, data[4])
+    if(verbose) printf("Total heap unions on %zu bitmaps took %" PRIu64 " cycles\n", count,
+                           data[4]);
+    assert(total_or == total_or_heap);
+
+    BEGIN_REPEATED_PHASE(5, quartile_test_repetitions)
+    quartcount = 0;
+    for (size_t i = 0; i < count ; ++i) {
+      quartcount += B::contains(bitmaps[i], maxvalue/4);
+      quartcount += B::contains(bitmaps[i], maxvalue/2);
+      quartcount += B::contains(bitmaps[i], 3*maxvalue/4);
+    }
+    END_PHASE(5, data[5])
+    if(verbose) printf("Quartile queries on %zu bitmaps took %" PRIu64 " cycles\n", count,
+           data[5]);
+
+    if(verbose) printf("Collected stats  %" PRIu64 "  %" PRIu64 "  %" PRIu64 " %" PRIu64 "\n",successive_and,successive_or,total_or,quartcount);
+
+    BEGIN_PHASE(6)
+    successive_andnot = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+        successive_andnot += B::andnot_op(bitmaps[i], bitmaps[i + 1]);
+    }
+    END_PHASE(6, data[6])
+    if(verbose) printf("Successive differences on %zu bitmaps took %" PRIu64 " cycles\n", count,
+           data[6]);
+
+    BEGIN_PHASE(7)
+    successive_xor = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+        successive_xor += B::xor_op(bitmaps[i], bitmaps[i + 1]);
+    }
+    END_PHASE(7, data[7])
+    if(verbose) printf("Successive symmetric differences on %zu bitmaps took %" PRIu64 " cycles\n", count,
+           data[7]);
+
+    BEGIN_PHASE(8)
+    total_count = 0;
+    for (size_t i = 0; i < count; ++i) {
+        total_count += B::iterate(bitmaps[i]);
+    }
+    END_PHASE(8, data[8])
+    if(verbose) printf("Iterating over %zu bitmaps took %" PRIu64 " cycles\n", count,
+           data[8]);
+    assert(total_count == ds.totalcard);
+    assert(successive_xor + successive_and == successive_or);
+
+    uint64_t successive_andcard = 0;
+    uint64_t successive_orcard = 0;
+    uint64_t successive_andnotcard = 0;
+    uint64_t successive_xorcard = 0;
+
+    BEGIN_PHASE(9)
+    successive_andcard = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+        successive_andcard += B::and_count(bitmaps[i], bitmaps[i + 1]);
+    }
+    END_PHASE(9, data[9])
+
+    BEGIN_PHASE(10)
+    successive_orcard = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+        successive_orcard += B::or_count(bitmaps[i], bitmaps[i + 1]);
+    }
+    END_PHASE(10, data[10])
+
+    BEGIN_PHASE(11)
+    successive_andnotcard = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+        successive_andnotcard += B::andnot_count(bitmaps[i], bitmaps[i + 1]);
+    }
+    END_PHASE(11, data[11])
+
+    BEGIN_PHASE(12)
+    successive_xorcard = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+        successive_xorcard += B::xor_count(bitmaps[i], bitmaps[i + 1]);
+    }
+    END_PHASE(12, data[12])
+
+    assert(successive_andcard == successive_and);
+    assert(successive_orcard == successive_or);
+    assert(successive_xorcard == successive_xor);
+    assert(successive_andnotcard == successive_andnot);
+
+    report_cardinalities(successive_and, successive_or, total_or, quartcount,
+                         successive_andnot, successive_xor, total_count);
+
+    const uint64_t expected[PARALLEL_PHASES] = {
+        successive_and, successive_or, successive_andnot, successive_xor,
+        successive_andcard, successive_orcard, successive_andnotcard,
+        successive_xorcard};
+    run_parallel_pairs<B>(bitmaps, ds, expected);
+    run_wide_and<B>(bitmaps, ds, verbose);
+    run_threshold<B>(bitmaps, ds, verbose);
+    run_ranges<B>(bitmaps, ds, verbose);
+    run_rank_select<B>(bitmaps, ds, verbose, data);
+    run_mutations<B>(bitmaps, ds, verbose);
+
+    for (size_t i = 0; i < count; i++) {
+        B::release(bitmaps[i]);
+    }
+}
+
+/*
+ * The registry of backends. A backend header registers each of its
+ * backends with REGISTER_BACKEND(classname) at namespace scope; backends
+ * are listed in the order of registration.
+ */
+typedef void (*benchmark_suite_function)(const benchmark_dataset &, bool,
+                                         uint64_t *);
+
+struct registered_backend {
+    const char *name;
+    benchmark_suite_function run;
+};
+
+static inline std::vector<registered_backend> &backend_registry() {
+    static std::vector<registered_backend> registry;
+    return registry;
+}
+
+template <class B>
+struct backend_registration {
+    backend_registration() {
+        registered_backend rb;
+        rb.name = B::name();
+        rb.run = &run_benchmark_suite<B>;
+        backend_registry().push_back(rb);
+    }
+};
+
+#define REGISTER_BACKEND(B) static backend_registration<B> B##_registration;
+
+static inline const registered_backend *find_backend(const char *name) {
+    for (size_t i = 0; i < backend_registry().size(); i++) {
+        if (strcmp(backend_registry()[i].name, name) == 0) {
+            return &backend_registry()[i];
+        }
+    }
+    return NULL;
+}
+
+#endif
@@ -18,8 +18,10 @@ static bitset_t **create_all_bitmaps(size_t *howmany,
     for (size_t i = 0; i < count; i++) {
       uint32_t biggest = numbers[i][howmany[i]-1];
       answer[i] = bitset_create_with_capacity(biggest+1);
+      // the capacity holds all values: set the words directly
+      uint64_t * words = answer[i]->array;
       for(size_t j = 0; j < howmany[i] ; ++j)
-        bitset_set(answer[i],numbers[i][j]);
+        words[numbers[i][j] >> 6] |= UINT64_C(1) << (numbers[i][j] & 63);
     }
     return answer;
 }
@@ -30,7 +32,13 @@ static void printusage(char *command) {
         "benchmarks/realdata/census1881\n",
         command);
     ;
-    printf("the -v flag turns on verbose mode");
+    printf("the -v flag turns on verbose mode\n");
+    printf("the -b flag reads the data from a binary cache next to the directory, creating it if needed\n");
+    printf("the -j flag sets the number of threads parsing the data files (0: one per processor)\n");
+    printf("the -p flag records hardware performance counters for each phase\n");
+    printf("the -n flag followed by a number repeats each phase that many times and reports statistics\n");
+    printf("the -w flag followed by a number runs each phase that many times before measuring it\n");
+    printf("the -o flag followed by text, json or csv sets the output format\n");
 
 }
 
@@ -50,11 +58,34 @@ int main(int argc, char **argv) {
     int c;
     bool verbose = false;
     char *extension = (char *) ".txt";
-    uint64_t data[13];
-    while ((c = getopt(argc, argv, "vre:h")) != -1) switch (c) {
+    uint64_t data[14];
+    while ((c = getopt(argc, argv, "bj:pn:w:o:vre:h")) != -1) switch (c) {
         case 'e':
             extension = optarg;
             break;
+        case 'b':
+            use_binary_cache = true;
+            break;
+        case 'j':
+            loader_threads = atoi(optarg);
+            break;
+        case 'p':
+            perf_counters_enabled = perf_counters_init();
+            break;
+        case 'n':
+            benchmark_repetitions = atoi(optarg);
+            if (benchmark_repetitions < 1) benchmark_repetitions = 1;
+            break;
+        case 'w':
+            benchmark_warmups = atoi(optarg);
+            if (benchmark_warmups < 0) benchmark_warmups = 0;
+            break;
+        case 'o':
+            if (!report_set_format(optarg)) {
+                printf("Unknown output format %s (text, json or csv).\n", optarg);
+                return -1;
+            }
+            break;
         case 'v':
             verbose = true;
             break;
@@ -69,6 +100,7 @@ int main(int argc, char **argv) {
         return -1;
     }
     char *dirname = argv[optind];
+    report_record_flags(argc, argv, optind);
     size_t count;
 
     size_t *howmany = NULL;
@@ -97,13 +129,14 @@ int main(int argc, char **argv) {
     for (size_t i = 1; i < count; i++) {
        successivecard += howmany[i-1] + howmany[i];
     }
-    uint64_t cycles_start = 0, cycles_final = 0;
 
-    RDTSC_START(cycles_start);
-    bitset_t **bitmaps = create_all_bitmaps(howmany, numbers, count);
-    RDTSC_FINAL(cycles_final);
+    bitset_t **bitmaps = NULL;
+    BEGIN_SINGLE_PHASE(0)
+    bitmaps = create_all_bitmaps(howmany, numbers, count);
+    END_PHASE(0, data[13])
     if (bitmaps == NULL) return -1;
     if(verbose) printf("Loaded %d bitmaps from directory %s \n", (int)count, dirname);
+    if(verbose) printf("Building the bitmaps took %" PRIu64 " cycles\n", data[13]);
     uint64_t totalsize = 0;
     for (int i = 0; i < (int) count; ++i) {
         totalsize += bitset_size_in_bytes(bitmaps[i]);
@@ -118,31 +151,31 @@ int main(int argc, char **argv) {
     uint64_t total_or = 0;
     uint64_t total_count = 0;
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(1)
+    successive_and = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         bitset_t *tempand = bitset_copy(bitmaps[i]);
         bitset_inplace_intersection(tempand,bitmaps[i + 1]);
         successive_and += bitset_count(tempand);
         bitset_free(tempand);
     }
-    RDTSC_FINAL(cycles_final);
-    data[1] = cycles_final - cycles_start;
+    END_PHASE(1, data[1])
 
     if(verbose) printf("Successive intersections on %zu bitmaps took %" PRIu64 " cycles\n", count,
-           cycles_final - cycles_start);
+           data[1]);
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(2)
+    successive_or = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         bitset_t *tempor = bitset_copy(bitmaps[i]);
         if(!bitset_inplace_union(tempor,bitmaps[i + 1])) printf("failed to compute union");
         successive_or += bitset_count(tempor);
         bitset_free(tempor);
     }
-    RDTSC_FINAL(cycles_final);
+    END_PHASE(2, data[2])
     if(verbose) printf("Successive unions on %zu bitmaps took %" PRIu64 " cycles\n", count,
-           cycles_final - cycles_start);
-    data[2] = cycles_final - cycles_start;
-    RDTSC_START(cycles_start);
+           data[2]);
+    BEGIN_PHASE(3)
     if(count>1){
       bitset_t * totalorbitmap = bitset_copy(bitmaps[0]);
       for(size_t i = 1; i < count; ++i) {
@@ -151,12 +184,11 @@ int main(int argc, char **argv) {
       total_or = bitset_count(totalorbitmap);
       bitset_free(totalorbitmap);
     }
-    RDTSC_FINAL(cycles_final);
+    END_PHASE(3, data[3])
     if(verbose) printf("Total unions on %zu bitmaps took %" PRIu64 " cycles\n", count,
-           cycles_final - cycles_start);
-    data[3] = cycles_final - cycles_start;
+           data[3]);
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(4)
     if(count>1){
       bitset_t **sortedbitmaps = (bitset_t**) malloc(sizeof(bitset_t *) * count);
       memcpy(sortedbitmaps, bitmaps, sizeof(bitset_t *) * count);
@@ -169,51 +201,51 @@ int main(int argc, char **argv) {
       bitset_free(totalorbitmap);
       free(sortedbitmaps);
     }
-    RDTSC_FINAL(cycles_final);
+    END_PHASE(4, data[4])
     if(verbose) printf("Total sorted unions on %zu bitmaps took %" PRIu64 " cycles\n", count,
-           cycles_final - cycles_start);
-    data[4] = cycles_final - cycles_start;
+           data[4]);
 
-    uint64_t quartcount;
-    STARTBEST(quartile_test_repetitions)
+    uint64_t quartcount = 0;
+    BEGIN_REPEATED_PHASE(5, quartile_test_repetitions)
     quartcount = 0;
     for (size_t i = 0; i < count ; ++i) {
       quartcount += bitset_get(bitmaps[i],maxvalue/4);
       quartcount += bitset_get(bitmaps[i],maxvalue/2);
       quartcount += bitset_get(bitmaps[i],3*maxvalue/4);
     }
-    ENDBEST(data[5])
+    END_PHASE(5, data[5])
 
     if(verbose) printf("Quartile queries on %zu bitmaps took %" PRIu64 " cycles\n", count,
            data[5]);
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(6)
+    successive_andnot = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         bitset_t *tempandnot = bitset_copy(bitmaps[i]);
         bitset_inplace_difference(tempandnot,bitmaps[i + 1]);
         successive_andnot += bitset_count(tempandnot);
         bitset_free(tempandnot);
     }
-    RDTSC_FINAL(cycles_final);
-    data[6] = cycles_final - cycles_start;
+    END_PHASE(6, data[6])
 
     if(verbose) printf("Successive differences on %zu bitmaps took %" PRIu64 " cycles\n", count,
-           cycles_final - cycles_start);
+           data[6]);
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(7)
+    successive_xor = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         bitset_t *tempxor = bitset_copy(bitmaps[i]);
         bitset_inplace_symmetric_difference(tempxor,bitmaps[i + 1]);
         successive_xor += bitset_count(tempxor);
         bitset_free(tempxor);
     }
-    RDTSC_FINAL(cycles_final);
-    data[7] = cycles_final - cycles_start;
+    END_PHASE(7, data[7])
 
     if(verbose) printf("Successive symmetric differences on %zu bitmaps took %" PRIu64 " cycles\n", count,
-           cycles_final - cycles_start);
+           data[7]);
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(8)
+    total_count = 0;
     for (size_t i = 0; i < count; ++i) {
         bitset_t * b = bitmaps[i];
         bitset_for_each(b,increment,&total_count);
@@ -221,12 +253,11 @@ int main(int argc, char **argv) {
         //    total_count++;
         //}
     }
-    RDTSC_FINAL(cycles_final);
-    data[8] = cycles_final - cycles_start;
+    END_PHASE(8, data[8])
     assert(total_count == totalcard);
 
     if(verbose) printf("Iterating over %zu bitmaps took %" PRIu64 " cycles\n", count,
-           cycles_final - cycles_start);
+           data[8]);
 
     if(verbose) printf("Collected stats  %" PRIu64 "  %" PRIu64 "  %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 "\n",successive_and,successive_or,successive_andnot,successive_xor,total_or,quartcount);
 
@@ -240,33 +271,33 @@ int main(int argc, char **argv) {
     uint64_t successive_andnotcard = 0;
     uint64_t successive_xorcard = 0;
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(9)
+    successive_andcard = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         successive_andcard += bitset_intersection_count(bitmaps[i], bitmaps[i + 1]);
     }
-    RDTSC_FINAL(cycles_final);
-    data[9] = cycles_final - cycles_start;
+    END_PHASE(9, data[9])
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(10)
+    successive_orcard = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         successive_orcard += bitset_union_count(bitmaps[i], bitmaps[i + 1]);
     }
-    RDTSC_FINAL(cycles_final);
-    data[10] = cycles_final - cycles_start;
+    END_PHASE(10, data[10])
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(11)
+    successive_andnotcard = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         successive_andnotcard += bitset_difference_count(bitmaps[i], bitmaps[i + 1]);
     }
-    RDTSC_FINAL(cycles_final);
-    data[11] = cycles_final - cycles_start;
+    END_PHASE(11, data[11])
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(12)
+    successive_xorcard = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         successive_xorcard += bitset_symmetric_difference_count(bitmaps[i], bitmaps[i + 1]);
     }
-    RDTSC_FINAL(cycles_final);
-    data[12] = cycles_final - cycles_start;
+    END_PHASE(12, data[12])
 
     assert(successive_andcard == successive_and);
     assert(successive_orcard == successive_or);
@@ -276,21 +307,12 @@ int main(int argc, char **argv) {
     /**
     * end and, or, andnot and xor cardinality
     */
-    printf(" %20.2f %20.2f %20.2f %20.2f %20.2f %20.2f  %20.2f  %20.2f     %20.2f    %20.2f  %20.2f  %20.2f  %20.2f\n",
-      data[0]*8.0/totalcard,
-      data[1]*1.0/successivecard,
-      data[2]*1.0/successivecard,
-      data[3]*1.0/totalcard,
-      data[4]*1.0/totalcard,
-      data[5]*1.0/(3*count),
-      data[6]*1.0/successivecard,
-      data[7]*1.0/successivecard,
-      data[8]*1.0/totalcard,
-      data[9]*1.0/successivecard,
-      data[10]*1.0/successivecard,
-      data[11]*1.0/successivecard,
-      data[12]*1.0/successivecard
-    );
+    report_cardinalities(successive_and, successive_or, total_or, quartcount,
+                         successive_andnot, successive_xor, total_count);
+    benchmark_report(report_basename(argv[0]), dirname, data, 14, count,
+                     totalcard, successivecard);
+    perf_counters_print();
+    phase_stats_print();
     for (int i = 0; i < (int)count; ++i) {
         free(numbers[i]);
         numbers[i] = NULL;  // paranoid
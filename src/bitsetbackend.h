@@ -0,0 +1,284 @@
+#ifndef INCLUDE_BITSETBACKEND_H
+#define INCLUDE_BITSETBACKEND_H
+
+/*
+ * Backend over cbitset (uncompressed bitsets), as in bitset_benchmarks.
+ * cbitset/src/bitset.c is compiled separately as C and linked in.
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include "bitmapbackend.h"
+extern "C" {
+#include "bitset.h"
+}
+
+struct bitset_backend {
+    typedef bitset_t *bitmap;
+
+    static const char *name() { return "bitset"; }
+
+    static void build(bitmap &b, const uint32_t *values, size_t n) {
+        uint32_t biggest = (n > 0) ? values[n - 1] : 0;
+        b = bitset_create_with_capacity(biggest + 1);
+        // the capacity holds all values: set the words directly
+        for (size_t j = 0; j < n; ++j) {
+            b->array[values[j] >> 6] |= UINT64_C(1) << (values[j] & 63);
+        }
+    }
+
+    static void release(bitmap &b) {
+        bitset_free(b);
+        b = NULL;
+    }
+
+    static uint64_t size_in_bytes(const bitmap &b) {
+        return bitset_size_in_bytes(b);
+    }
+
+    static uint64_t and_op(const bitmap &a, const bitmap &b) {
+        bitset_t *tempand = bitset_copy(a);
+        bitset_inplace_intersection(tempand, b);
+        uint64_t card = bitset_count(tempand);
+        bitset_free(tempand);
+        return card;
+    }
+
+    static uint64_t or_op(const bitmap &a, const bitmap &b) {
+        bitset_t *tempor = bitset_copy(a);
+        if(!bitset_inplace_union(tempor, b)) printf("failed to compute union");
+        uint64_t card = bitset_count(tempor);
+        bitset_free(tempor);
+        return card;
+    }
+
+    static uint64_t andnot_op(const bitmap &a, const bitmap &b) {
+        bitset_t *tempandnot = bitset_copy(a);
+        bitset_inplace_difference(tempandnot, b);
+        uint64_t card = bitset_count(tempandnot);
+        bitset_free(tempandnot);
+        return card;
+    }
+
+    static uint64_t xor_op(const bitmap &a, const bitmap &b) {
+        bitset_t *tempxor = bitset_copy(a);
+        bitset_inplace_symmetric_difference(tempxor, b);
+        uint64_t card = bitset_count(tempxor);
+        bitset_free(tempxor);
+        return card;
+    }
+
+    static uint64_t and_count(const bitmap &a, const bitmap &b) {
+        return bitset_intersection_count(a, b);
+    }
+
+    static uint64_t or_count(const bitmap &a, const bitmap &b) {
+        return bitset_union_count(a, b);
+    }
+
+    static uint64_t andnot_count(const bitmap &a, const bitmap &b) {
+        return bitset_difference_count(a, b);
+    }
+
+    static uint64_t xor_count(const bitmap &a, const bitmap &b) {
+        return bitset_symmetric_difference_count(a, b);
+    }
+
+    static uint64_t wide_or(const std::vector<bitmap> &all) {
+        if (all.empty()) return 0;
+        bitset_t *totalorbitmap = bitset_copy(all[0]);
+        for (size_t i = 1; i < all.size(); ++i) {
+            if(!bitset_inplace_union(totalorbitmap, all[i])) printf("failed to compute union");
+        }
+        uint64_t card = bitset_count(totalorbitmap);
+        bitset_free(totalorbitmap);
+        return card;
+    }
+
+    // union in increasing order of size, as bitset_benchmarks does
+    static uint64_t wide_or_heap(const std::vector<bitmap> &all) {
+        if (all.empty()) return 0;
+        std::vector<bitset_t *> sortedbitmaps(all);
+        std::sort(sortedbitmaps.begin(), sortedbitmaps.end(),
+                  [](const bitset_t *x, const bitset_t *y) {
+                      return bitset_size_in_bytes(x) < bitset_size_in_bytes(y);
+                  });
+        bitset_t *totalorbitmap = bitset_copy(sortedbitmaps[0]);
+        for (size_t i = 1; i < sortedbitmaps.size(); ++i) {
+            if(!bitset_inplace_union(totalorbitmap, sortedbitmaps[i])) printf("failed to compute union");
+        }
+        uint64_t card = bitset_count(totalorbitmap);
+        bitset_free(totalorbitmap);
+        return card;
+    }
+
+    // in place, starting from the shortest bitset: the intersection is no
+    // longer than it
+    static uint64_t wide_and(const bitmap *first, size_t n) {
+        std::vector<bitset_t *> sortedbitmaps(first, first + n);
+        std::sort(sortedbitmaps.begin(), sortedbitmaps.end(),
+                  [](const bitset_t *x, const bitset_t *y) {
+                      return bitset_size_in_bytes(x) < bitset_size_in_bytes(y);
+                  });
+        bitset_t *tempand = bitset_copy(sortedbitmaps[0]);
+        for (size_t i = 1; i < n; ++i) {
+            bitset_inplace_intersection(tempand, sortedbitmaps[i]);
+        }
+        uint64_t card = bitset_count(tempand);
+        bitset_free(tempand);
+        return card;
+    }
+
+    // bit-sliced counters over the words: slice j holds bit j of the number
+    // of bitsets that contain each value, and comparing the slices of a
+    // word with t gives the word of the result
+    static uint64_t threshold(const bitmap *first, size_t n, size_t t) {
+        size_t words = 0;
+        for (size_t i = 0; i < n; ++i) words = std::max(words, first[i]->arraysize);
+        size_t slicecount = 0;
+        while ((n >> slicecount) != 0) slicecount++;
+        std::vector<uint64_t> slices(words * slicecount, 0);  // by word
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t w = 0; w < first[i]->arraysize; ++w) {
+                uint64_t *slice = &slices[w * slicecount];
+                uint64_t carry = first[i]->array[w];
+                for (size_t j = 0; carry != 0; ++j) {
+                    uint64_t newcarry = slice[j] & carry;
+                    slice[j] ^= carry;
+                    carry = newcarry;
+                }
+            }
+        }
+        bitset_t *result = bitset_create_with_capacity(words * 64);
+        for (size_t w = 0; w < words; ++w) {
+            const uint64_t *slice = &slices[w * slicecount];
+            uint64_t greater = 0, equal = ~UINT64_C(0);
+            for (size_t j = slicecount; j-- > 0;) {
+                if ((t >> j) & 1) {
+                    equal &= slice[j];
+                } else {
+                    greater |= equal & slice[j];
+                    equal &= ~slice[j];
+                }
+            }
+            result->array[w] = greater | equal;
+        }
+        uint64_t card = bitset_count(result);
+        bitset_free(result);
+        return card;
+    }
+
+    // word w of b, restricted to [lo, hi)
+    static uint64_t range_word(const bitmap &b, size_t w, uint64_t lo, uint64_t hi) {
+        uint64_t word = b->array[w];
+        if (w == lo / 64) word &= ~UINT64_C(0) << (lo % 64);
+        if (w == (hi - 1) / 64) word &= ~UINT64_C(0) >> (63 - (hi - 1) % 64);
+        return word;
+    }
+
+    static uint64_t range_count(const bitmap &b, uint64_t lo, uint64_t hi) {
+        hi = std::min(hi, (uint64_t)b->arraysize * 64);
+        uint64_t card = 0;
+        for (size_t w = lo / 64; (lo < hi) && (w <= (hi - 1) / 64); ++w) {
+            card += __builtin_popcountll(range_word(b, w, lo, hi));
+        }
+        return card;
+    }
+
+    static bool range_intersects(const bitmap &b, uint64_t lo, uint64_t hi) {
+        hi = std::min(hi, (uint64_t)b->arraysize * 64);
+        for (size_t w = lo / 64; (lo < hi) && (w <= (hi - 1) / 64); ++w) {
+            if (range_word(b, w, lo, hi) != 0) return true;
+        }
+        return false;
+    }
+
+    static void range_values(const bitmap &b, uint64_t lo, uint64_t hi,
+                             std::vector<uint32_t> &out) {
+        hi = std::min(hi, (uint64_t)b->arraysize * 64);
+        for (size_t w = lo / 64; (lo < hi) && (w <= (hi - 1) / 64); ++w) {
+            for (uint64_t word = range_word(b, w, lo, hi); word != 0; word &= word - 1) {
+                out.push_back((uint32_t)(w * 64 + __builtin_ctzll(word)));
+            }
+        }
+    }
+
+    // the number of values before each block of RANK_BLOCK_WORDS words, and
+    // the total
+    typedef std::vector<uint32_t> rank_index;
+    static const size_t RANK_BLOCK_WORDS = 8;
+
+    static void build_rank_index(const bitmap &b, rank_index &idx) {
+        idx.clear();
+        uint32_t card = 0;
+        for (size_t w = 0; w < b->arraysize; ++w) {
+            if (w % RANK_BLOCK_WORDS == 0) idx.push_back(card);
+            card += __builtin_popcountll(b->array[w]);
+        }
+        idx.push_back(card);
+    }
+
+    static uint64_t rank_index_bytes(const bitmap &, const rank_index &idx) {
+        return idx.size() * sizeof(uint32_t);
+    }
+
+    static uint64_t rank(const bitmap &b, const rank_index &idx, uint32_t x) {
+        const size_t w = x / 64;
+        if (w >= b->arraysize) return idx.back();
+        uint64_t card = idx[w / RANK_BLOCK_WORDS];
+        for (size_t k = w - w % RANK_BLOCK_WORDS; k < w; ++k) {
+            card += __builtin_popcountll(b->array[k]);
+        }
+        return card + __builtin_popcountll(b->array[w] & (~UINT64_C(0) >> (63 - x % 64)));
+    }
+
+    static uint32_t select(const bitmap &b, const rank_index &idx, uint64_t i) {
+        // the last block starting with at most i values before it
+        const size_t block = std::upper_bound(idx.begin(), idx.end() - 1, (uint32_t)i) - idx.begin() - 1;
+        uint64_t rank = i - idx[block];
+        size_t w = block * RANK_BLOCK_WORDS;
+        while (true) {
+            const uint64_t ones = __builtin_popcountll(b->array[w]);
+            if (rank < ones) break;
+            rank -= ones;
+            w++;
+        }
+        uint64_t word = b->array[w];
+        for (; rank > 0; rank--) word &= word - 1;
+        return (uint32_t)(w * 64 + __builtin_ctzll(word));
+    }
+
+    // the bitset grows as needed
+    static void add(bitmap &b, uint32_t value) { bitset_set(b, value); }
+
+    static void remove(bitmap &b, uint32_t value) {
+        if (value / 64 < b->arraysize) bitset_set_to_value(b, value, false);
+    }
+
+    static void add_many(bitmap &b, const uint32_t *values, size_t n) {
+        for (size_t j = 0; j < n; ++j) bitset_set(b, values[j]);
+    }
+
+    static void optimize(bitmap &b) { bitset_trim(b); }
+
+    static bool contains(const bitmap &b, uint32_t value) {
+        return bitset_get(b, value);
+    }
+
+    static bool increment(size_t value, void *param) {
+        (void)value;
+        (*(uint64_t *)param)++;
+        return true;
+    }
+
+    static uint64_t iterate(const bitmap &b) {
+        uint64_t card = 0;
+        bitset_for_each(b, increment, &card);
+        return card;
+    }
+};
+
+REGISTER_BACKEND(bitset_backend)
+
+#endif
@@ -6,83 +6,169 @@
 #include <string.h>
 #include <stdint.h>
 
-size_t malloced_memory_usage = 0;
+#include "memcounters.h"
+
+/*
+ * We intercept malloc and friends, count through memcounters.h (so that
+ * threads can allocate concurrently) and forward to the next definitions,
+ * normally those of libc. Each block starts with a header holding a cookie
+ * and the requested size. Blocks aligned beyond 16 bytes have a different
+ * cookie and, before the header, their offset from the block libc gave us.
+ */
 
 size_t myalloc_cookie = 123456; // we can't easily prevent some free calls from coming to us from outside, mark them
+size_t myalloc_aligned_cookie = 654321;
 
-void* malloc(size_t sz) {
-    void *(*libc_malloc)(size_t) = dlsym(RTLD_NEXT, "malloc");
-    void * answerplus =  libc_malloc(sz + sizeof(size_t) + sizeof(myalloc_cookie) );
-    if(answerplus == NULL) return answerplus;// nothing can be done
-    malloced_memory_usage += sz;
-    memcpy(answerplus ,&myalloc_cookie,sizeof(myalloc_cookie));
-    memcpy((char *) answerplus + sizeof(myalloc_cookie),&sz,sizeof(sz));
-    return ((char *) answerplus) + sizeof(size_t) + sizeof(myalloc_cookie);
+#define MYALLOC_HEADER (sizeof(size_t) + sizeof(myalloc_cookie))
+
+// lets benchmark.h attribute the allocations to the measured phases
+#define MALLOC_COUNTERS 1
+
+// the libc functions, looked up once
+static void *(*libc_malloc)(size_t) = NULL;
+static void *(*libc_realloc)(void *, size_t) = NULL;
+static void (*libc_free)(void *) = NULL;
+static int (*libc_posix_memalign)(void **, size_t, size_t) = NULL;
+
+// dlsym may allocate: while it runs, we serve the requests from here
+static char myalloc_bootstrap[4096] __attribute__((aligned(16)));
+static size_t myalloc_bootstrap_used = 0;
+static bool myalloc_resolving = false;
+
+static void *myalloc_bootstrap_alloc(size_t sz) {
+    sz = (sz + 15) & ~(size_t)15;
+    if(myalloc_bootstrap_used + sz > sizeof(myalloc_bootstrap)) return NULL;
+    void * answer = myalloc_bootstrap + myalloc_bootstrap_used;
+    myalloc_bootstrap_used += sz;
+    return answer; // zeroed, never reused
 }
 
+static bool myalloc_in_bootstrap(const void *p) {
+    return ((const char *) p >= myalloc_bootstrap) && ((const char *) p < myalloc_bootstrap + sizeof(myalloc_bootstrap));
+}
 
-// can fail to produce an aligned result if alignment does not divide 2 * size_t
-int posix_memalign(void **memptr, size_t alignment, size_t size) {
-    int(*libc_posix_memalign)(void **, size_t, size_t) = dlsym(RTLD_NEXT, "posix_memalign");
-    size_t offset = (sizeof(size_t) + sizeof(myalloc_cookie) );
-    void * answerplus;
-    int ret = libc_posix_memalign(&answerplus,alignment, size + offset);
-    if(ret) return ret;// nothing can be done
-    malloced_memory_usage += size;
-    memcpy(answerplus ,&myalloc_cookie,sizeof(myalloc_cookie));
-    memcpy((char *) answerplus + sizeof(myalloc_cookie),&size,sizeof(size));
-    * memptr = (char *) answerplus + offset;
-    return ret;
+static void myalloc_resolve(void) {
+    myalloc_resolving = true;
+    libc_malloc = (void *(*)(size_t)) dlsym(RTLD_NEXT, "malloc");
+    libc_realloc = (void *(*)(void *, size_t)) dlsym(RTLD_NEXT, "realloc");
+    libc_free = (void (*)(void *)) dlsym(RTLD_NEXT, "free");
+    libc_posix_memalign = (int (*)(void **, size_t, size_t)) dlsym(RTLD_NEXT, "posix_memalign");
+    myalloc_resolving = false;
+}
+
+// the total requested and not yet freed
+static inline size_t malloced_memory_usage(void) {
+    return (size_t) memcounters_read().usage;
+}
+
+static void *myalloc_mark(void *answerplus, size_t cookie, size_t sz) {
+    memcounters_allocate(sz);
+    memcpy(answerplus ,&cookie,sizeof(cookie));
+    memcpy((char *) answerplus + sizeof(cookie),&sz,sizeof(sz));
+    return ((char *) answerplus) + MYALLOC_HEADER;
+}
+
+void* malloc(size_t sz) {
+    if(libc_malloc == NULL) {
+        if(myalloc_resolving) return myalloc_bootstrap_alloc(sz);
+        myalloc_resolve();
+    }
+    void * answerplus =  libc_malloc(sz + MYALLOC_HEADER);
+    if(answerplus == NULL) return answerplus;// nothing can be done
+    return myalloc_mark(answerplus, myalloc_cookie, sz);
 }
 
 void * calloc(size_t count, size_t size) {
     size_t sz = count * size;
-    void *(*libc_malloc)(size_t) = dlsym(RTLD_NEXT, "malloc");
-    size_t volume = sz + sizeof(size_t) + sizeof(myalloc_cookie);
+    if(libc_malloc == NULL) {
+        if(myalloc_resolving) return myalloc_bootstrap_alloc(sz);
+        myalloc_resolve();
+    }
+    size_t volume = sz + MYALLOC_HEADER;
     void * answerplus =  libc_malloc(volume);
-    memset(answerplus,0,volume);
     if(answerplus == NULL) return answerplus;// nothing can be done
-    malloced_memory_usage += sz;
-    memcpy(answerplus ,&myalloc_cookie,sizeof(myalloc_cookie));
-    memcpy((char *) answerplus + sizeof(myalloc_cookie),&sz,sizeof(sz));
-    return ((char *) answerplus) + sizeof(size_t) + sizeof(myalloc_cookie);
+    memset(answerplus,0,volume);
+    return myalloc_mark(answerplus, myalloc_cookie, sz);
 }
 
-void free(void *p) {
-    if(p == NULL) return; // nothing to do
-    void (*libc_free)(void*) = dlsym(RTLD_NEXT, "free");
-    void * truep = ((char *) p) - sizeof(size_t) - sizeof(myalloc_cookie);
+// alignments up to 16 bytes come from malloc, others from posix_memalign,
+// with room for the header and the offset before the result
+static void *myalloc_aligned(size_t alignment, size_t size) {
+    if(alignment <= 16) return malloc(size);
+    if(libc_posix_memalign == NULL) myalloc_resolve();
+    void * answerplus;
+    if(libc_posix_memalign(&answerplus, alignment, size + alignment)) return NULL;// nothing can be done
+    memcpy((char *) answerplus + alignment - MYALLOC_HEADER - sizeof(size_t), &alignment, sizeof(alignment));
+    return myalloc_mark((char *) answerplus + alignment - MYALLOC_HEADER, myalloc_aligned_cookie, size);
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size) {
+    void * answer = myalloc_aligned(alignment, size);
+    if(answer == NULL) return 12; // ENOMEM
+    *memptr = answer;
+    return 0;
+}
+
+void * aligned_alloc(size_t alignment, size_t size) {
+    return myalloc_aligned(alignment, size);
+}
+
+void * memalign(size_t alignment, size_t size) {
+    return myalloc_aligned(alignment, size);
+}
+
+// the block libc gave us (NULL if it is not ours) and the requested size
+static void *myalloc_block(void *p, size_t *sz) {
+    void * truep = ((char *) p) - MYALLOC_HEADER;
     size_t cookie;
     // the cookie approach is kind of a hack, don't use in production code!
     memcpy(&cookie ,truep,sizeof(myalloc_cookie)); // in some case, this might read data outside of bounds
-    if(cookie != myalloc_cookie) {
+    if((cookie != myalloc_cookie) && (cookie != myalloc_aligned_cookie)) return NULL;
+    memcpy(sz,(char *) truep + sizeof(myalloc_cookie),sizeof(*sz));
+    if(cookie == myalloc_aligned_cookie) {
+        size_t alignment;
+        memcpy(&alignment, (char *) truep - sizeof(size_t), sizeof(alignment));
+        return (char *) p - alignment;
+    }
+    return truep;
+}
+
+void free(void *p) {
+    if(p == NULL) return; // nothing to do
+    if(myalloc_in_bootstrap(p)) return;
+    if(libc_free == NULL) myalloc_resolve();
+    size_t sz;
+    void * truep = myalloc_block(p, &sz);
+    if(truep == NULL) {
       libc_free(p);
       return;
     }
-    size_t sz;
-    memcpy(&sz,(char *) truep + sizeof(myalloc_cookie),sizeof(sz));
-    malloced_memory_usage -= sz;
+    memcounters_free(sz);
     libc_free(truep);
 }
 
 
 void* realloc(void *p, size_t sz) {
   if(p == NULL) return malloc(sz);
-  // implement
-  void *(*libc_realloc)(void *m,size_t) = dlsym(RTLD_NEXT, "realloc");
-  void * truep = ((char *) p) - sizeof(size_t) - sizeof(myalloc_cookie);
-  size_t cookie;
-  // the cookie approach is kind of a hack, don't use in production code!
-  memcpy(&cookie ,truep,sizeof(myalloc_cookie)); // in some case, this might read data outside of bounds
-  if(cookie != myalloc_cookie) {
-      return libc_realloc(p,sz);
-  }
+  if(libc_realloc == NULL) myalloc_resolve();
   size_t oldsz;
-  memcpy(&oldsz,(char *) truep + sizeof(myalloc_cookie),sizeof(sz));
-  malloced_memory_usage -= oldsz;
-  void * newp = libc_realloc(truep,sz +  sizeof(size_t) + sizeof(myalloc_cookie));
-  if(newp == NULL) return newp;// nothing can be done?
-  malloced_memory_usage += sz;
-  memcpy((char *) newp + sizeof(myalloc_cookie),&sz,sizeof(sz));
-  return newp + sizeof(size_t) + sizeof(myalloc_cookie);
+  if(myalloc_in_bootstrap(p)) {
+      // its size is unknown, but it fits in what remains of the buffer
+      oldsz = (size_t)(myalloc_bootstrap + sizeof(myalloc_bootstrap) - (char *) p);
+  } else {
+      void * truep = myalloc_block(p, &oldsz);
+      if(truep == NULL) return libc_realloc(p,sz);
+      if(truep == (char *) p - MYALLOC_HEADER) {
+          void * newp = libc_realloc(truep,sz + MYALLOC_HEADER);
+          if(newp == NULL) return newp;// nothing can be done?
+          memcounters_free(oldsz);
+          return myalloc_mark(newp, myalloc_cookie, sz);
+      }
+  }
+  // a bootstrap or aligned block: we move it
+  void * newp = malloc(sz);
+  if(newp == NULL) return newp;// nothing can be done
+  memcpy(newp, p, oldsz < sz ? oldsz : sz);
+  free(p);
+  return newp;
 }
@@ -0,0 +1,203 @@
+#ifndef INCLUDE_CONCISEBACKEND_H
+#define INCLUDE_CONCISEBACKEND_H
+
+/*
+ * Backends over the Concise library, in its WAH and CONCISE flavours, as
+ * in wah32_benchmarks and concise_benchmarks.
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include "bitmapbackend.h"
+#include "concise.h" /* from Concise library */
+
+template <bool wahmode>
+struct concise_backend {
+    typedef ConciseSet<wahmode> bitmap;
+
+    static const char *name() { return wahmode ? "wah32" : "concise"; }
+
+    static void build(bitmap &b, const uint32_t *values, size_t n) {
+        for (size_t j = 0; j < n; ++j) {
+            b.add(values[j]);
+        }
+        b.compact();
+        assert(b.size() == n);
+    }
+
+    static void release(bitmap &b) { bitmap().swap(b); }
+
+    static uint64_t size_in_bytes(const bitmap &b) {
+        return b.sizeInBytes(); // should be close enough to memory usage
+    }
+
+    static uint64_t and_op(const bitmap &a, const bitmap &b) {
+        bitmap tempand = a.logicaland(b);
+        return tempand.size();
+    }
+
+    static uint64_t or_op(const bitmap &a, const bitmap &b) {
+        bitmap tempor = a.logicalor(b);
+        return tempor.size();
+    }
+
+    static uint64_t andnot_op(const bitmap &a, const bitmap &b) {
+        bitmap tempandnot = a.logicalandnot(b);
+        return tempandnot.size();
+    }
+
+    static uint64_t xor_op(const bitmap &a, const bitmap &b) {
+        bitmap tempxor = a.logicalxor(b);
+        return tempxor.size();
+    }
+
+    static uint64_t and_count(const bitmap &a, const bitmap &b) {
+        return a.logicalandCount(b);
+    }
+
+    static uint64_t or_count(const bitmap &a, const bitmap &b) {
+        return a.logicalorCount(b);
+    }
+
+    static uint64_t andnot_count(const bitmap &a, const bitmap &b) {
+        return a.logicalandnotCount(b);
+    }
+
+    static uint64_t xor_count(const bitmap &a, const bitmap &b) {
+        return a.logicalxorCount(b);
+    }
+
+    static uint64_t wide_or(const std::vector<bitmap> &all) {
+        if (all.size() < 2) return all.empty() ? 0 : all[0].size();
+        bitmap totalorbitmap = all[0].logicalor(all[1]);
+        for (size_t i = 2; i < all.size(); ++i) {
+          bitmap tmp = totalorbitmap.logicalor(all[i]);
+          totalorbitmap.swap(tmp);
+        }
+        return totalorbitmap.size();
+    }
+
+    static uint64_t wide_or_heap(const std::vector<bitmap> &all) {
+        if (all.size() < 2) return all.empty() ? 0 : all[0].size();
+        std::vector<const bitmap *> allofthem(all.size());
+        for (size_t i = 0; i < all.size(); ++i) allofthem[i] = &all[i];
+        bitmap totalorbitmap = bitmap::fast_logicalor(all.size(), allofthem.data());
+        return totalorbitmap.size();
+    }
+
+    // the most compressed bitmaps first, since the cost of each step grows
+    // with the compressed sizes
+    static uint64_t wide_and(const bitmap *first, size_t n) {
+        std::vector<const bitmap *> sorted(n);
+        for (size_t i = 0; i < n; ++i) sorted[i] = &first[i];
+        std::sort(sorted.begin(), sorted.end(), [](const bitmap *x, const bitmap *y) {
+            return x->sizeInBytes() < y->sizeInBytes();
+        });
+        if (n == 1) return sorted[0]->size();
+        bitmap tempand = sorted[0]->logicaland(*sorted[1]);
+        for (size_t i = 2; i < n; ++i) {
+          bitmap tmp = tempand.logicaland(*sorted[i]);
+          tempand.swap(tmp);
+        }
+        return tempand.size();
+    }
+
+    struct sliced_ops {
+        typedef ConciseSet<wahmode> bitmap;
+        static void and_op(const bitmap &a, const bitmap &b, bitmap &out) { out = a.logicaland(b); }
+        static void or_op(const bitmap &a, const bitmap &b, bitmap &out) { out = a.logicalor(b); }
+        static void andnot_op(const bitmap &a, const bitmap &b, bitmap &out) { out = a.logicalandnot(b); }
+        static void xor_op(const bitmap &a, const bitmap &b, bitmap &out) { out = a.logicalxor(b); }
+        static uint64_t cardinality(const bitmap &b) { return b.size(); }
+    };
+
+    // bit-sliced counters
+    static uint64_t threshold(const bitmap *first, size_t n, size_t t) {
+        return bit_sliced_threshold<sliced_ops>(first, n, t);
+    }
+
+    // the compressed stream has no random access: decode from the start
+    static uint64_t range_count(const bitmap &b, uint64_t lo, uint64_t hi) {
+        uint64_t card = 0;
+        for (auto j = b.begin(); (j != b.end()) && (*j < hi); ++j) {
+            card += (*j >= lo);
+        }
+        return card;
+    }
+
+    static bool range_intersects(const bitmap &b, uint64_t lo, uint64_t hi) {
+        for (auto j = b.begin(); (j != b.end()) && (*j < hi); ++j) {
+            if (*j >= lo) return true;
+        }
+        return false;
+    }
+
+    static void range_values(const bitmap &b, uint64_t lo, uint64_t hi,
+                             std::vector<uint32_t> &out) {
+        for (auto j = b.begin(); (j != b.end()) && (*j < hi); ++j) {
+            if (*j >= lo) out.push_back((uint32_t)*j);
+        }
+    }
+
+    // decode from the start
+    static uint64_t rank(const bitmap &b, uint32_t x) {
+        uint64_t card = 0;
+        for (auto j = b.begin(); (j != b.end()) && (*j <= x); ++j) card++;
+        return card;
+    }
+
+    static uint32_t select(const bitmap &b, uint64_t i) {
+        auto j = b.begin();
+        for (; i > 0; --i) ++j;
+        return (uint32_t)*j;
+    }
+
+    // a union with (or a difference from) a new bitmap
+    static void add(bitmap &b, uint32_t value) {
+        bitmap single;
+        single.add(value);
+        bitmap tmp = b.logicalor(single);
+        tmp.swap(b);
+    }
+
+    static void remove(bitmap &b, uint32_t value) {
+        bitmap single;
+        single.add(value);
+        bitmap tmp = b.logicalandnot(single);
+        tmp.swap(b);
+    }
+
+    static void add_many(bitmap &b, const uint32_t *values, size_t n) {
+        std::vector<uint32_t> sorted(values, values + n);
+        std::sort(sorted.begin(), sorted.end());
+        bitmap added;
+        for (size_t j = 0; j < n; ++j) {
+            if ((j == 0) || (sorted[j] != sorted[j - 1])) added.add(sorted[j]);
+        }
+        bitmap tmp = b.logicalor(added);
+        tmp.swap(b);
+    }
+
+    static void optimize(bitmap &b) { b.compact(); }
+
+    static bool contains(const bitmap &b, uint32_t value) {
+        return b.contains(value);
+    }
+
+    static uint64_t iterate(const bitmap &b) {
+        uint64_t card = 0;
+        for (auto j = b.begin(); j != b.end(); ++j) {
+            card++;
+        }
+        return card;
+    }
+};
+
+typedef concise_backend<true> wah32_backend;
+typedef concise_backend<false> concise_plain_backend;
+
+REGISTER_BACKEND(wah32_backend)
+REGISTER_BACKEND(concise_plain_backend)
+
+#endif
@@ -0,0 +1,373 @@
+#ifndef INCLUDE_ELIASFANO_H
+#define INCLUDE_ELIASFANO_H
+
+/*
+ * Elias-Fano encoding of a sorted set of 32-bit integers, for
+ * eliasfano_benchmarks. With n values up to u, each value is split into
+ * its l = floor(log2(u / n)) low bits, stored packed, and its high bits,
+ * stored in unary as a bit vector of about 2n bits: value i sets bit
+ * (value >> l) + i. That is at most 2 + ceil(log2(u / n)) bits per value.
+ *
+ * To skip ahead, we keep the position of every EF_SKIP_QUANTUM-th zero of
+ * the high bits: the zero of rank h comes right after the values whose
+ * high bits are at most h, so that moving to the first value at least x
+ * takes a lookup and a scan of a few words. Intersections, membership queries
+ * and differences skip; everything else decodes sequentially.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+#define EF_SKIP_QUANTUM 256
+
+typedef struct elias_fano_s {
+    uint64_t n;            // number of values
+    uint32_t lowbits;      // l
+    uint64_t *low;         // n values of l bits
+    uint64_t *high;        // n + (max >> l) + 1 bits
+    uint64_t zeros;        // number of zeros in high: (max >> l) + 1
+    uint64_t *skip;        // skip[k]: position of the zero of rank k * EF_SKIP_QUANTUM
+    uint64_t lowwords, highwords, skips;
+} elias_fano_t;
+
+static inline void ef_init_empty(elias_fano_t *ef) {
+    memset(ef, 0, sizeof(*ef));
+}
+
+/*
+ * Encode n sorted, distinct values.
+ */
+static inline void ef_build(elias_fano_t *ef, const uint32_t *values, size_t n) {
+    ef_init_empty(ef);
+    if (n == 0) return;
+    const uint64_t universe = (uint64_t)values[n - 1] + 1;
+    uint32_t l = 0;
+    if (universe > n) l = 63 - __builtin_clzll(universe / n);
+    if (l > 31) l = 31;  // a single large value
+    ef->n = n;
+    ef->lowbits = l;
+    ef->zeros = (values[n - 1] >> l) + 1;
+    ef->lowwords = (n * l + 63) / 64 + 1;  // one more word, so that reads never run past the end
+    ef->highwords = (n + ef->zeros + 63) / 64 + 1;
+    ef->skips = (ef->zeros + EF_SKIP_QUANTUM - 1) / EF_SKIP_QUANTUM;
+    ef->low = (uint64_t *)calloc(ef->lowwords, sizeof(uint64_t));
+    ef->high = (uint64_t *)calloc(ef->highwords, sizeof(uint64_t));
+    ef->skip = (uint64_t *)malloc(ef->skips * sizeof(uint64_t));
+    const uint64_t lowmask = (l == 0) ? 0 : ((1ULL << l) - 1);
+    for (size_t i = 0; i < n; i++) {
+        const uint64_t lowpart = values[i] & lowmask;
+        const uint64_t bitpos = i * l;
+        if (l > 0) {
+            ef->low[bitpos >> 6] |= lowpart << (bitpos & 63);
+            if ((bitpos & 63) + l > 64) {
+                ef->low[(bitpos >> 6) + 1] |= lowpart >> (64 - (bitpos & 63));
+            }
+        }
+        const uint64_t highpos = (uint64_t)(values[i] >> l) + i;
+        ef->high[highpos >> 6] |= 1ULL << (highpos & 63);
+    }
+    // the zero of rank h comes right after the values whose high bits are
+    // at most h
+    size_t upto = 0;
+    for (uint64_t k = 0; k < ef->skips; k++) {
+        const uint64_t h = k * EF_SKIP_QUANTUM;
+        while ((upto < n) && ((uint64_t)(values[upto] >> l) <= h)) upto++;
+        ef->skip[k] = h + upto;
+    }
+}
+
+static inline void ef_free(elias_fano_t *ef) {
+    free(ef->low);
+    free(ef->high);
+    free(ef->skip);
+    ef_init_empty(ef);
+}
+
+static inline uint64_t ef_size_in_bytes(const elias_fano_t *ef) {
+    return sizeof(elias_fano_t) +
+           (ef->lowwords + ef->highwords + ef->skips) * sizeof(uint64_t);
+}
+
+static inline uint32_t ef_low(const elias_fano_t *ef, uint64_t i) {
+    const uint32_t l = ef->lowbits;
+    if (l == 0) return 0;
+    const uint64_t bitpos = i * l;
+    const uint64_t shift = bitpos & 63;
+    uint64_t bits = ef->low[bitpos >> 6] >> shift;
+    if (shift + l > 64) bits |= ef->low[(bitpos >> 6) + 1] << (64 - shift);
+    return (uint32_t)(bits & ((1ULL << l) - 1));
+}
+
+// position of the set bit of rank k (0-based) in word
+static inline uint32_t ef_select_in_word(uint64_t word, uint32_t k) {
+#ifdef __BMI2__
+    return (uint32_t)_tzcnt_u64(_pdep_u64(1ULL << k, word));
+#else
+    for (; k > 0; k--) word &= word - 1;
+    return (uint32_t)__builtin_ctzll(word);
+#endif
+}
+
+// position in the high bits of the zero of rank h < ef->zeros
+static inline uint64_t ef_select_zero(const elias_fano_t *ef, uint64_t h) {
+    const uint64_t pos = ef->skip[h / EF_SKIP_QUANTUM];
+    uint64_t rank = h % EF_SKIP_QUANTUM;  // among the zeros at pos or after
+    uint64_t w = pos >> 6;
+    uint64_t word = ~ef->high[w] & (~0ULL << (pos & 63));
+    while (true) {
+        const uint64_t zeros = (uint64_t)__builtin_popcountll(word);
+        if (rank < zeros) return w * 64 + ef_select_in_word(word, (uint32_t)rank);
+        rank -= zeros;
+        word = ~ef->high[++w];
+    }
+}
+
+/*
+ * A cursor over the values, in increasing order.
+ */
+typedef struct ef_iterator_s {
+    const elias_fano_t *ef;
+    uint64_t index;     // of the current value
+    uint64_t wordindex; // word of high holding the next set bits
+    uint64_t buffer;    // its set bits that are still ahead
+    uint32_t value;
+    bool valid;
+} ef_iterator_t;
+
+// move to the next set bit of the high bits, which holds value index
+static inline void ef_iterator_read(ef_iterator_t *it) {
+    while (it->buffer == 0) it->buffer = it->ef->high[++it->wordindex];
+    const uint64_t pos = it->wordindex * 64 + (uint64_t)__builtin_ctzll(it->buffer);
+    it->buffer &= it->buffer - 1;
+    it->value = (uint32_t)(((pos - it->index) << it->ef->lowbits) |
+                           ef_low(it->ef, it->index));
+}
+
+static inline void ef_iterator_init(ef_iterator_t *it, const elias_fano_t *ef) {
+    it->ef = ef;
+    it->index = 0;
+    it->wordindex = 0;
+    it->buffer = 0;
+    it->value = 0;
+    it->valid = (ef->n > 0);
+    if (!it->valid) return;
+    it->buffer = ef->high[0];
+    ef_iterator_read(it);
+}
+
+static inline void ef_iterator_next(ef_iterator_t *it) {
+    if (++it->index >= it->ef->n) {
+        it->valid = false;
+        return;
+    }
+    ef_iterator_read(it);
+}
+
+/*
+ * Move to the first value at least x, if any (never backward). Close
+ * targets are reached by decoding; far ones through the skip pointers.
+ */
+static inline void ef_iterator_skip_to(ef_iterator_t *it, uint32_t x) {
+    if (!it->valid || (it->value >= x)) return;
+    const elias_fano_t *ef = it->ef;
+    const uint64_t h = x >> ef->lowbits;
+    if (h >= ef->zeros) {  // beyond the largest value
+        it->valid = false;
+        return;
+    }
+    if (h > (uint64_t)(it->value >> ef->lowbits) + 1) {
+        // the values after the zero of rank h - 1 have high bits at least h
+        const uint64_t pos = ef_select_zero(ef, h - 1);
+        const uint64_t index = pos - (h - 1);
+        if (index > it->index) {
+            if (index >= ef->n) {
+                it->valid = false;
+                return;
+            }
+            it->index = index;
+            it->wordindex = (pos + 1) >> 6;
+            it->buffer = ef->high[it->wordindex] & (~0ULL << ((pos + 1) & 63));
+            ef_iterator_read(it);
+        }
+    }
+    while (it->valid && (it->value < x)) ef_iterator_next(it);
+}
+
+static inline bool ef_contains(const elias_fano_t *ef, uint32_t x) {
+    ef_iterator_t it;
+    ef_iterator_init(&it, ef);
+    ef_iterator_skip_to(&it, x);
+    return it.valid && (it.value == x);
+}
+
+/*
+ * Rank and select. The skip pointers serve rank (the values less than x end
+ * at a zero of the high bits); select needs samples of the ones, kept apart
+ * since only rank/select queries use them: ef_select_samples(ef) words,
+ * the position of the one of rank k * EF_SKIP_QUANTUM in samples[k].
+ */
+static inline uint64_t ef_rank(const elias_fano_t *ef, uint32_t x) {  // values <= x
+    if (x == UINT32_MAX) return ef->n;
+    ef_iterator_t it;
+    ef_iterator_init(&it, ef);
+    ef_iterator_skip_to(&it, x + 1);
+    return it.valid ? it.index : ef->n;
+}
+
+static inline uint64_t ef_select_samples(const elias_fano_t *ef) {
+    return (ef->n + EF_SKIP_QUANTUM - 1) / EF_SKIP_QUANTUM;
+}
+
+static inline void ef_build_select_samples(const elias_fano_t *ef, uint64_t *samples) {
+    uint64_t ones = 0;  // before word w
+    for (uint64_t w = 0, k = 0; k < ef_select_samples(ef); w++) {
+        const uint64_t word = ef->high[w];
+        const uint64_t count = (uint64_t)__builtin_popcountll(word);
+        while ((k < ef_select_samples(ef)) && (k * EF_SKIP_QUANTUM < ones + count)) {
+            samples[k] = w * 64 + ef_select_in_word(word, (uint32_t)(k * EF_SKIP_QUANTUM - ones));
+            k++;
+        }
+        ones += count;
+    }
+}
+
+// the value of rank i < ef->n (0-based)
+static inline uint32_t ef_select(const elias_fano_t *ef, const uint64_t *samples, uint64_t i) {
+    const uint64_t pos = samples[i / EF_SKIP_QUANTUM];
+    uint64_t rank = i % EF_SKIP_QUANTUM;  // among the ones at pos or after
+    uint64_t w = pos >> 6;
+    uint64_t word = ef->high[w] & (~0ULL << (pos & 63));
+    while (true) {
+        const uint64_t ones = (uint64_t)__builtin_popcountll(word);
+        if (rank < ones) break;
+        rank -= ones;
+        word = ef->high[++w];
+    }
+    const uint64_t highpos = w * 64 + ef_select_in_word(word, (uint32_t)rank);
+    return (uint32_t)(((highpos - i) << ef->lowbits) | ef_low(ef, i));
+}
+
+/*
+ * Set operations, writing the values into out (with room for the largest
+ * possible result) and returning how many.
+ */
+static inline size_t ef_intersect(const elias_fano_t *a, const elias_fano_t *b,
+                                  uint32_t *out) {
+    ef_iterator_t i, j;
+    ef_iterator_init(&i, a);
+    ef_iterator_init(&j, b);
+    size_t k = 0;
+    while (i.valid && j.valid) {
+        if (i.value < j.value) {
+            ef_iterator_skip_to(&i, j.value);
+        } else if (j.value < i.value) {
+            ef_iterator_skip_to(&j, i.value);
+        } else {
+            if (out != NULL) out[k] = i.value;
+            k++;
+            ef_iterator_next(&i);
+            ef_iterator_next(&j);
+        }
+    }
+    return k;
+}
+
+static inline size_t ef_intersect_count(const elias_fano_t *a,
+                                        const elias_fano_t *b) {
+    return ef_intersect(a, b, NULL);
+}
+
+/*
+ * Intersection of n >= 1 sets, best with the smallest first: each set in
+ * turn skips to the current candidate, and a set that overshoots it makes
+ * its value the next candidate, until all n agree.
+ */
+static inline size_t ef_intersect_many(const elias_fano_t *const *sets, size_t n,
+                                       uint32_t *out) {
+    ef_iterator_t *its = (ef_iterator_t *)malloc(n * sizeof(ef_iterator_t));
+    size_t k = 0;
+    bool valid = true;
+    for (size_t i = 0; i < n; i++) {
+        ef_iterator_init(&its[i], sets[i]);
+        valid = valid && its[i].valid;
+    }
+    if (valid && (n == 1)) {
+        for (; its[0].valid; ef_iterator_next(&its[0])) out[k++] = its[0].value;
+        valid = false;
+    }
+    uint32_t candidate = its[0].value;
+    size_t agreeing = 1;  // sets at the candidate
+    for (size_t i = 1; valid; i = (i + 1) % n) {
+        ef_iterator_skip_to(&its[i], candidate);
+        if (!its[i].valid) break;
+        if (its[i].value != candidate) {
+            candidate = its[i].value;
+            agreeing = 1;
+            continue;
+        }
+        if (++agreeing < n) continue;
+        out[k++] = candidate;
+        ef_iterator_next(&its[i]);
+        if (!its[i].valid) break;
+        candidate = its[i].value;
+        agreeing = 1;
+    }
+    free(its);
+    return k;
+}
+
+static inline size_t ef_andnot(const elias_fano_t *a, const elias_fano_t *b,
+                               uint32_t *out) {
+    ef_iterator_t i, j;
+    ef_iterator_init(&i, a);
+    ef_iterator_init(&j, b);
+    size_t k = 0;
+    for (; i.valid; ef_iterator_next(&i)) {
+        ef_iterator_skip_to(&j, i.value);
+        if (!j.valid || (j.value != i.value)) out[k++] = i.value;
+    }
+    return k;
+}
+
+// union, or symmetric difference
+static inline size_t ef_merge(const elias_fano_t *a, const elias_fano_t *b,
+                              uint32_t *out, bool symmetric) {
+    ef_iterator_t i, j;
+    ef_iterator_init(&i, a);
+    ef_iterator_init(&j, b);
+    size_t k = 0;
+    while (i.valid && j.valid) {
+        if (i.value < j.value) {
+            out[k++] = i.value;
+            ef_iterator_next(&i);
+        } else if (j.value < i.value) {
+            out[k++] = j.value;
+            ef_iterator_next(&j);
+        } else {
+            if (!symmetric) out[k++] = i.value;
+            ef_iterator_next(&i);
+            ef_iterator_next(&j);
+        }
+    }
+    for (; i.valid; ef_iterator_next(&i)) out[k++] = i.value;
+    for (; j.valid; ef_iterator_next(&j)) out[k++] = j.value;
+    return k;
+}
+
+static inline size_t ef_union(const elias_fano_t *a, const elias_fano_t *b,
+                              uint32_t *out) {
+    return ef_merge(a, b, out, false);
+}
+
+static inline size_t ef_xor(const elias_fano_t *a, const elias_fano_t *b,
+                            uint32_t *out) {
+    return ef_merge(a, b, out, true);
+}
+
+#endif
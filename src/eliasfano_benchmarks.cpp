@@ -0,0 +1,416 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#define __STDC_FORMAT_MACROS 1
+#include <inttypes.h>
+#include <cstdint>
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <queue>
+#include <cassert>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "benchmark.h"
+#include "numbersfromtextfiles.h"
+#ifdef __cplusplus
+}
+#endif
+
+#include "eliasfano.h"
+
+/**
+ * Elias-Fano encoded sets (eliasfano.h): a compressed sorted array, as
+ * used for posting lists, with skip pointers so that intersections and
+ * membership queries do not decode everything. Operations that produce a
+ * set decode it into a buffer and encode it again, as a compressed result
+ * would be stored.
+ */
+typedef size_t (*operation)(const elias_fano_t *, const elias_fano_t *,
+                            uint32_t *);
+
+// compute op(a, b) into out (released first), decoding at most capacity values
+static void materialize(operation op, const elias_fano_t *a,
+                        const elias_fano_t *b, size_t capacity,
+                        elias_fano_t *out) {
+    uint32_t *buffer = (uint32_t *)malloc((capacity + 1) * sizeof(uint32_t));
+    size_t size = op(a, b, buffer);
+    ef_free(out);
+    ef_build(out, buffer, size);
+    free(buffer);
+}
+
+static size_t intersection(const elias_fano_t &a, const elias_fano_t &b) {
+    elias_fano_t r;
+    ef_init_empty(&r);
+    materialize(ef_intersect, &a, &b, std::min(a.n, b.n), &r);
+    size_t answer = r.n;
+    ef_free(&r);
+    return answer;
+}
+
+static size_t union_size(const elias_fano_t &a, const elias_fano_t &b) {
+    elias_fano_t r;
+    ef_init_empty(&r);
+    materialize(ef_union, &a, &b, a.n + b.n, &r);
+    size_t answer = r.n;
+    ef_free(&r);
+    return answer;
+}
+
+static size_t difference(const elias_fano_t &a, const elias_fano_t &b) {
+    elias_fano_t r;
+    ef_init_empty(&r);
+    materialize(ef_andnot, &a, &b, a.n, &r);
+    size_t answer = r.n;
+    ef_free(&r);
+    return answer;
+}
+
+static size_t symmetric_difference(const elias_fano_t &a, const elias_fano_t &b) {
+    elias_fano_t r;
+    ef_init_empty(&r);
+    materialize(ef_xor, &a, &b, a.n + b.n, &r);
+    size_t answer = r.n;
+    ef_free(&r);
+    return answer;
+}
+
+/**
+ * Union of all sets, always merging the two smallest (as fast_logicalor
+ * in stl_vector_benchmarks).
+ */
+static size_t fast_logicalor(size_t n, const elias_fano_t *inputs) {
+    class EliasFanoPtr {
+    public:
+        EliasFanoPtr(const elias_fano_t *e, elias_fano_t *o) : ef(e), own(o) {}
+        const elias_fano_t *ef;
+        elias_fano_t *own;  // to clean, if not an input
+
+        bool operator<(const EliasFanoPtr &o) const {
+            return o.ef->n < ef->n;  // backward on purpose
+        }
+    };
+
+    if (n == 0) return 0;
+    if (n == 1) return inputs[0].n;
+    std::priority_queue<EliasFanoPtr> pq;
+    for (size_t i = 0; i < n; i++) {
+        pq.push(EliasFanoPtr(&inputs[i], NULL));
+    }
+    while (pq.size() > 1) {
+        EliasFanoPtr x1 = pq.top();
+        pq.pop();
+        EliasFanoPtr x2 = pq.top();
+        pq.pop();
+        elias_fano_t *buffer = new elias_fano_t;
+        ef_init_empty(buffer);
+        materialize(ef_union, x1.ef, x2.ef, x1.ef->n + x2.ef->n, buffer);
+        if (x1.own != NULL) ef_free(x1.own);
+        if (x2.own != NULL) ef_free(x2.own);
+        delete x1.own;
+        delete x2.own;
+        pq.push(EliasFanoPtr(buffer, buffer));
+    }
+    EliasFanoPtr x = pq.top();
+    size_t answer = x.ef->n;
+    if (x.own != NULL) ef_free(x.own);
+    delete x.own;
+    return answer;
+}
+
+/**
+ * Once you have collected all the integers, build the bitmaps.
+ */
+static std::vector<elias_fano_t> create_all_bitmaps(size_t *howmany,
+        uint32_t **numbers, size_t count) {
+    if (numbers == NULL) return std::vector<elias_fano_t>();
+    std::vector<elias_fano_t> answer(count);
+
+    for (size_t i = 0; i < count; i++) {
+        ef_build(&answer[i], numbers[i], howmany[i]);
+    }
+    return answer;
+}
+
+static void printusage(char *command) {
+    printf(
+        " Try %s directory \n where directory could be "
+        "benchmarks/realdata/census1881\n",
+        command);
+    ;
+    printf("the -v flag turns on verbose mode\n");
+    printf("the -b flag reads the data from a binary cache next to the directory, creating it if needed\n");
+    printf("the -j flag sets the number of threads parsing the data files (0: one per processor)\n");
+    printf("the -p flag records hardware performance counters for each phase\n");
+    printf("the -n flag followed by a number repeats each phase that many times and reports statistics\n");
+    printf("the -w flag followed by a number runs each phase that many times before measuring it\n");
+    printf("the -o flag followed by text, json or csv sets the output format\n");
+
+}
+
+int main(int argc, char **argv) {
+    int c;
+    const char *extension = ".txt";
+    bool verbose = false;
+    uint64_t data[14];
+    while ((c = getopt(argc, argv, "bj:pn:w:o:ve:h")) != -1) switch (c) {
+        case 'e':
+            extension = optarg;
+            break;
+        case 'b':
+            use_binary_cache = true;
+            break;
+        case 'j':
+            loader_threads = atoi(optarg);
+            break;
+        case 'p':
+            perf_counters_enabled = perf_counters_init();
+            break;
+        case 'n':
+            benchmark_repetitions = atoi(optarg);
+            if (benchmark_repetitions < 1) benchmark_repetitions = 1;
+            break;
+        case 'w':
+            benchmark_warmups = atoi(optarg);
+            if (benchmark_warmups < 0) benchmark_warmups = 0;
+            break;
+        case 'o':
+            if (!report_set_format(optarg)) {
+                printf("Unknown output format %s (text, json or csv).\n", optarg);
+                return -1;
+            }
+            break;
+        case 'v':
+            verbose = true;
+            break;
+        case 'h':
+            printusage(argv[0]);
+            return 0;
+        default:
+            abort();
+        }
+    if (optind >= argc) {
+        printusage(argv[0]);
+        return -1;
+    }
+    char *dirname = argv[optind];
+    report_record_flags(argc, argv, optind);
+    size_t count;
+
+
+    size_t *howmany = NULL;
+    uint32_t **numbers =
+        read_all_integer_files(dirname, extension, &howmany, &count);
+    if (numbers == NULL) {
+        printf(
+            "I could not find or load any data file with extension %s in "
+            "directory %s.\n",
+            extension, dirname);
+        return -1;
+    }
+    uint32_t maxvalue = 0;
+    for (size_t i = 0; i < count; i++) {
+      if( howmany[i] > 0 ) {
+        if(maxvalue < numbers[i][howmany[i]-1]) {
+           maxvalue = numbers[i][howmany[i]-1];
+         }
+      }
+    }
+    uint64_t totalcard = 0;
+    for (size_t i = 0; i < count; i++) {
+      totalcard += howmany[i];
+    }
+    uint64_t successivecard = 0;
+    for (size_t i = 1; i < count; i++) {
+       successivecard += howmany[i-1] + howmany[i];
+    }
+
+    std::vector<elias_fano_t> bitmaps;
+    BEGIN_SINGLE_PHASE(0)
+    bitmaps = create_all_bitmaps(howmany, numbers, count);
+    END_PHASE(0, data[13])
+    if (bitmaps.empty()) return -1;
+    if(verbose) printf("Loaded %d bitmaps from directory %s \n", (int)count, dirname);
+    if(verbose) printf("Building the bitmaps took %" PRIu64 " cycles\n", data[13]);
+    uint64_t totalsize = 0;
+    for (size_t i = 0; i < count; i++) {
+      totalsize += ef_size_in_bytes(&bitmaps[i]);
+    }
+    data[0] = totalsize;
+
+    if(verbose) printf("Total size in bytes =  %" PRIu64 " \n", totalsize);
+
+    uint64_t successive_and = 0;
+    uint64_t successive_or = 0;
+    uint64_t total_or = 0;
+    uint64_t total_count = 0;
+    uint64_t successive_andnot = 0;
+    uint64_t successive_xor = 0;
+
+
+    BEGIN_PHASE(1)
+    successive_and = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+        successive_and += intersection(bitmaps[i], bitmaps[i+1]);
+    }
+    END_PHASE(1, data[1])
+    if(verbose) printf("Successive intersections on %zu bitmaps took %" PRIu64 " cycles\n", count,
+                           data[1]);
+
+    BEGIN_PHASE(2)
+    successive_or = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+        successive_or += union_size(bitmaps[i], bitmaps[i+1]);
+    }
+    END_PHASE(2, data[2])
+    if(verbose) printf("Successive unions on %zu bitmaps took %" PRIu64 " cycles\n", count,
+                           data[2]);
+
+    BEGIN_PHASE(3)
+    if(count>1) {
+        elias_fano_t v;
+        ef_init_empty(&v);
+        materialize(ef_union, &bitmaps[0], &bitmaps[1], bitmaps[0].n + bitmaps[1].n, &v);
+        for (int i = 2; i < (int)count ; ++i) {
+            elias_fano_t newv;
+            ef_init_empty(&newv);
+            materialize(ef_union, &v, &bitmaps[i], v.n + bitmaps[i].n, &newv);
+            ef_free(&v);
+            v = newv;
+        }
+        total_or = v.n;
+        ef_free(&v);
+    }
+    END_PHASE(3, data[3])
+    if(verbose) printf("Total naive unions on %zu bitmaps took %" PRIu64 " cycles\n", count,
+                           data[3]);
+    BEGIN_PHASE(4)
+    if(count>1) {
+        total_or = fast_logicalor(count, bitmaps.data());
+    }
+    END_PHASE(4, data[4])
+    if(verbose) printf("Total heap unions on %zu bitmaps took %" PRIu64 " cycles\n", count,
+                           data[4]);
+
+    uint64_t quartcount = 0;
+    BEGIN_REPEATED_PHASE(5, quartile_test_repetitions)
+    quartcount = 0;
+    for (size_t i = 0; i < count ; ++i) {
+      quartcount += ef_contains(&bitmaps[i], maxvalue/4);
+      quartcount += ef_contains(&bitmaps[i], maxvalue/2);
+      quartcount += ef_contains(&bitmaps[i], 3*maxvalue/4);
+    }
+    END_PHASE(5, data[5])
+
+    if(verbose) printf("Quartile queries on %zu bitmaps took %" PRIu64 " cycles\n", count,
+           data[5]);
+
+    if(verbose) printf("Collected stats  %" PRIu64 "  %" PRIu64 "  %" PRIu64 " %" PRIu64 "\n",successive_and,successive_or,total_or,quartcount);
+
+    BEGIN_PHASE(6)
+    successive_andnot = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+        successive_andnot += difference(bitmaps[i], bitmaps[i+1]);
+    }
+    END_PHASE(6, data[6])
+
+    if(verbose) printf("Successive differences on %zu bitmaps took %" PRIu64 " cycles\n", count,
+           data[6]);
+
+    BEGIN_PHASE(7)
+    successive_xor = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+        successive_xor += symmetric_difference(bitmaps[i], bitmaps[i+1]);
+    }
+    END_PHASE(7, data[7])
+
+    if(verbose) printf("Successive symmetric differences on %zu bitmaps took %" PRIu64 " cycles\n", count,
+           data[7]);
+
+    BEGIN_PHASE(8)
+    total_count = 0;
+    for (size_t i = 0; i < count; ++i) {
+        ef_iterator_t j;
+        for(ef_iterator_init(&j, &bitmaps[i]); j.valid ; ef_iterator_next(&j)) {
+            total_count++;
+        }
+    }
+    END_PHASE(8, data[8])
+    assert(total_count == totalcard);
+
+    if(verbose) printf("Iterating over %zu bitmaps took %" PRIu64 " cycles\n", count,
+           data[8]);
+
+    assert(successive_xor + successive_and == successive_or);
+
+    /**
+    * and, or, andnot and xor cardinality: all follow from the size of the
+    * intersection
+    */
+    uint64_t successive_andcard = 0;
+    uint64_t successive_orcard = 0;
+    uint64_t successive_andnotcard = 0;
+    uint64_t successive_xorcard = 0;
+
+    BEGIN_PHASE(9)
+    successive_andcard = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+      successive_andcard += ef_intersect_count(&bitmaps[i], &bitmaps[i+1]);
+    }
+    END_PHASE(9, data[9])
+
+    BEGIN_PHASE(10)
+    successive_orcard = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+      successive_orcard += bitmaps[i].n + bitmaps[i+1].n
+          - ef_intersect_count(&bitmaps[i], &bitmaps[i+1]);
+    }
+    END_PHASE(10, data[10])
+
+    BEGIN_PHASE(11)
+    successive_andnotcard = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+      successive_andnotcard += bitmaps[i].n
+          - ef_intersect_count(&bitmaps[i], &bitmaps[i+1]);
+    }
+    END_PHASE(11, data[11])
+
+    BEGIN_PHASE(12)
+    successive_xorcard = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+      successive_xorcard += bitmaps[i].n + bitmaps[i+1].n
+          - 2 * ef_intersect_count(&bitmaps[i], &bitmaps[i+1]);
+    }
+    END_PHASE(12, data[12])
+
+    assert(successive_andcard == successive_and);
+    assert(successive_orcard == successive_or);
+    assert(successive_xorcard == successive_xor);
+    assert(successive_andnotcard == successive_andnot);
+
+    /**
+    * end and, or, andnot and xor cardinality
+    */
+
+    report_cardinalities(successive_and, successive_or, total_or, quartcount,
+                         successive_andnot, successive_xor, total_count);
+    benchmark_report(report_basename(argv[0]), dirname, data, 14, count,
+                     totalcard, successivecard);
+    perf_counters_print();
+    phase_stats_print();
+
+    for (size_t i = 0; i < count; ++i) {
+        ef_free(&bitmaps[i]);
+    }
+    for (int i = 0; i < (int)count; ++i) {
+        free(numbers[i]);
+        numbers[i] = NULL;  // paranoid
+    }
+    free(howmany);
+    free(numbers);
+
+    return 0;
+}
@@ -0,0 +1,295 @@
+#ifndef INCLUDE_ELIASFANOBACKEND_H
+#define INCLUDE_ELIASFANOBACKEND_H
+
+/*
+ * Backend over the Elias-Fano sets of eliasfano.h, as in
+ * eliasfano_benchmarks.
+ */
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "bitmapbackend.h"
+#include "eliasfano.h"
+
+struct eliasfano_backend {
+    typedef elias_fano_t bitmap;
+    typedef size_t (*operation)(const elias_fano_t *, const elias_fano_t *,
+                                uint32_t *);
+
+    static const char *name() { return "eliasfano"; }
+
+    static void build(bitmap &b, const uint32_t *values, size_t n) {
+        ef_build(&b, values, n);
+    }
+
+    static void release(bitmap &b) { ef_free(&b); }
+
+    static uint64_t size_in_bytes(const bitmap &b) {
+        return ef_size_in_bytes(&b);
+    }
+
+    // compute op(a, b) into out (released first), decoding at most capacity
+    // values
+    static void materialize(operation op, const bitmap &a, const bitmap &b,
+                            size_t capacity, bitmap &out) {
+        uint32_t *buffer = (uint32_t *)malloc((capacity + 1) * sizeof(uint32_t));
+        size_t size = op(&a, &b, buffer);
+        ef_free(&out);
+        ef_build(&out, buffer, size);
+        free(buffer);
+    }
+
+    static uint64_t materialize(operation op, const bitmap &a, const bitmap &b,
+                                size_t capacity) {
+        bitmap r;
+        ef_init_empty(&r);
+        materialize(op, a, b, capacity, r);
+        uint64_t card = r.n;
+        ef_free(&r);
+        return card;
+    }
+
+    static uint64_t and_op(const bitmap &a, const bitmap &b) {
+        return materialize(ef_intersect, a, b, std::min(a.n, b.n));
+    }
+
+    static uint64_t or_op(const bitmap &a, const bitmap &b) {
+        return materialize(ef_union, a, b, a.n + b.n);
+    }
+
+    static uint64_t andnot_op(const bitmap &a, const bitmap &b) {
+        return materialize(ef_andnot, a, b, a.n);
+    }
+
+    static uint64_t xor_op(const bitmap &a, const bitmap &b) {
+        return materialize(ef_xor, a, b, a.n + b.n);
+    }
+
+    static uint64_t and_count(const bitmap &a, const bitmap &b) {
+        return ef_intersect_count(&a, &b);
+    }
+
+    static uint64_t or_count(const bitmap &a, const bitmap &b) {
+        return a.n + b.n - and_count(a, b);
+    }
+
+    static uint64_t andnot_count(const bitmap &a, const bitmap &b) {
+        return a.n - and_count(a, b);
+    }
+
+    static uint64_t xor_count(const bitmap &a, const bitmap &b) {
+        return a.n + b.n - 2 * and_count(a, b);
+    }
+
+    static uint64_t wide_or(const std::vector<bitmap> &all) {
+        if (all.size() < 2) return all.empty() ? 0 : all[0].n;
+        bitmap v;
+        ef_init_empty(&v);
+        materialize(ef_union, all[0], all[1], all[0].n + all[1].n, v);
+        for (size_t i = 2; i < all.size(); ++i) {
+            bitmap newv;
+            ef_init_empty(&newv);
+            materialize(ef_union, v, all[i], v.n + all[i].n, newv);
+            ef_free(&v);
+            v = newv;
+        }
+        uint64_t card = v.n;
+        ef_free(&v);
+        return card;
+    }
+
+    // merge the two smallest sets first
+    static uint64_t wide_or_heap(const std::vector<bitmap> &all) {
+        struct set_ptr {
+            const bitmap *ef;
+            bitmap *own;  // to free, if not an input
+            bool operator<(const set_ptr &o) const {
+                return o.ef->n < ef->n; // backward on purpose
+            }
+        };
+        if (all.size() < 2) return all.empty() ? 0 : all[0].n;
+        std::priority_queue<set_ptr> pq;
+        for (size_t i = 0; i < all.size(); i++) {
+            set_ptr p = {&all[i], NULL};
+            pq.push(p);
+        }
+        while (pq.size() > 1) {
+            set_ptr x1 = pq.top();
+            pq.pop();
+            set_ptr x2 = pq.top();
+            pq.pop();
+            bitmap *buffer = new bitmap;
+            ef_init_empty(buffer);
+            materialize(ef_union, *x1.ef, *x2.ef, x1.ef->n + x2.ef->n, *buffer);
+            if (x1.own != NULL) ef_free(x1.own);
+            if (x2.own != NULL) ef_free(x2.own);
+            delete x1.own;
+            delete x2.own;
+            set_ptr p = {buffer, buffer};
+            pq.push(p);
+        }
+        set_ptr x = pq.top();
+        uint64_t card = x.ef->n;
+        if (x.own != NULL) ef_free(x.own);
+        delete x.own;
+        return card;
+    }
+
+    // all sets at once, the smallest first
+    static uint64_t wide_and(const bitmap *first, size_t n) {
+        std::vector<const bitmap *> sorted(n);
+        for (size_t i = 0; i < n; ++i) sorted[i] = &first[i];
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const bitmap *x, const bitmap *y) { return x->n < y->n; });
+        uint32_t *buffer = (uint32_t *)malloc((sorted[0]->n + 1) * sizeof(uint32_t));
+        size_t size = ef_intersect_many(sorted.data(), n, buffer);
+        bitmap r;
+        ef_build(&r, buffer, size);
+        free(buffer);
+        uint64_t card = r.n;
+        ef_free(&r);
+        return card;
+    }
+
+    // a heap merge of the n iterators, as for the sorted vectors
+    static uint64_t threshold(const bitmap *first, size_t n, size_t t) {
+        typedef std::pair<uint32_t, size_t> cursor;  // value, iterator
+        std::priority_queue<cursor, std::vector<cursor>, std::greater<cursor> > pq;
+        std::vector<ef_iterator_t> its(n);
+        for (size_t i = 0; i < n; ++i) {
+            ef_iterator_init(&its[i], &first[i]);
+            if (its[i].valid) pq.push(cursor(its[i].value, i));
+        }
+        std::vector<uint32_t> values;
+        while (!pq.empty()) {
+            const uint32_t value = pq.top().first;
+            size_t occurrences = 0;
+            while (!pq.empty() && (pq.top().first == value)) {
+                const size_t i = pq.top().second;
+                pq.pop();
+                occurrences++;
+                ef_iterator_next(&its[i]);
+                if (its[i].valid) pq.push(cursor(its[i].value, i));
+            }
+            if (occurrences >= t) values.push_back(value);
+        }
+        bitmap r;
+        ef_build(&r, values.data(), values.size());
+        uint64_t card = r.n;
+        ef_free(&r);
+        return card;
+    }
+
+    // skip to lo, then decode up to hi
+    static uint64_t range_count(const bitmap &b, uint64_t lo, uint64_t hi) {
+        uint64_t card = 0;
+        ef_iterator_t j;
+        ef_iterator_init(&j, &b);
+        for (ef_iterator_skip_to(&j, (uint32_t)lo); j.valid && (j.value < hi); ef_iterator_next(&j)) {
+            card++;
+        }
+        return card;
+    }
+
+    static bool range_intersects(const bitmap &b, uint64_t lo, uint64_t hi) {
+        ef_iterator_t j;
+        ef_iterator_init(&j, &b);
+        ef_iterator_skip_to(&j, (uint32_t)lo);
+        return j.valid && (j.value < hi);
+    }
+
+    static void range_values(const bitmap &b, uint64_t lo, uint64_t hi,
+                             std::vector<uint32_t> &out) {
+        ef_iterator_t j;
+        ef_iterator_init(&j, &b);
+        for (ef_iterator_skip_to(&j, (uint32_t)lo); j.valid && (j.value < hi); ef_iterator_next(&j)) {
+            out.push_back(j.value);
+        }
+    }
+
+    // rank through the skip pointers, select through samples of the ones
+    typedef std::vector<uint64_t> rank_index;
+
+    static void build_rank_index(const bitmap &b, rank_index &idx) {
+        idx.resize(ef_select_samples(&b));
+        ef_build_select_samples(&b, idx.data());
+    }
+
+    static uint64_t rank_index_bytes(const bitmap &, const rank_index &idx) {
+        return idx.size() * sizeof(uint64_t);
+    }
+
+    static uint64_t rank(const bitmap &b, const rank_index &, uint32_t x) {
+        return ef_rank(&b, x);
+    }
+
+    static uint32_t select(const bitmap &b, const rank_index &idx, uint64_t i) {
+        return ef_select(&b, idx.data(), i);
+    }
+
+    // the sets are static: every update decodes the values and encodes them
+    // anew
+    static void decode(const bitmap &b, std::vector<uint32_t> &values) {
+        values.clear();
+        values.reserve(b.n + 1);
+        ef_iterator_t j;
+        for (ef_iterator_init(&j, &b); j.valid; ef_iterator_next(&j)) {
+            values.push_back(j.value);
+        }
+    }
+
+    static void add(bitmap &b, uint32_t value) {
+        std::vector<uint32_t> values;
+        decode(b, values);
+        std::vector<uint32_t>::iterator j = std::lower_bound(values.begin(), values.end(), value);
+        if ((j != values.end()) && (*j == value)) return;
+        values.insert(j, value);
+        ef_free(&b);
+        ef_build(&b, values.data(), values.size());
+    }
+
+    static void remove(bitmap &b, uint32_t value) {
+        std::vector<uint32_t> values;
+        decode(b, values);
+        std::vector<uint32_t>::iterator j = std::lower_bound(values.begin(), values.end(), value);
+        if ((j == values.end()) || (*j != value)) return;
+        values.erase(j);
+        ef_free(&b);
+        ef_build(&b, values.data(), values.size());
+    }
+
+    static void add_many(bitmap &b, const uint32_t *newvalues, size_t n) {
+        std::vector<uint32_t> values;
+        decode(b, values);
+        const size_t old = values.size();
+        values.insert(values.end(), newvalues, newvalues + n);
+        std::sort(values.begin() + old, values.end());
+        std::inplace_merge(values.begin(), values.begin() + old, values.end());
+        values.erase(std::unique(values.begin(), values.end()), values.end());
+        ef_free(&b);
+        ef_build(&b, values.data(), values.size());
+    }
+
+    static void optimize(bitmap &) {}
+
+    static bool contains(const bitmap &b, uint32_t value) {
+        return ef_contains(&b, value);
+    }
+
+    static uint64_t iterate(const bitmap &b) {
+        uint64_t card = 0;
+        ef_iterator_t j;
+        for (ef_iterator_init(&j, &b); j.valid; ef_iterator_next(&j)) {
+            card++;
+        }
+        return card;
+    }
+};
+
+REGISTER_BACKEND(eliasfano_backend)
+
+#endif
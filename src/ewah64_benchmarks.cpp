@@ -28,9 +28,21 @@ static std::vector<EWAHBoolArray<uint64_t> > create_all_bitmaps(size_t *howmany,
     for (size_t i = 0; i < count; i++) {
         EWAHBoolArray<uint64_t> & bm = answer[i];
         uint32_t * mynumbers = numbers[i];
-        for(size_t j = 0; j < howmany[i] ; ++j) {
-            bm.set(mynumbers[j]);
+        // the values are sorted: we append whole words, with a stream of
+        // empty words over each gap, instead of setting bit by bit
+        const uint32_t wordbits = sizeof(uint64_t) * 8;
+        size_t nextword = 0;
+        for(size_t j = 0; j < howmany[i] ; ) {
+            const size_t w = mynumbers[j] / wordbits;
+            uint64_t word = 0;
+            for(; (j < howmany[i]) && (mynumbers[j] / wordbits == w); ++j) {
+                word |= (uint64_t)1 << (mynumbers[j] % wordbits);
+            }
+            if(w > nextword) bm.addStreamOfEmptyWords(false, w - nextword);
+            bm.addWord(word);
+            nextword = w + 1;
         }
+        if(howmany[i] > 0) bm.setSizeInBits(mynumbers[howmany[i] - 1] + 1);
         bm.trim();
     }
     return answer;
@@ -42,7 +54,14 @@ static void printusage(char *command) {
         "benchmarks/realdata/census1881\n",
         command);
     ;
-    printf("the -v flag turns on verbose mode");
+    printf("the -v flag turns on verbose mode\n");
+    printf("the -b flag reads the data from a binary cache next to the directory, creating it if needed\n");
+    printf("the -j flag sets the number of threads parsing the data files (0: one per processor)\n");
+    printf("the -p flag records hardware performance counters for each phase\n");
+    printf("the -n flag followed by a number repeats each phase that many times and reports statistics\n");
+    printf("the -w flag followed by a number runs each phase that many times before measuring it\n");
+    printf("the -o flag followed by text, json or csv sets the output format\n");
+    printf("the -s flag measures serialization and deserialization\n");
 
 }
 
@@ -50,14 +69,41 @@ int main(int argc, char **argv) {
     int c;
     const char *extension = ".txt";
     bool verbose = false;
-    uint64_t data[13];
-    while ((c = getopt(argc, argv, "ve:h")) != -1) switch (c) {
+    bool serialize = false;
+    uint64_t data[14];
+    while ((c = getopt(argc, argv, "bj:pn:w:o:sve:h")) != -1) switch (c) {
         case 'e':
             extension = optarg;
             break;
+        case 'b':
+            use_binary_cache = true;
+            break;
+        case 'j':
+            loader_threads = atoi(optarg);
+            break;
+        case 'p':
+            perf_counters_enabled = perf_counters_init();
+            break;
+        case 'n':
+            benchmark_repetitions = atoi(optarg);
+            if (benchmark_repetitions < 1) benchmark_repetitions = 1;
+            break;
+        case 'w':
+            benchmark_warmups = atoi(optarg);
+            if (benchmark_warmups < 0) benchmark_warmups = 0;
+            break;
+        case 'o':
+            if (!report_set_format(optarg)) {
+                printf("Unknown output format %s (text, json or csv).\n", optarg);
+                return -1;
+            }
+            break;
         case 'v':
             verbose = true;
             break;
+        case 's':
+            serialize = true;
+            break;
         case 'h':
             printusage(argv[0]);
             return 0;
@@ -69,6 +115,7 @@ int main(int argc, char **argv) {
         return -1;
     }
     char *dirname = argv[optind];
+    report_record_flags(argc, argv, optind);
     size_t count;
 
     size_t *howmany = NULL;
@@ -98,13 +145,13 @@ int main(int argc, char **argv) {
       successivecard += howmany[i-1] + howmany[i];
     }
 
-    uint64_t cycles_start = 0, cycles_final = 0;
-
-    RDTSC_START(cycles_start);
-    std::vector<EWAHBoolArray<uint64_t> > bitmaps = create_all_bitmaps(howmany, numbers, count);
-    RDTSC_FINAL(cycles_final);
+    std::vector<EWAHBoolArray<uint64_t> > bitmaps;
+    BEGIN_SINGLE_PHASE(0)
+    bitmaps = create_all_bitmaps(howmany, numbers, count);
+    END_PHASE(0, data[13])
     if (bitmaps.empty()) return -1;
     if(verbose) printf("Loaded %d bitmaps from directory %s \n", (int)count, dirname);
+    if(verbose) printf("Building the bitmaps took %" PRIu64 " cycles\n", data[13]);
     uint64_t totalsize = 0;
 
     for (int i = 0; i < (int) count; ++i) {
@@ -123,28 +170,28 @@ int main(int argc, char **argv) {
     uint64_t successive_xor = 0;
 
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(1)
+    successive_and = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         EWAHBoolArray<uint64_t>  tempand;
         bitmaps[i].logicaland(bitmaps[i + 1],tempand);
         successive_and += tempand.numberOfOnes();
     }
-    RDTSC_FINAL(cycles_final);
-    data[1] = cycles_final - cycles_start;
+    END_PHASE(1, data[1])
     if(verbose) printf("Successive intersections on %zu bitmaps took %" PRIu64 " cycles\n", count,
-                           cycles_final - cycles_start);
+                           data[1]);
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(2)
+    successive_or = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         EWAHBoolArray<uint64_t>  tempor;
         bitmaps[i].logicalor(bitmaps[i + 1],tempor);
         successive_or += tempor.numberOfOnes();
     }
-    RDTSC_FINAL(cycles_final);
-    data[2] = cycles_final - cycles_start;
+    END_PHASE(2, data[2])
     if(verbose) printf("Successive unions on %zu bitmaps took %" PRIu64 " cycles\n", count,
-                           cycles_final - cycles_start);
-    RDTSC_START(cycles_start);
+                           data[2]);
+    BEGIN_PHASE(3)
     if(count>1) {
         EWAHBoolArray<uint64_t>  totalorbitmap;
         bitmaps[0].logicalor(bitmaps[1],totalorbitmap);
@@ -155,12 +202,11 @@ int main(int argc, char **argv) {
         }
         total_or = totalorbitmap.numberOfOnes();
     }
-    RDTSC_FINAL(cycles_final);
-    data[3] = cycles_final - cycles_start;
+    END_PHASE(3, data[3])
     if(verbose) printf("Total naive unions on %zu bitmaps took %" PRIu64 " cycles\n", count,
-                           cycles_final - cycles_start);
+                           data[3]);
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(4)
     if(count>1) {
         EWAHBoolArray<uint64_t>  totalorbitmap;
         const EWAHBoolArray<uint64_t>  ** allofthem = new const EWAHBoolArray<uint64_t>* [count];
@@ -169,60 +215,59 @@ int main(int argc, char **argv) {
         total_or = totalorbitmap.numberOfOnes();
         delete[] allofthem;
     }
-    RDTSC_FINAL(cycles_final);
-    data[4] = cycles_final - cycles_start;
+    END_PHASE(4, data[4])
     if(verbose) printf("Total heap unions on %zu bitmaps took %" PRIu64 " cycles\n", count,
-                           cycles_final - cycles_start);
-    uint64_t quartcount;
-    STARTBEST(quartile_test_repetitions)
+                           data[4]);
+    uint64_t quartcount = 0;
+    BEGIN_REPEATED_PHASE(5, quartile_test_repetitions)
     quartcount = 0;
     for (size_t i = 0; i < count ; ++i) {
       quartcount += bitmaps[i].get(maxvalue/4);
       quartcount += bitmaps[i].get(maxvalue/2);
       quartcount += bitmaps[i].get(3*maxvalue/4);
     }
-    ENDBEST(data[5])
+    END_PHASE(5, data[5])
 
     if(verbose) printf("Quartile queries on %zu bitmaps took %" PRIu64 " cycles\n", count,
            data[5]);
 
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(6)
+    successive_andnot = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         EWAHBoolArray<uint64_t>  tempandnot;
         bitmaps[i].logicalandnot(bitmaps[i + 1],tempandnot);
         successive_andnot += tempandnot.numberOfOnes();
     }
-    RDTSC_FINAL(cycles_final);
-    data[6] = cycles_final - cycles_start;
+    END_PHASE(6, data[6])
 
     if(verbose) printf("Successive differences on %zu bitmaps took %" PRIu64 " cycles\n", count,
-           cycles_final - cycles_start);
+           data[6]);
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(7)
+    successive_xor = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         EWAHBoolArray<uint64_t>  tempxor;
         bitmaps[i].logicalxor(bitmaps[i + 1],tempxor);
         successive_xor += tempxor.numberOfOnes();
     }
-    RDTSC_FINAL(cycles_final);
-    data[7] = cycles_final - cycles_start;
+    END_PHASE(7, data[7])
 
     if(verbose) printf("Successive symmetric differences on %zu bitmaps took %" PRIu64 " cycles\n", count,
-           cycles_final - cycles_start);
+           data[7]);
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(8)
+    total_count = 0;
     for (size_t i = 0; i < count; ++i) {
         EWAHBoolArray<uint64_t> & b = bitmaps[i];
         for (auto j = b.begin(); j != b.end(); ++j) {
             total_count++;
         }
     }
-    RDTSC_FINAL(cycles_final);
-    data[8] = cycles_final - cycles_start;
+    END_PHASE(8, data[8])
 
     if(verbose) printf("Iterating over %zu bitmaps took %" PRIu64 " cycles\n", count,
-           cycles_final - cycles_start);
+           data[8]);
 
     if(verbose) printf("Collected stats  %" PRIu64 "  %" PRIu64 "  %" PRIu64 " %" PRIu64 "\n",successive_and,successive_or,total_or,quartcount);
 
@@ -242,33 +287,33 @@ int main(int argc, char **argv) {
         assert(bitmaps[i].logicalandnotcount(bitmaps[i + 1]) == bitmaps[i].logicalandnot(bitmaps[i + 1]).numberOfOnes());
     }
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(9)
+    successive_andcard = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         successive_andcard += bitmaps[i].logicalandcount(bitmaps[i + 1]);
     }
-    RDTSC_FINAL(cycles_final);
-    data[9] = cycles_final - cycles_start;
+    END_PHASE(9, data[9])
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(10)
+    successive_orcard = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         successive_orcard += bitmaps[i].logicalorcount(bitmaps[i + 1]);
     }
-    RDTSC_FINAL(cycles_final);
-    data[10] = cycles_final - cycles_start;
+    END_PHASE(10, data[10])
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(11)
+    successive_andnotcard = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         successive_andnotcard += bitmaps[i].logicalandnotcount(bitmaps[i + 1]);
     }
-    RDTSC_FINAL(cycles_final);
-    data[11] = cycles_final - cycles_start;
+    END_PHASE(11, data[11])
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(12)
+    successive_xorcard = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         successive_xorcard += bitmaps[i].logicalxorcount(bitmaps[i + 1]);
     }
-    RDTSC_FINAL(cycles_final);
-    data[12] = cycles_final - cycles_start;
+    END_PHASE(12, data[12])
 
     assert(successive_andcard == successive_and);
     assert(successive_xorcard == successive_xor);
@@ -278,24 +323,48 @@ int main(int argc, char **argv) {
     /**
     * end and, or, andnot and xor cardinality
     */
+
+    if (serialize) {
+        /**
+        * serialize all bitmaps, one after the other, into a single buffer,
+        * then read them back (EWAH has no format that can be used in place)
+        */
+        std::vector<size_t> offsets(count + 1, 0);
+        for (int i = 0; i < (int)count; ++i) {
+            offsets[i + 1] = offsets[i] + bitmaps[i].sizeOnDisk();
+        }
+        char *buffer = (char *)malloc(offsets[count] + 1);
+        BEGIN_PHASE(PHASE_SERIALIZATION)
+        for (int i = 0; i < (int)count; ++i) {
+            bitmaps[i].write(buffer + offsets[i], offsets[i + 1] - offsets[i]);
+        }
+        END_PHASE(PHASE_SERIALIZATION, serialization_report.cycles[0])
+        uint64_t deserializedcard = 0;
+        BEGIN_PHASE(PHASE_DESERIALIZATION)
+        deserializedcard = 0;
+        for (int i = 0; i < (int)count; ++i) {
+            EWAHBoolArray<uint64_t> bv;
+            bv.read(buffer + offsets[i], offsets[i + 1] - offsets[i]);
+            deserializedcard += bv.numberOfOnes();
+        }
+        END_PHASE(PHASE_DESERIALIZATION, serialization_report.cycles[1])
+        assert(deserializedcard == totalcard);
+        if(verbose) printf("Deserialized cardinality %" PRIu64 " \n", deserializedcard);
+        serialization_report.measured = true;
+        serialization_report.bytes = offsets[count];
+        serialization_report.frozen = false;
+        free(buffer);
+    }
+
     assert(total_count == totalcard);
 
 
-    printf(" %20.2f %20.2f %20.2f %20.2f %20.2f %20.2f  %20.2f  %20.2f     %20.2f    %20.2f  %20.2f  %20.2f  %20.2f\n",
-      data[0]*8.0/totalcard,
-      data[1]*1.0/successivecard,
-      data[2]*1.0/successivecard,
-      data[3]*1.0/totalcard,
-      data[4]*1.0/totalcard,
-      data[5]*1.0/(3*count),
-      data[6]*1.0/successivecard,
-      data[7]*1.0/successivecard,
-      data[8]*1.0/totalcard,
-      data[9]*1.0/successivecard,
-      data[10]*1.0/successivecard,
-      data[11]*1.0/successivecard,
-      data[12]*1.0/successivecard
-    );
+    report_cardinalities(successive_and, successive_or, total_or, quartcount,
+                         successive_andnot, successive_xor, total_count);
+    benchmark_report(report_basename(argv[0]), dirname, data, 14, count,
+                     totalcard, successivecard);
+    perf_counters_print();
+    phase_stats_print();
 
 
     for (int i = 0; i < (int)count; ++i) {
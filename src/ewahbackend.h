@@ -0,0 +1,224 @@
+#ifndef INCLUDE_EWAHBACKEND_H
+#define INCLUDE_EWAHBACKEND_H
+
+/*
+ * Backends over EWAHBoolArray with 32-bit and 64-bit words, as in
+ * ewah32_benchmarks and ewah64_benchmarks.
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include "bitmapbackend.h"
+#include "ewah.h" /* EWAHBoolArray */
+
+template <typename uword>
+struct ewah_backend {
+    typedef EWAHBoolArray<uword> bitmap;
+
+    static const char *name() {
+        return sizeof(uword) == 4 ? "ewah32" : "ewah64";
+    }
+
+    // whole words appended, as in ewah32_benchmarks
+    static void build(bitmap &b, const uint32_t *values, size_t n) {
+        const uint32_t wordbits = sizeof(uword) * 8;
+        size_t nextword = 0;
+        for (size_t j = 0; j < n;) {
+            const size_t w = values[j] / wordbits;
+            uword word = 0;
+            for (; (j < n) && (values[j] / wordbits == w); ++j) {
+                word |= (uword)1 << (values[j] % wordbits);
+            }
+            if (w > nextword) b.addStreamOfEmptyWords(false, w - nextword);
+            b.addWord(word);
+            nextword = w + 1;
+        }
+        if (n > 0) b.setSizeInBits(values[n - 1] + 1);
+        b.trim();
+    }
+
+    static void release(bitmap &b) { bitmap().swap(b); }
+
+    static uint64_t size_in_bytes(const bitmap &b) {
+        return b.sizeInBytes(); // should be close enough to memory usage
+    }
+
+    static uint64_t and_op(const bitmap &a, const bitmap &b) {
+        bitmap tempand;
+        a.logicaland(b, tempand);
+        return tempand.numberOfOnes();
+    }
+
+    static uint64_t or_op(const bitmap &a, const bitmap &b) {
+        bitmap tempor;
+        a.logicalor(b, tempor);
+        return tempor.numberOfOnes();
+    }
+
+    static uint64_t andnot_op(const bitmap &a, const bitmap &b) {
+        bitmap tempandnot;
+        a.logicalandnot(b, tempandnot);
+        return tempandnot.numberOfOnes();
+    }
+
+    static uint64_t xor_op(const bitmap &a, const bitmap &b) {
+        bitmap tempxor;
+        a.logicalxor(b, tempxor);
+        return tempxor.numberOfOnes();
+    }
+
+    static uint64_t and_count(const bitmap &a, const bitmap &b) {
+        return a.logicalandcount(b);
+    }
+
+    static uint64_t or_count(const bitmap &a, const bitmap &b) {
+        return a.logicalorcount(b);
+    }
+
+    static uint64_t andnot_count(const bitmap &a, const bitmap &b) {
+        return a.logicalandnotcount(b);
+    }
+
+    static uint64_t xor_count(const bitmap &a, const bitmap &b) {
+        return a.logicalxorcount(b);
+    }
+
+    static uint64_t wide_or(const std::vector<bitmap> &all) {
+        if (all.size() < 2) return all.empty() ? 0 : all[0].numberOfOnes();
+        bitmap totalorbitmap;
+        all[0].logicalor(all[1], totalorbitmap);
+        for (size_t i = 2; i < all.size(); ++i) {
+          bitmap tmp;
+          totalorbitmap.logicalor(all[i], tmp);
+          tmp.swap(totalorbitmap);
+        }
+        return totalorbitmap.numberOfOnes();
+    }
+
+    static uint64_t wide_or_heap(const std::vector<bitmap> &all) {
+        if (all.size() < 2) return all.empty() ? 0 : all[0].numberOfOnes();
+        bitmap totalorbitmap;
+        std::vector<const bitmap *> allofthem(all.size());
+        for (size_t i = 0; i < all.size(); ++i) allofthem[i] = &all[i];
+        fast_logicalor_tocontainer<uword>(all.size(), allofthem.data(), totalorbitmap);
+        return totalorbitmap.numberOfOnes();
+    }
+
+    // the most compressed bitmaps first, since the cost of each step grows
+    // with the compressed sizes
+    static uint64_t wide_and(const bitmap *first, size_t n) {
+        std::vector<const bitmap *> sorted(n);
+        for (size_t i = 0; i < n; ++i) sorted[i] = &first[i];
+        std::sort(sorted.begin(), sorted.end(), [](const bitmap *x, const bitmap *y) {
+            return x->sizeInBytes() < y->sizeInBytes();
+        });
+        if (n == 1) return sorted[0]->numberOfOnes();
+        bitmap tempand;
+        sorted[0]->logicaland(*sorted[1], tempand);
+        for (size_t i = 2; i < n; ++i) {
+          bitmap tmp;
+          tempand.logicaland(*sorted[i], tmp);
+          tmp.swap(tempand);
+        }
+        return tempand.numberOfOnes();
+    }
+
+    struct sliced_ops {
+        typedef EWAHBoolArray<uword> bitmap;
+        static void and_op(const bitmap &a, const bitmap &b, bitmap &out) { a.logicaland(b, out); }
+        static void or_op(const bitmap &a, const bitmap &b, bitmap &out) { a.logicalor(b, out); }
+        static void andnot_op(const bitmap &a, const bitmap &b, bitmap &out) { a.logicalandnot(b, out); }
+        static void xor_op(const bitmap &a, const bitmap &b, bitmap &out) { a.logicalxor(b, out); }
+        static uint64_t cardinality(const bitmap &b) { return b.numberOfOnes(); }
+    };
+
+    // bit-sliced counters
+    static uint64_t threshold(const bitmap *first, size_t n, size_t t) {
+        return bit_sliced_threshold<sliced_ops>(first, n, t);
+    }
+
+    // the compressed stream has no random access: decode from the start
+    static uint64_t range_count(const bitmap &b, uint64_t lo, uint64_t hi) {
+        uint64_t card = 0;
+        for (auto j = b.begin(); (j != b.end()) && (*j < hi); ++j) {
+            card += (*j >= lo);
+        }
+        return card;
+    }
+
+    static bool range_intersects(const bitmap &b, uint64_t lo, uint64_t hi) {
+        for (auto j = b.begin(); (j != b.end()) && (*j < hi); ++j) {
+            if (*j >= lo) return true;
+        }
+        return false;
+    }
+
+    static void range_values(const bitmap &b, uint64_t lo, uint64_t hi,
+                             std::vector<uint32_t> &out) {
+        for (auto j = b.begin(); (j != b.end()) && (*j < hi); ++j) {
+            if (*j >= lo) out.push_back((uint32_t)*j);
+        }
+    }
+
+    // decode from the start
+    static uint64_t rank(const bitmap &b, uint32_t x) {
+        uint64_t card = 0;
+        for (auto j = b.begin(); (j != b.end()) && (*j <= x); ++j) card++;
+        return card;
+    }
+
+    static uint32_t select(const bitmap &b, uint64_t i) {
+        auto j = b.begin();
+        for (; i > 0; --i) ++j;
+        return (uint32_t)*j;
+    }
+
+    // the bits can only be set in increasing order: anything else takes a
+    // union with (or a difference from) a new bitmap
+    static void add(bitmap &b, uint32_t value) {
+        if (b.set(value)) return;
+        bitmap single, tmp;
+        single.set(value);
+        b.logicalor(single, tmp);
+        tmp.swap(b);
+    }
+
+    static void remove(bitmap &b, uint32_t value) {
+        bitmap single, tmp;
+        single.set(value);
+        b.logicalandnot(single, tmp);
+        tmp.swap(b);
+    }
+
+    static void add_many(bitmap &b, const uint32_t *values, size_t n) {
+        std::vector<uint32_t> sorted(values, values + n);
+        std::sort(sorted.begin(), sorted.end());
+        bitmap added, tmp;
+        for (size_t j = 0; j < n; ++j) added.set(sorted[j]);
+        b.logicalor(added, tmp);
+        tmp.swap(b);
+    }
+
+    static void optimize(bitmap &b) { b.trim(); }
+
+    static bool contains(const bitmap &b, uint32_t value) {
+        return b.get(value);
+    }
+
+    static uint64_t iterate(const bitmap &b) {
+        uint64_t card = 0;
+        for (auto j = b.begin(); j != b.end(); ++j) {
+            card++;
+        }
+        return card;
+    }
+};
+
+typedef ewah_backend<uint32_t> ewah32_backend;
+typedef ewah_backend<uint64_t> ewah64_backend;
+
+REGISTER_BACKEND(ewah32_backend)
+REGISTER_BACKEND(ewah64_backend)
+
+#endif
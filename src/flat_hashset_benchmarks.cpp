@@ -0,0 +1,411 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#define __STDC_FORMAT_MACROS 1
+#include <inttypes.h>
+#include <cstdint>
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <queue>
+#include <cassert>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "benchmark.h"
+#include "numbersfromtextfiles.h"
+#ifdef __cplusplus
+}
+#endif
+
+#include "memtrackingallocator.h"
+#include "flathashset.h"
+
+/**
+ * The same benchmark as stl_hashset_benchmarks, with an open-addressing
+ * hash set (flathashset.h) instead of the node-based std::unordered_set.
+ * Its memory always goes through MemoryCountingAllocator.
+ */
+void initializeMemUsageCounter()  {
+    memcounters_reset();
+}
+
+uint64_t getMemUsageInBytes()  {
+    return tracked_memory_usage();
+}
+
+typedef flat_hash_set<MemoryCountingAllocator<uint8_t> >  hashset;
+
+/**
+ * Once you have collected all the integers, build the bitmaps.
+ */
+static std::vector<hashset> create_all_bitmaps(size_t *howmany,
+        uint32_t **numbers, size_t count) {
+    if (numbers == NULL) return std::vector<hashset >();
+    std::vector<hashset> answer(count);
+    for (size_t i = 0; i < count; i++) {
+        hashset & bm = answer[i];
+        uint32_t * mynumbers = numbers[i];
+        bm.reserve(howmany[i]);
+        for(size_t j = 0; j < howmany[i] ; ++j) {
+            bm.insert(mynumbers[j]);
+        }
+        bm.shrink_to_fit();
+    }
+    return answer;
+}
+
+
+static void intersection(const hashset& h1, const hashset& h2, hashset& answer) {
+  if(h1.size() > h2.size()) {
+    intersection(h2,h1,answer);
+    return;
+  }
+  answer.clear();
+  h1.for_each([&](uint32_t x) {
+    if(h2.contains(x))
+      answer.insert(x);
+  });
+}
+
+static size_t intersection_count(const hashset& h1, const hashset& h2) {
+  if(h1.size() > h2.size()) {
+    return intersection_count(h2,h1);
+  }
+  size_t answer = 0;
+  h1.for_each([&](uint32_t x) {
+    answer += h2.contains(x);
+  });
+  return answer;
+}
+
+
+static void difference(const hashset& h1, const hashset& h2, hashset& answer) {
+  answer.clear();
+  h1.for_each([&](uint32_t x) {
+    if(!h2.contains(x))
+      answer.insert(x);
+  });
+}
+
+
+static size_t difference_count(const hashset& h1, const hashset& h2) {
+  size_t answer = 0;
+  h1.for_each([&](uint32_t x) {
+    answer += !h2.contains(x);
+  });
+  return answer;
+}
+
+static void symmetric_difference(const hashset& h1, const hashset& h2, hashset& answer) {
+  answer = h1;
+  h2.for_each([&](uint32_t x) {
+    if(!answer.erase(x))
+      answer.insert(x);
+  });
+}
+
+static size_t symmetric_difference_count(const hashset& h1, const hashset& h2) {
+  return h1.size() + h2.size() - 2 * intersection_count(h1,h2);
+}
+
+
+static void inplace_union(hashset& h1, const hashset& h2) {
+  h2.for_each([&](uint32_t x) {
+    h1.insert(x);
+  });
+}
+
+static size_t union_count(const hashset& h1, const hashset& h2) {
+  return h1.size() + h2.size() - intersection_count(h1,h2);
+}
+
+static void printusage(char *command) {
+    printf(
+        " Try %s directory \n where directory could be "
+        "benchmarks/realdata/census1881\n",
+        command);
+    ;
+    printf("the -v flag turns on verbose mode\n");
+    printf("the -b flag reads the data from a binary cache next to the directory, creating it if needed\n");
+    printf("the -j flag sets the number of threads parsing the data files (0: one per processor)\n");
+    printf("the -p flag records hardware performance counters for each phase\n");
+    printf("the -n flag followed by a number repeats each phase that many times and reports statistics\n");
+    printf("the -w flag followed by a number runs each phase that many times before measuring it\n");
+    printf("the -o flag followed by text, json or csv sets the output format\n");
+
+}
+
+
+
+
+int hashset_size_compare (const void * a, const void * b) {
+  return ( *(const hashset**)a)->size() - (*(const hashset**)b)->size() ;
+}
+
+int main(int argc, char **argv) {
+    int c;
+    const char *extension = ".txt";
+    bool verbose = false;
+    uint64_t data[14];
+    initializeMemUsageCounter();
+    while ((c = getopt(argc, argv, "bj:pn:w:o:ve:h")) != -1) switch (c) {
+        case 'e':
+            extension = optarg;
+            break;
+        case 'b':
+            use_binary_cache = true;
+            break;
+        case 'j':
+            loader_threads = atoi(optarg);
+            break;
+        case 'p':
+            perf_counters_enabled = perf_counters_init();
+            break;
+        case 'n':
+            benchmark_repetitions = atoi(optarg);
+            if (benchmark_repetitions < 1) benchmark_repetitions = 1;
+            break;
+        case 'w':
+            benchmark_warmups = atoi(optarg);
+            if (benchmark_warmups < 0) benchmark_warmups = 0;
+            break;
+        case 'o':
+            if (!report_set_format(optarg)) {
+                printf("Unknown output format %s (text, json or csv).\n", optarg);
+                return -1;
+            }
+            break;
+        case 'v':
+            verbose = true;
+            break;
+        case 'h':
+            printusage(argv[0]);
+            return 0;
+        default:
+            abort();
+        }
+    if (optind >= argc) {
+        printusage(argv[0]);
+        return -1;
+    }
+    char *dirname = argv[optind];
+    report_record_flags(argc, argv, optind);
+    size_t count;
+
+
+    size_t *howmany = NULL;
+    uint32_t **numbers =
+        read_all_integer_files(dirname, extension, &howmany, &count);
+    if (numbers == NULL) {
+        printf(
+            "I could not find or load any data file with extension %s in "
+            "directory %s.\n",
+            extension, dirname);
+        return -1;
+    }
+    uint32_t maxvalue = 0;
+    for (size_t i = 0; i < count; i++) {
+      if( howmany[i] > 0 ) {
+        if(maxvalue < numbers[i][howmany[i]-1]) {
+           maxvalue = numbers[i][howmany[i]-1];
+         }
+      }
+    }
+    uint64_t totalcard = 0;
+    for (size_t i = 0; i < count; i++) {
+      totalcard += howmany[i];
+    }
+    uint64_t successivecard = 0;
+    for (size_t i = 1; i < count; i++) {
+      successivecard += howmany[i-1] + howmany[i];
+    }
+
+    std::vector<hashset > bitmaps;
+    BEGIN_SINGLE_PHASE(0)
+    bitmaps = create_all_bitmaps(howmany, numbers, count);
+    END_PHASE(0, data[13])
+    if (bitmaps.empty()) return -1;
+    if(verbose) printf("Loaded %d bitmaps from directory %s \n", (int)count, dirname);
+    if(verbose) printf("Building the bitmaps took %" PRIu64 " cycles\n", data[13]);
+    uint64_t totalsize = getMemUsageInBytes();
+    data[0] = totalsize;
+
+    if(verbose) printf("Total size in bytes =  %" PRIu64 " \n", totalsize);
+
+    uint64_t successive_and = 0;
+    uint64_t successive_or = 0;
+    uint64_t total_or = 0;
+    uint64_t total_count = 0;
+    uint64_t successive_andnot = 0;
+    uint64_t successive_xor = 0;
+
+
+    BEGIN_PHASE(1)
+    successive_and = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+        hashset v;
+        intersection(bitmaps[i], bitmaps[i + 1], v);
+        successive_and += v.size();
+    }
+    END_PHASE(1, data[1])
+    if(verbose) printf("Successive intersections on %zu bitmaps took %" PRIu64 " cycles\n", count,
+                           data[1]);
+
+    BEGIN_PHASE(2)
+    successive_or = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+        hashset v (bitmaps[i]);
+        inplace_union(v, bitmaps[i + 1]);
+        successive_or += v.size();
+    }
+    END_PHASE(2, data[2])
+    if(verbose) printf("Successive unions on %zu bitmaps took %" PRIu64 " cycles\n", count,
+                           data[2]);
+
+    BEGIN_PHASE(3)
+    if(count>1) {
+        hashset v (bitmaps[0]);
+        inplace_union(v, bitmaps[1]);
+        for (int i = 2; i < (int)count ; ++i) {
+            inplace_union(v, bitmaps[i]);
+        }
+        total_or = v.size();
+    }
+    END_PHASE(3, data[3])
+    if(verbose) printf("Total naive unions on %zu bitmaps took %" PRIu64 " cycles\n", count,
+                           data[3]);
+    BEGIN_PHASE(4)
+    if(count>1){
+      hashset **sortedbitmaps = (hashset**) malloc(sizeof(hashset*) * count);
+      for (int i = 0; i < (int)count ; ++i) sortedbitmaps[i] = & bitmaps[i];
+      qsort (sortedbitmaps, count, sizeof(hashset *), hashset_size_compare);
+        hashset v (*sortedbitmaps[0]);
+        for (int i = 1; i < (int)count ; ++i) {
+            inplace_union(v, *sortedbitmaps[i]);
+        }
+        total_or = v.size();
+        free(sortedbitmaps);
+    }
+    END_PHASE(4, data[4])
+    if(verbose) printf("Total sorted unions on %zu bitmaps took %" PRIu64 " cycles\n", count,
+                           data[4]);
+
+    uint64_t quartcount = 0;
+    BEGIN_REPEATED_PHASE(5, quartile_test_repetitions)
+    quartcount = 0;
+    for (size_t i = 0; i < count ; ++i) {
+      quartcount += bitmaps[i].contains(maxvalue/4);
+      quartcount += bitmaps[i].contains(maxvalue/2);
+      quartcount += bitmaps[i].contains(3*maxvalue/4);
+    }
+    END_PHASE(5, data[5])
+
+    if(verbose) printf("Quartile queries on %zu bitmaps took %" PRIu64 " cycles\n", count,
+           data[5]);
+
+    BEGIN_PHASE(6)
+    successive_andnot = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+        hashset v;
+        difference(bitmaps[i], bitmaps[i + 1], v);
+        successive_andnot += v.size();
+    }
+    END_PHASE(6, data[6])
+
+    if(verbose) printf("Successive differences on %zu bitmaps took %" PRIu64 " cycles\n", count,
+           data[6]);
+
+    BEGIN_PHASE(7)
+    successive_xor = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+        hashset v;
+        symmetric_difference(bitmaps[i], bitmaps[i + 1], v);
+        successive_xor += v.size();
+    }
+    END_PHASE(7, data[7])
+
+    if(verbose) printf("Successive symmetric differences on %zu bitmaps took %" PRIu64 " cycles\n", count,
+           data[7]);
+
+    BEGIN_PHASE(8)
+    total_count = 0;
+    for (size_t i = 0; i < count; ++i) {
+        bitmaps[i].for_each([&](uint32_t) {
+            total_count++;
+        });
+    }
+    END_PHASE(8, data[8])
+    assert(total_count == totalcard);
+
+    if(verbose) printf("Iterating over %zu bitmaps took %" PRIu64 " cycles\n", count,
+           data[8]);
+
+
+    if(verbose) printf("Collected stats  %" PRIu64 "  %" PRIu64 "  %" PRIu64 " %" PRIu64 "\n",successive_and,successive_or,total_or,quartcount);
+
+    assert(successive_xor + successive_and == successive_or);
+
+
+    /**
+    * and, or, andnot and xor cardinality
+    */
+    uint64_t successive_andcard = 0;
+    uint64_t successive_orcard = 0;
+    uint64_t successive_andnotcard = 0;
+    uint64_t successive_xorcard = 0;
+
+    BEGIN_PHASE(9)
+    successive_andcard = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+        successive_andcard += intersection_count(bitmaps[i], bitmaps[i + 1]);
+    }
+    END_PHASE(9, data[9])
+
+    BEGIN_PHASE(10)
+    successive_orcard = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+        successive_orcard += union_count(bitmaps[i], bitmaps[i + 1]);
+    }
+    END_PHASE(10, data[10])
+
+    BEGIN_PHASE(11)
+    successive_andnotcard = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+        successive_andnotcard += difference_count(bitmaps[i], bitmaps[i + 1]);
+    }
+    END_PHASE(11, data[11])
+
+    BEGIN_PHASE(12)
+    successive_xorcard = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+        successive_xorcard += symmetric_difference_count(bitmaps[i], bitmaps[i + 1]);
+    }
+    END_PHASE(12, data[12])
+
+    assert(successive_andcard == successive_and);
+    assert(successive_orcard == successive_or);
+    assert(successive_xorcard == successive_xor);
+    assert(successive_andnotcard == successive_andnot);
+
+    /**
+    * end and, or, andnot and xor cardinality
+    */
+    report_cardinalities(successive_and, successive_or, total_or, quartcount,
+                         successive_andnot, successive_xor, total_count);
+    benchmark_report(report_basename(argv[0]), dirname, data, 14, count,
+                     totalcard, successivecard);
+    perf_counters_print();
+    phase_stats_print();
+
+    for (int i = 0; i < (int)count; ++i) {
+        free(numbers[i]);
+        numbers[i] = NULL;  // paranoid
+    }
+    free(howmany);
+    free(numbers);
+
+    return 0;
+}
@@ -0,0 +1,282 @@
+#ifndef INCLUDE_FLATHASHSET_H
+#define INCLUDE_FLATHASHSET_H
+
+/*
+ * An open-addressing hash set of 32-bit integers, for
+ * flat_hashset_benchmarks, laid out as a Swiss table: the slots are split
+ * into groups of 16, and each slot has a control byte that is either
+ * empty, deleted, or holds 7 bits of the hash of its value. A lookup
+ * compares the 16 control bytes of a group with those 7 bits in one SSE2
+ * instruction and only looks at the values that match, moving on to the
+ * next group (quadratic probing over groups) while the group has no empty
+ * slot.
+ *
+ * The values and the control bytes are in a single allocation, obtained
+ * from the allocator so that MemoryCountingAllocator can track it. The
+ * table grows when it is 7/8 full.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <memory>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+template <class Allocator = std::allocator<uint8_t> >
+class flat_hash_set {
+public:
+    static const size_t group_size = 16;
+
+    flat_hash_set() : ctrl(NULL), slots(NULL), capacity(0), count(0), used(0) {}
+
+    flat_hash_set(const flat_hash_set &o)
+        : ctrl(NULL), slots(NULL), capacity(0), count(0), used(0) {
+        if (o.capacity == 0) return;
+        allocate_table(o.capacity);
+        memcpy(ctrl, o.ctrl, capacity);
+        memcpy(slots, o.slots, capacity * sizeof(uint32_t));
+        count = o.count;
+        used = o.used;
+    }
+
+    flat_hash_set &operator=(flat_hash_set o) {
+        swap(o);
+        return *this;
+    }
+
+    ~flat_hash_set() { free_table(); }
+
+    void swap(flat_hash_set &o) {
+        std::swap(ctrl, o.ctrl);
+        std::swap(slots, o.slots);
+        std::swap(capacity, o.capacity);
+        std::swap(count, o.count);
+        std::swap(used, o.used);
+    }
+
+    size_t size() const { return count; }
+
+    bool empty() const { return count == 0; }
+
+    // what the table allocated
+    size_t size_in_bytes() const {
+        return capacity * (1 + sizeof(uint32_t));
+    }
+
+    // make room for n values without growing
+    void reserve(size_t n) {
+        size_t needed = group_size;
+        while (needed - needed / 8 < n) needed *= 2;
+        if (needed > capacity) rehash(needed);
+    }
+
+    // shrink (or grow) the table to the smallest that holds the values
+    void shrink_to_fit() {
+        size_t needed = group_size;
+        while (needed - needed / 8 < count) needed *= 2;
+        if (needed != capacity) rehash(needed);
+    }
+
+    bool contains(uint32_t value) const {
+        if (capacity == 0) return false;
+        const uint64_t h = hash(value);
+        const uint8_t tag = h2(h);
+        size_t group = h1(h);
+        for (size_t step = 1;; step++) {
+            const uint8_t *c = ctrl + group * group_size;
+            for (uint32_t m = match(c, tag); m != 0; m &= m - 1) {
+                if (slots[group * group_size + __builtin_ctz(m)] == value) return true;
+            }
+            if (match(c, empty_slot) != 0) return false;
+            group = (group + step) & (capacity / group_size - 1);
+        }
+    }
+
+    // return true if the value was not there
+    bool insert(uint32_t value) {
+        if (used + 1 > capacity - capacity / 8) {
+            // only tombstones: rehash in place, otherwise grow
+            rehash((count + 1 > (capacity - capacity / 8) / 2) ? std::max(capacity * 2, group_size)
+                                                               : capacity);
+        }
+        const uint64_t h = hash(value);
+        const uint8_t tag = h2(h);
+        size_t group = h1(h);
+        size_t free_slot = (size_t)-1;
+        for (size_t step = 1;; step++) {
+            const uint8_t *c = ctrl + group * group_size;
+            for (uint32_t m = match(c, tag); m != 0; m &= m - 1) {
+                if (slots[group * group_size + __builtin_ctz(m)] == value) return false;
+            }
+            if (free_slot == (size_t)-1) {
+                const uint32_t d = match(c, deleted_slot);
+                if (d != 0) free_slot = group * group_size + __builtin_ctz(d);
+            }
+            const uint32_t e = match(c, empty_slot);
+            if (e != 0) {
+                if (free_slot == (size_t)-1) {
+                    free_slot = group * group_size + __builtin_ctz(e);
+                    used++;
+                }
+                break;
+            }
+            group = (group + step) & (capacity / group_size - 1);
+        }
+        ctrl[free_slot] = tag;
+        slots[free_slot] = value;
+        count++;
+        return true;
+    }
+
+    // return true if the value was there
+    bool erase(uint32_t value) {
+        if (capacity == 0) return false;
+        const uint64_t h = hash(value);
+        const uint8_t tag = h2(h);
+        size_t group = h1(h);
+        for (size_t step = 1;; step++) {
+            const uint8_t *c = ctrl + group * group_size;
+            for (uint32_t m = match(c, tag); m != 0; m &= m - 1) {
+                const size_t s = group * group_size + __builtin_ctz(m);
+                if (slots[s] == value) {
+                    // a group that was never full ends every probe through
+                    // it, so the slot can be emptied rather than deleted
+                    if (match(c, empty_slot) != 0) {
+                        ctrl[s] = empty_slot;
+                        used--;
+                    } else {
+                        ctrl[s] = deleted_slot;
+                    }
+                    count--;
+                    return true;
+                }
+            }
+            if (match(c, empty_slot) != 0) return false;
+            group = (group + step) & (capacity / group_size - 1);
+        }
+    }
+
+    void clear() {
+        if (capacity > 0) memset(ctrl, empty_slot, capacity);
+        count = 0;
+        used = 0;
+    }
+
+    /*
+     * Call f(value) on every value, in no particular order, a group at a
+     * time.
+     */
+    template <class F>
+    void for_each(F f) const {
+        for (size_t g = 0; g < capacity; g += group_size) {
+            for (uint32_t m = full(ctrl + g); m != 0; m &= m - 1) {
+                f(slots[g + __builtin_ctz(m)]);
+            }
+        }
+    }
+
+private:
+    static const uint8_t empty_slot = 0x80;
+    static const uint8_t deleted_slot = 0xFE;
+
+    static uint64_t hash(uint32_t value) {
+        uint64_t h = value * UINT64_C(0x9E3779B97F4A7C15);
+        return h ^ (h >> 29);
+    }
+
+    size_t h1(uint64_t h) const {
+        return (size_t)(h >> 7) & (capacity / group_size - 1);
+    }
+
+    static uint8_t h2(uint64_t h) { return (uint8_t)(h & 0x7F); }
+
+    // bit i is set if control byte i of the group is tag
+    static uint32_t match(const uint8_t *c, uint8_t tag) {
+#ifdef __SSE2__
+        const __m128i group = _mm_loadu_si128((const __m128i *)c);
+        return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)tag)));
+#else
+        uint32_t m = 0;
+        for (size_t i = 0; i < group_size; i++) m |= (uint32_t)(c[i] == tag) << i;
+        return m;
+#endif
+    }
+
+    // bit i is set if slot i of the group holds a value
+    static uint32_t full(const uint8_t *c) {
+#ifdef __SSE2__
+        const __m128i group = _mm_loadu_si128((const __m128i *)c);
+        return (uint32_t)_mm_movemask_epi8(group) ^ 0xFFFF;
+#else
+        uint32_t m = 0;
+        for (size_t i = 0; i < group_size; i++) m |= (uint32_t)((c[i] & 0x80) == 0) << i;
+        return m;
+#endif
+    }
+
+    // the control bytes come first, so that the values are aligned
+    void allocate_table(size_t newcapacity) {
+        typename Allocator::template rebind<uint8_t>::other alloc;
+        uint8_t *memory = alloc.allocate(newcapacity * (1 + sizeof(uint32_t)));
+        ctrl = memory;
+        slots = (uint32_t *)(memory + newcapacity);
+        capacity = newcapacity;
+        memset(ctrl, empty_slot, capacity);
+        count = 0;
+        used = 0;
+    }
+
+    void free_table() {
+        if (capacity == 0) return;
+        typename Allocator::template rebind<uint8_t>::other alloc;
+        alloc.deallocate(ctrl, capacity * (1 + sizeof(uint32_t)));
+        ctrl = NULL;
+        slots = NULL;
+        capacity = 0;
+    }
+
+    void rehash(size_t newcapacity) {
+        flat_hash_set bigger;
+        bigger.allocate_table(newcapacity);
+        for_each([&bigger](uint32_t value) { bigger.insert_new(value); });
+        swap(bigger);
+    }
+
+    // insert a value known to be absent, in a table without tombstones
+    void insert_new(uint32_t value) {
+        const uint64_t h = hash(value);
+        size_t group = h1(h);
+        for (size_t step = 1;; step++) {
+            const uint32_t e = match(ctrl + group * group_size, empty_slot);
+            if (e != 0) {
+                const size_t s = group * group_size + __builtin_ctz(e);
+                ctrl[s] = h2(h);
+                slots[s] = value;
+                count++;
+                used++;
+                return;
+            }
+            group = (group + step) & (capacity / group_size - 1);
+        }
+    }
+
+    uint8_t *ctrl;     // capacity control bytes
+    uint32_t *slots;   // capacity values
+    size_t capacity;   // a power of two, at least group_size (or 0)
+    size_t count;      // values
+    size_t used;       // values and tombstones
+};
+
+template <class Allocator>
+const size_t flat_hash_set<Allocator>::group_size;
+
+template <class Allocator>
+const uint8_t flat_hash_set<Allocator>::empty_slot;
+
+template <class Allocator>
+const uint8_t flat_hash_set<Allocator>::deleted_slot;
+
+#endif
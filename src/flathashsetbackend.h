@@ -0,0 +1,216 @@
+#ifndef INCLUDE_FLATHASHSETBACKEND_H
+#define INCLUDE_FLATHASHSETBACKEND_H
+
+/*
+ * Backend over the open-addressing hash set of flathashset.h, as in
+ * flat_hashset_benchmarks.
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include "bitmapbackend.h"
+#include "flathashset.h"
+
+struct flat_hashset_backend {
+    typedef flat_hash_set<> bitmap;
+
+    static const char *name() { return "flat_hashset"; }
+
+    static void build(bitmap &b, const uint32_t *values, size_t n) {
+        b.reserve(n);
+        for (size_t j = 0; j < n; ++j) {
+            b.insert(values[j]);
+        }
+        b.shrink_to_fit();
+    }
+
+    static void release(bitmap &b) { bitmap().swap(b); }
+
+    // what flat_hashset_benchmarks reports
+    static uint64_t size_in_bytes(const bitmap &b) { return b.size_in_bytes(); }
+
+    static uint64_t and_count(const bitmap &a, const bitmap &b) {
+        if (a.size() > b.size()) return and_count(b, a);
+        uint64_t card = 0;
+        a.for_each([&](uint32_t x) { card += b.contains(x); });
+        return card;
+    }
+
+    static uint64_t or_count(const bitmap &a, const bitmap &b) {
+        return a.size() + b.size() - and_count(a, b);
+    }
+
+    static uint64_t andnot_count(const bitmap &a, const bitmap &b) {
+        uint64_t card = 0;
+        a.for_each([&](uint32_t x) { card += !b.contains(x); });
+        return card;
+    }
+
+    static uint64_t xor_count(const bitmap &a, const bitmap &b) {
+        return a.size() + b.size() - 2 * and_count(a, b);
+    }
+
+    static uint64_t and_op(const bitmap &a, const bitmap &b) {
+        if (a.size() > b.size()) return and_op(b, a);
+        bitmap v;
+        a.for_each([&](uint32_t x) {
+            if (b.contains(x)) v.insert(x);
+        });
+        return v.size();
+    }
+
+    static uint64_t or_op(const bitmap &a, const bitmap &b) {
+        bitmap v(a);
+        b.for_each([&](uint32_t x) { v.insert(x); });
+        return v.size();
+    }
+
+    static uint64_t andnot_op(const bitmap &a, const bitmap &b) {
+        bitmap v;
+        a.for_each([&](uint32_t x) {
+            if (!b.contains(x)) v.insert(x);
+        });
+        return v.size();
+    }
+
+    static uint64_t xor_op(const bitmap &a, const bitmap &b) {
+        bitmap v(a);
+        b.for_each([&](uint32_t x) {
+            if (!v.erase(x)) v.insert(x);
+        });
+        return v.size();
+    }
+
+    static uint64_t wide_or(const std::vector<bitmap> &all) {
+        if (all.empty()) return 0;
+        bitmap v(all[0]);
+        for (size_t i = 1; i < all.size(); ++i) {
+            all[i].for_each([&](uint32_t x) { v.insert(x); });
+        }
+        return v.size();
+    }
+
+    // union in increasing order of size, as flat_hashset_benchmarks does
+    static uint64_t wide_or_heap(const std::vector<bitmap> &all) {
+        if (all.empty()) return 0;
+        std::vector<const bitmap *> sorted(all.size());
+        for (size_t i = 0; i < all.size(); ++i) sorted[i] = &all[i];
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const bitmap *x, const bitmap *y) { return x->size() < y->size(); });
+        bitmap v(*sorted[0]);
+        for (size_t i = 1; i < sorted.size(); ++i) {
+            sorted[i]->for_each([&](uint32_t x) { v.insert(x); });
+        }
+        return v.size();
+    }
+
+    // probe the others with the values of the smallest set, the smaller
+    // sets first since they reject the most
+    static uint64_t wide_and(const bitmap *first, size_t n) {
+        std::vector<const bitmap *> sorted(n);
+        for (size_t i = 0; i < n; ++i) sorted[i] = &first[i];
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const bitmap *x, const bitmap *y) { return x->size() < y->size(); });
+        bitmap v;
+        sorted[0]->for_each([&](uint32_t x) {
+            for (size_t i = 1; i < n; ++i) {
+                if (!sorted[i]->contains(x)) return;
+            }
+            v.insert(x);
+        });
+        return v.size();
+    }
+
+    // probing, as stl_hashset does
+    static uint64_t threshold(const bitmap *first, size_t n, size_t t) {
+        bitmap v;
+        for (size_t i = 0; i + t <= n; ++i) {
+            first[i].for_each([&](uint32_t x) {
+                for (size_t k = 0; k < i; ++k) {
+                    if (first[k].contains(x)) return;
+                }
+                size_t occurrences = 1;
+                for (size_t k = i + 1; (k < n) && (occurrences < t); ++k) {
+                    if (first[k].contains(x)) occurrences++;
+                }
+                if (occurrences >= t) v.insert(x);
+            });
+        }
+        return v.size();
+    }
+
+    // probe the values of short ranges, scan the whole set for long ones
+    static uint64_t range_count(const bitmap &b, uint64_t lo, uint64_t hi) {
+        uint64_t card = 0;
+        if (hi - lo <= b.size()) {
+            for (uint64_t x = lo; x < hi; ++x) card += b.contains((uint32_t)x);
+        } else {
+            b.for_each([&](uint32_t x) { card += (x >= lo) && (x < hi); });
+        }
+        return card;
+    }
+
+    static bool range_intersects(const bitmap &b, uint64_t lo, uint64_t hi) {
+        if (hi - lo <= b.size()) {
+            for (uint64_t x = lo; x < hi; ++x) {
+                if (b.contains((uint32_t)x)) return true;
+            }
+            return false;
+        }
+        return range_count(b, lo, hi) > 0;
+    }
+
+    // in no particular order
+    static void range_values(const bitmap &b, uint64_t lo, uint64_t hi,
+                             std::vector<uint32_t> &out) {
+        if (hi - lo <= b.size()) {
+            for (uint64_t x = lo; x < hi; ++x) {
+                if (b.contains((uint32_t)x)) out.push_back((uint32_t)x);
+            }
+        } else {
+            b.for_each([&](uint32_t x) {
+                if ((x >= lo) && (x < hi)) out.push_back(x);
+            });
+        }
+    }
+
+    // no order: count the smaller values, or partially sort a copy
+    static uint64_t rank(const bitmap &b, uint32_t x) {
+        uint64_t card = 0;
+        b.for_each([&](uint32_t v) { card += (v <= x); });
+        return card;
+    }
+
+    static uint32_t select(const bitmap &b, uint64_t i) {
+        std::vector<uint32_t> values;
+        values.reserve(b.size());
+        b.for_each([&](uint32_t v) { values.push_back(v); });
+        std::nth_element(values.begin(), values.begin() + i, values.end());
+        return values[i];
+    }
+
+    static void add(bitmap &b, uint32_t value) { b.insert(value); }
+
+    static void remove(bitmap &b, uint32_t value) { b.erase(value); }
+
+    static void add_many(bitmap &b, const uint32_t *values, size_t n) {
+        for (size_t j = 0; j < n; ++j) b.insert(values[j]);
+    }
+
+    static void optimize(bitmap &b) { b.shrink_to_fit(); }
+
+    static bool contains(const bitmap &b, uint32_t value) {
+        return b.contains(value);
+    }
+
+    static uint64_t iterate(const bitmap &b) {
+        uint64_t card = 0;
+        b.for_each([&](uint32_t) { card++; });
+        return card;
+    }
+};
+
+REGISTER_BACKEND(flat_hashset_backend)
+
+#endif
@@ -32,18 +32,18 @@ static roaring_bitmap_t **create_all_bitmaps(size_t *howmany,
 #endif
   roaring_bitmap_t **answer = malloc(sizeof(roaring_bitmap_t *) * count);
 #ifdef RECORD_MALLOCS
-  size_t bef = malloced_memory_usage;
+  size_t bef = malloced_memory_usage();
 #endif
   for (size_t i = 0; i < count; i++) {
     answer[i] = roaring_bitmap_of_ptr(howmany[i], numbers[i]);
-    answer[i]->copy_on_write = copyonwrite;
+    roaring_bitmap_set_copy_on_write(answer[i], copyonwrite);
     if (runoptimize)
       roaring_bitmap_run_optimize(answer[i]);
     savedmem += roaring_bitmap_shrink_to_fit(answer[i]);
     *totalsize += roaring_bitmap_portable_size_in_bytes(answer[i]);
   }
 #ifdef RECORD_MALLOCS
-  size_t aft = malloced_memory_usage;
+  size_t aft = malloced_memory_usage();
   totalmalloced += aft - bef;
   if (verbose)
     printf("total malloc: %zu vs. reported %llu (%f %%) \n", totalmalloced,
@@ -71,6 +71,8 @@ static void printusage(char *command) {
   printf("the -r flag turns on run optimization\n");
   printf("the -c flag turns on copy-on-write\n");
   printf("the -v flag turns on verbose mode\n");
+  printf("the -b flag reads the data from a binary cache next to the directory, creating it if needed\n");
+  printf("the -j flag sets the number of threads parsing the data files (0: one per processor)\n");
 }
 
 int main(int argc, char **argv) {
@@ -84,7 +86,7 @@ int main(int argc, char **argv) {
 
   RDTSC_START(cycles_start);
 
-  while ((c = getopt(argc, argv, "cvrm:e:h")) != -1)
+  while ((c = getopt(argc, argv, "bj:cvrm:e:h")) != -1)
     switch (c) {
     case 'e':
       extension = optarg;
@@ -93,6 +95,12 @@ int main(int argc, char **argv) {
       mode = optarg;
       if(verbose) printf("setting mode: %s \n", mode);
       break;
+    case 'b':
+      use_binary_cache = true;
+      break;
+    case 'j':
+      loader_threads = atoi(optarg);
+      break;
     case 'v':
       verbose = true;
       break;
@@ -0,0 +1,94 @@
+#ifndef INCLUDE_MAPPEDSTORE_H
+#define INCLUDE_MAPPEDSTORE_H
+
+/*
+ * A file of serialized bitmaps that is mapped in memory and queried in
+ * place, for the -m flag of roaring_benchmarks and bitmagic_benchmarks.
+ * The executable serializes all of its bitmaps into one buffer, which we
+ * write to the file; it keeps the offset of each bitmap, and reads them
+ * from the mapping.
+ *
+ * A cold query maps the file right after its pages were evicted from the
+ * page cache, so that every page it touches is read from the disk. On a
+ * file system kept in memory (tmpfs), the pages cannot be evicted, and
+ * cold queries only pay for the page faults.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef struct mapped_store_s {
+    const char *data;
+    size_t length;
+} mapped_store_t;
+
+/*
+ * Write the buffer to the file, replacing it, and wait for it to be on
+ * the disk (only then can its pages be evicted).
+ */
+static inline bool mapped_store_create(const char *filename, const char *buffer,
+                                       size_t length) {
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        printf("Could not create file %s\n", filename);
+        return false;
+    }
+    size_t written = 0;
+    while (written < length) {
+        ssize_t w = write(fd, buffer + written, length - written);
+        if (w <= 0) break;
+        written += (size_t)w;
+    }
+    bool ok = (written == length) && (fdatasync(fd) == 0);
+    ok = (close(fd) == 0) && ok;
+    if (!ok) printf("Could not write file %s\n", filename);
+    return ok;
+}
+
+/*
+ * Evict the pages of the file from the page cache. It must not be mapped.
+ */
+static inline void mapped_store_drop_cache(const char *filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+/*
+ * Map the file read-only. The mapping starts on a page boundary, so
+ * offsets aligned in the buffer remain aligned.
+ */
+static inline bool mapped_store_map(mapped_store_t *store, const char *filename) {
+    store->data = NULL;
+    store->length = 0;
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if ((fstat(fd, &st) != 0) || (st.st_size == 0)) {
+        close(fd);
+        return false;
+    }
+    void *mapped = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) return false;
+    store->data = (const char *)mapped;
+    store->length = (size_t)st.st_size;
+    return true;
+}
+
+static inline void mapped_store_unmap(mapped_store_t *store) {
+    if (store->data != NULL) munmap((void *)store->data, store->length);
+    store->data = NULL;
+    store->length = 0;
+}
+
+#endif
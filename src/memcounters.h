@@ -0,0 +1,111 @@
+#ifndef INCLUDE_MEMCOUNTERS_H
+#define INCLUDE_MEMCOUNTERS_H
+
+/*
+ * Memory accounting shared by cmemcounter.h (which intercepts malloc) and
+ * memtrackingallocator.h (an STL allocator). Each thread counts in its own
+ * slot, on its own cache line, with plain loads and relaxed atomic stores:
+ * no locked instruction and no shared cache line on the allocation path.
+ * The totals are summed over the slots when they are read. Threads beyond
+ * the first MEMCOUNTER_SLOTS - 1 share the last slot, which they update
+ * with atomic additions.
+ *
+ * A block freed by another thread than the one that allocated it makes
+ * the usage of one slot go down and of another go up, but the sum is
+ * right. The peak is the sum of the peaks of the slots: exact when a
+ * single thread allocates, an upper bound otherwise.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define MEMCOUNTER_SLOTS 64
+
+typedef struct memcounters_s {
+    int64_t usage;  // bytes allocated minus bytes freed
+    int64_t peak;   // largest usage since memcounters_reset_peak
+    uint64_t allocations;
+    uint64_t bytes;  // requested by the allocations
+} memcounters_t;
+
+typedef struct memcounter_slot_s {
+    memcounters_t c;
+    char padding[64 - sizeof(memcounters_t)];
+} memcounter_slot_t;
+
+static memcounter_slot_t memcounter_slots[MEMCOUNTER_SLOTS] __attribute__((aligned(64)));
+static int memcounter_threads = 0;
+static __thread memcounter_slot_t *memcounter_mine = NULL;
+
+static inline memcounters_t *memcounters_slot(bool *shared) {
+    memcounter_slot_t *s = memcounter_mine;
+    if (s == NULL) {
+        int i = __atomic_fetch_add(&memcounter_threads, 1, __ATOMIC_RELAXED);
+        s = &memcounter_slots[i < MEMCOUNTER_SLOTS - 1 ? i : MEMCOUNTER_SLOTS - 1];
+        memcounter_mine = s;
+    }
+    *shared = (s == &memcounter_slots[MEMCOUNTER_SLOTS - 1]);
+    return &s->c;
+}
+
+// add to a counter that only this thread writes, unless shared
+static inline void memcounters_add(int64_t *counter, int64_t delta, bool shared) {
+    if (shared) {
+        __atomic_fetch_add(counter, delta, __ATOMIC_RELAXED);
+    } else {
+        __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + delta,
+                         __ATOMIC_RELAXED);
+    }
+}
+
+static inline void memcounters_allocate(size_t sz) {
+    bool shared;
+    memcounters_t *c = memcounters_slot(&shared);
+    memcounters_add(&c->usage, (int64_t)sz, shared);
+    memcounters_add((int64_t *)&c->allocations, 1, shared);
+    memcounters_add((int64_t *)&c->bytes, (int64_t)sz, shared);
+    const int64_t usage = __atomic_load_n(&c->usage, __ATOMIC_RELAXED);
+    if (usage > __atomic_load_n(&c->peak, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&c->peak, usage, __ATOMIC_RELAXED);
+    }
+}
+
+static inline void memcounters_free(size_t sz) {
+    bool shared;
+    memcounters_t *c = memcounters_slot(&shared);
+    memcounters_add(&c->usage, -(int64_t)sz, shared);
+}
+
+static inline memcounters_t memcounters_read(void) {
+    memcounters_t total = {0, 0, 0, 0};
+    for (int i = 0; i < MEMCOUNTER_SLOTS; i++) {
+        const memcounters_t *c = &memcounter_slots[i].c;
+        total.usage += __atomic_load_n(&c->usage, __ATOMIC_RELAXED);
+        total.peak += __atomic_load_n(&c->peak, __ATOMIC_RELAXED);
+        total.allocations += __atomic_load_n(&c->allocations, __ATOMIC_RELAXED);
+        total.bytes += __atomic_load_n(&c->bytes, __ATOMIC_RELAXED);
+    }
+    return total;
+}
+
+// between phases, while no other thread allocates
+static inline void memcounters_reset_peak(void) {
+    for (int i = 0; i < MEMCOUNTER_SLOTS; i++) {
+        memcounters_t *c = &memcounter_slots[i].c;
+        __atomic_store_n(&c->peak, __atomic_load_n(&c->usage, __ATOMIC_RELAXED),
+                         __ATOMIC_RELAXED);
+    }
+}
+
+static inline void memcounters_reset(void) {
+    for (int i = 0; i < MEMCOUNTER_SLOTS; i++) {
+        memcounters_t *c = &memcounter_slots[i].c;
+        __atomic_store_n(&c->usage, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&c->peak, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&c->allocations, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&c->bytes, 0, __ATOMIC_RELAXED);
+    }
+}
+
+#endif
@@ -16,8 +16,12 @@
 #include <map>
 #include <vector>
 
+#include "memcounters.h"
 
-uint64_t memory_usage = 0;
+// the bytes allocated through MemoryCountingAllocator and not yet freed
+static inline uint64_t tracked_memory_usage() {
+    return (uint64_t)memcounters_read().usage;
+}
 
 // use this when calling STL object if you want
 // to keep track of memory usage
@@ -57,7 +61,7 @@ public:
     }
 
     pointer allocate(size_type num, const void * p = 0) {
-        memory_usage += num * sizeof(T);
+        memcounters_allocate(num * sizeof(T));
         return base.allocate(num,p);
     }
 
@@ -72,7 +76,7 @@ public:
 
     // deallocate storage p of deleted elements
     void deallocate(pointer p, size_type num ) {
-        memory_usage -= num * sizeof(T);
+        memcounters_free(num * sizeof(T));
         base.deallocate(p,num);
     }
     std::allocator<T> base;
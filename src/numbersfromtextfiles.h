@@ -6,11 +6,17 @@
 #include <dirent.h>
 #include <fcntl.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 /*********************************/
 /********************************
@@ -51,42 +57,243 @@ static char *read_file(const char *filename) {
     return answer;
 }
 
+/**
+ * Parse exactly eight ASCII digits starting at chars (SWAR, no branches).
+ */
+static inline uint32_t parse_eight_digits(const char *chars) {
+    uint64_t val;
+    memcpy(&val, chars, sizeof(val));
+    val = (val & 0x0F0F0F0F0F0F0F0F) * 2561 >> 8;
+    val = (val & 0x00FF00FF00FF00FF) * 6553601 >> 16;
+    return (uint32_t)((val & 0x0000FFFF0000FFFF) * 42949672960001 >> 32);
+}
+
+/**
+ * Append a run of n digits to value (the run is known to be all digits).
+ */
+static inline uint32_t accumulate_digits(uint32_t value, const char *p,
+                                         size_t n) {
+    for (; n >= 8; n -= 8, p += 8)
+        value = value * 100000000 + parse_eight_digits(p);
+    for (; n > 0; n--, p++) value = value * 10 + (uint32_t)(*p - '0');
+    return value;
+}
+
+/**
+ * Decode all integers in buffer[0, length) in a single pass, writing them
+ * to out (which must have room for length / 2 + 1 values). Any non-digit
+ * byte ends an integer. The number of commas seen is written to
+ * separators. Returns the number of integers decoded.
+ *
+ * With AVX2, 32 bytes are classified at a time into a digit mask and
+ * a comma mask; runs of digits are then located with trailing-zero
+ * counts instead of testing every byte.
+ */
+static size_t parse_integers(const char *buffer, size_t length, uint32_t *out,
+                             size_t *separators) {
+    size_t pos = 0;
+    size_t commas = 0;
+    size_t i = 0;
+    uint32_t current = 0;
+    bool indigits = false;
+#ifdef __AVX2__
+    const __m256i before_zero = _mm256_set1_epi8('0' - 1);
+    const __m256i after_nine = _mm256_set1_epi8('9' + 1);
+    const __m256i comma = _mm256_set1_epi8(',');
+    for (; i + 32 <= length; i += 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *)(buffer + i));
+        __m256i digitbytes = _mm256_and_si256(
+            _mm256_cmpgt_epi8(chunk, before_zero),
+            _mm256_cmpgt_epi8(after_nine, chunk));
+        uint64_t digits = (uint32_t)_mm256_movemask_epi8(digitbytes);
+        commas += (size_t)__builtin_popcount(
+            (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, comma)));
+        size_t offset = 0;
+        while (offset < 32) {
+            uint64_t rest = digits >> offset;
+            if (!indigits) {
+                if (rest == 0) break;
+                offset += (size_t)__builtin_ctzll(rest);
+                rest = digits >> offset;
+                current = 0;
+                indigits = true;
+            }
+            // bits past the block are zero, so the run stops there at worst
+            size_t run = (size_t)__builtin_ctzll(~rest);
+            current = accumulate_digits(current, buffer + i + offset, run);
+            offset += run;
+            if (offset < 32) {
+                out[pos++] = current;
+                indigits = false;
+            }
+        }
+    }
+#endif
+    for (; i < length; i++) {
+        char ch = buffer[i];
+        if ((ch >= '0') && (ch <= '9')) {
+            if (!indigits) {
+                current = 0;
+                indigits = true;
+            }
+            current = current * 10 + (uint32_t)(ch - '0');
+        } else {
+            if (ch == ',') ++commas;
+            if (indigits) {
+                out[pos++] = current;
+                indigits = false;
+            }
+        }
+    }
+    if (indigits) out[pos++] = current;
+    *separators = commas;
+    return pos;
+}
+
+/**
+ * The same as parse_integers, for 64-bit integers (read_integer_file64).
+ * Each byte is classified on its own, but runs of eight digits are still
+ * parsed at once.
+ */
+static size_t parse_integers64(const char *buffer, size_t length,
+                               uint64_t *out, size_t *separators) {
+    size_t pos = 0;
+    size_t commas = 0;
+    size_t i = 0;
+    while (i < length) {
+        char ch = buffer[i];
+        if ((ch < '0') || (ch > '9')) {
+            if (ch == ',') ++commas;
+            i++;
+            continue;
+        }
+        size_t end = i + 1;
+        while ((end < length) && (buffer[end] >= '0') && (buffer[end] <= '9')) end++;
+        uint64_t current = 0;
+        for (; i + 8 <= end; i += 8) current = current * 100000000 + parse_eight_digits(buffer + i);
+        for (; i < end; i++) current = current * 10 + (uint64_t)(buffer[i] - '0');
+        out[pos++] = current;
+    }
+    *separators = commas;
+    return pos;
+}
+
 /**
  * Given a file made of comma-separated integers,
  * read it all and generate an array of integers.
  * The caller is responsible for memory de-allocation.
+ *
+ * The file is memory-mapped and decoded in one pass. The output is
+ * allocated for the worst case (every other byte a separator) and
+ * shrunk afterward; pages past the decoded values are never touched.
  */
 static uint32_t *read_integer_file(char *filename, size_t *howmany) {
-    char *buffer = read_file(filename);
-    if (buffer == NULL) return NULL;
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        printf("Could not open file %s\n", filename);
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return NULL;
+    }
+    size_t length = (size_t)st.st_size;
+    const char *buffer = NULL;
+    char *copy = NULL;
+    void *mapped = MAP_FAILED;
+    if (length > 0) {
+        mapped = mmap(NULL, length, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd,
+                      0);
+    }
+    close(fd);
+    if (mapped != MAP_FAILED) {
+        madvise(mapped, length, MADV_SEQUENTIAL);
+        buffer = (const char *)mapped;
+    } else if (length == 0) {
+        buffer = "";
+    } else {
+        // unmappable file: fall back on reading it
+        copy = read_file(filename);
+        if (copy == NULL) return NULL;
+        buffer = copy;
+        length = strlen(copy);
+    }
+    uint32_t *answer = (uint32_t *)malloc((length / 2 + 1) * sizeof(uint32_t));
+    if (answer == NULL) {
+        if (copy != NULL) free(copy);
+        else if (mapped != MAP_FAILED) munmap(mapped, length);
+        return NULL;
+    }
+    size_t commas;
+    size_t pos = parse_integers(buffer, length, answer, &commas);
+    if (copy != NULL) free(copy);
+    else if (mapped != MAP_FAILED) munmap(mapped, length);
+    size_t howmanyints = commas + 1;
+    if (pos != howmanyints) {
+        printf("unexpected number of integers! %d %d \n", (int)pos,
+               (int)howmanyints);
+    }
+    uint32_t *shrunk =
+        (uint32_t *)realloc(answer, (pos > 0 ? pos : 1) * sizeof(uint32_t));
+    if (shrunk != NULL) answer = shrunk;
+    *howmany = pos;
+    return answer;
+}
 
-    size_t howmanyints = 1;
-    size_t i1 = 0;
-    for (; buffer[i1] != '\0'; i1++) {
-        if (buffer[i1] == ',') ++howmanyints;
+/**
+ * The same as read_integer_file, for files of 64-bit integers.
+ */
+static uint64_t *read_integer_file64(char *filename, size_t *howmany) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        printf("Could not open file %s\n", filename);
+        return NULL;
     }
-    uint32_t *answer = (uint32_t *)malloc(howmanyints * sizeof(uint32_t));
-    if (answer == NULL) return NULL;
-    size_t pos = 0;
-    for (size_t i = 0; (i < i1) && (buffer[i] != '\0'); i++) {
-        uint32_t currentint;
-        while ((buffer[i] < '0') || (buffer[i] > '9')) {
-            i++;
-            if (buffer[i] == '\0') goto END;
-        }
-        currentint = (uint32_t)(buffer[i] - '0');
-        i++;
-        for (; (buffer[i] >= '0') && (buffer[i] <= '9'); i++)
-            currentint = currentint * 10 + (uint32_t)(buffer[i] - '0');
-        answer[pos++] = currentint;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return NULL;
+    }
+    size_t length = (size_t)st.st_size;
+    const char *buffer = NULL;
+    char *copy = NULL;
+    void *mapped = MAP_FAILED;
+    if (length > 0) {
+        mapped = mmap(NULL, length, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd,
+                      0);
+    }
+    close(fd);
+    if (mapped != MAP_FAILED) {
+        madvise(mapped, length, MADV_SEQUENTIAL);
+        buffer = (const char *)mapped;
+    } else if (length == 0) {
+        buffer = "";
+    } else {
+        copy = read_file(filename);
+        if (copy == NULL) return NULL;
+        buffer = copy;
+        length = strlen(copy);
+    }
+    uint64_t *answer = (uint64_t *)malloc((length / 2 + 1) * sizeof(uint64_t));
+    if (answer == NULL) {
+        if (copy != NULL) free(copy);
+        else if (mapped != MAP_FAILED) munmap(mapped, length);
+        return NULL;
     }
-END:
+    size_t commas;
+    size_t pos = parse_integers64(buffer, length, answer, &commas);
+    if (copy != NULL) free(copy);
+    else if (mapped != MAP_FAILED) munmap(mapped, length);
+    size_t howmanyints = commas + 1;
     if (pos != howmanyints) {
         printf("unexpected number of integers! %d %d \n", (int)pos,
                (int)howmanyints);
     }
+    uint64_t *shrunk =
+        (uint64_t *)realloc(answer, (pos > 0 ? pos : 1) * sizeof(uint64_t));
+    if (shrunk != NULL) answer = shrunk;
     *howmany = pos;
-    free(buffer);
     return answer;
 }
 
@@ -99,12 +306,12 @@ static bool hasExtension(const char *filename, const char *extension) {
 }
 
 /**
- * read all (count) integer files in a directory. Caller is responsible
- * for memory de-allocation. In case of error, a NULL is returned.
+ * List the files with the given extension in a directory, in alphabetical
+ * order, as full paths. Caller is responsible for memory de-allocation
+ * (see free_file_list). In case of error, a NULL is returned.
  */
-static uint32_t **read_all_integer_files(const char *dirname,
-                                         const char *extension,
-                                         size_t **howmany, size_t *count) {
+static char **list_integer_files(const char *dirname, const char *extension,
+                                 size_t *count) {
     struct dirent **entry_list;
 
     int ci = scandir(dirname, &entry_list, 0, alphasort);
@@ -115,8 +322,7 @@ static uint32_t **read_all_integer_files(const char *dirname,
         if (hasExtension(entry_list[i]->d_name, extension)) ++truec;
     }
     *count = truec;
-    *howmany = (size_t *)malloc(sizeof(size_t) * (*count));
-    uint32_t **answer = (uint32_t **)malloc(sizeof(uint32_t *) * (*count));
+    char **answer = (char **)malloc(sizeof(char *) * (truec > 0 ? truec : 1));
     size_t dirlen = strlen(dirname);
     char *modifdirname = (char *)dirname;
     if (modifdirname[dirlen - 1] != '/') {
@@ -133,9 +339,7 @@ static uint32_t **read_all_integer_files(const char *dirname,
         char *fullpath = (char *)malloc(dirlen + filelen + 1);
         strcpy(fullpath, modifdirname);
         strcpy(fullpath + dirlen, entry_list[i]->d_name);
-        answer[pos] = read_integer_file(fullpath, &((*howmany)[pos]));
-        pos++;
-        free(fullpath);
+        answer[pos++] = fullpath;
     }
     if (modifdirname != dirname) {
         free(modifdirname);
@@ -145,4 +349,419 @@ static uint32_t **read_all_integer_files(const char *dirname,
     return answer;
 }
 
+static void free_file_list(char **files, size_t count) {
+    for (size_t i = 0; i < count; ++i) free(files[i]);
+    free(files);
+}
+
+/*********************************/
+/********************************
+ * Binary cache of a parsed directory.
+ *
+ * Layout (native byte order, little-endian on x86):
+ *   header (integer_cache_header_t)
+ *   count cardinalities (uint64_t)
+ *   payload: for each set, either its values as packed uint32_t, or,
+ *   with INTEGER_CACHE_DELTA, the differences between successive
+ *   values as variable-byte integers.
+ *
+ * The header records a fingerprint of the source files (names, sizes
+ * and modification times) so that a stale cache is rebuilt, and a
+ * checksum of everything after the header so that a damaged cache is
+ * rebuilt as well.
+ *******************************/
+/*********************************/
+
+/**
+ * When set (the -b flag of the benchmark executables), read_all_integer_files
+ * reads the directory from its binary cache, creating the cache if needed.
+ */
+static bool use_binary_cache = false;
+
+#define INTEGER_CACHE_MAGIC "CBMCACHE"
+#define INTEGER_CACHE_VERSION 1
+#define INTEGER_CACHE_DELTA 1
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t count;
+    uint64_t fingerprint;
+    uint64_t checksum;
+} integer_cache_header_t;
+
+static uint64_t cache_hash_bytes(uint64_t h, const void *data, size_t length) {
+    const char *bytes = (const char *)data;
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(word));
+        h = (h ^ word) * UINT64_C(0x100000001b3);
+    }
+    for (; i < length; i++) h = (h ^ (uint8_t)bytes[i]) * UINT64_C(0x100000001b3);
+    return h;
+}
+
+/**
+ * Fingerprint of the source files: any renamed, resized or touched file
+ * changes it.
+ */
+static uint64_t cache_fingerprint(char **files, size_t count,
+                                  const char *extension) {
+    uint64_t h = cache_hash_bytes(UINT64_C(0xcbf29ce484222325), extension,
+                                  strlen(extension));
+    for (size_t i = 0; i < count; i++) {
+        struct stat st;
+        uint64_t meta[3] = {0, 0, 0};
+        if (stat(files[i], &st) == 0) {
+            meta[0] = (uint64_t)st.st_size;
+            meta[1] = (uint64_t)st.st_mtim.tv_sec;
+            meta[2] = (uint64_t)st.st_mtim.tv_nsec;
+        }
+        h = cache_hash_bytes(h, files[i], strlen(files[i]));
+        h = cache_hash_bytes(h, meta, sizeof(meta));
+    }
+    return h;
+}
+
+#define INTEGER_CACHE_DIRECTORY "bincache"
+
+/**
+ * The caches live in the bincache directory of the working directory (the
+ * root of this repository, for the scripts) rather than next to the data,
+ * which may belong to a submodule. The cache of directory
+ * "a/b/census1881/" is "bincache/census1881-H.txt.bincache", where H is a
+ * hash of the real path of the directory.
+ */
+static char *cache_filename(const char *dirname, const char *extension) {
+    size_t dirlen = strlen(dirname);
+    while ((dirlen > 1) && (dirname[dirlen - 1] == '/')) dirlen--;
+    size_t base = dirlen;
+    while ((base > 0) && (dirname[base - 1] != '/')) base--;
+    char *trimmed = strndup(dirname, dirlen);
+    char *real = realpath(trimmed, NULL);
+    const char *path = (real != NULL) ? real : trimmed;
+    const uint64_t h =
+        cache_hash_bytes(UINT64_C(0xcbf29ce484222325), path, strlen(path));
+    mkdir(INTEGER_CACHE_DIRECTORY, 0777);  // fails harmlessly if it exists
+    const size_t length = strlen(INTEGER_CACHE_DIRECTORY) + (dirlen - base) +
+                          strlen(extension) + 32;
+    char *answer = (char *)malloc(length);
+    snprintf(answer, length, "%s/%.*s-%016" PRIx64 "%s.bincache",
+             INTEGER_CACHE_DIRECTORY, (int)(dirlen - base), dirname + base, h,
+             extension);
+    free(real);
+    free(trimmed);
+    return answer;
+}
+
+static size_t varint_encode(uint32_t value, uint8_t *out) {
+    size_t length = 0;
+    while (value >= 0x80) {
+        out[length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[length++] = (uint8_t)value;
+    return length;
+}
+
+/**
+ * Read the cache of a directory into freshly allocated arrays. Returns
+ * NULL if there is no usable cache (missing, stale or damaged).
+ */
+static uint32_t **read_integer_cache(const char *cachename,
+                                     uint64_t fingerprint, size_t expected,
+                                     size_t **howmany) {
+    int fd = open(cachename, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if ((fstat(fd, &st) != 0) ||
+        ((size_t)st.st_size < sizeof(integer_cache_header_t))) {
+        close(fd);
+        return NULL;
+    }
+    size_t length = (size_t)st.st_size;
+    void *mapped = mmap(NULL, length, PROT_READ, MAP_PRIVATE | MAP_POPULATE,
+                        fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) return NULL;
+    const char *base = (const char *)mapped;
+    integer_cache_header_t header;
+    memcpy(&header, base, sizeof(header));
+    size_t tablesize = (size_t)header.count * sizeof(uint64_t);
+    if ((memcmp(header.magic, INTEGER_CACHE_MAGIC, sizeof(header.magic)) != 0) ||
+        (header.version != INTEGER_CACHE_VERSION) ||
+        (header.fingerprint != fingerprint) || (header.count != expected) ||
+        (length - sizeof(header) < tablesize) ||
+        (cache_hash_bytes(UINT64_C(0xcbf29ce484222325), base + sizeof(header),
+                          length - sizeof(header)) != header.checksum)) {
+        munmap(mapped, length);
+        return NULL;
+    }
+    const char *payload = base + sizeof(header) + tablesize;
+    const char *payloadend = base + length;
+    *howmany = (size_t *)malloc(sizeof(size_t) * (expected > 0 ? expected : 1));
+    uint32_t **answer =
+        (uint32_t **)malloc(sizeof(uint32_t *) * (expected > 0 ? expected : 1));
+    bool ok = true;
+    size_t i = 0;
+    for (; i < expected; i++) {
+        uint64_t card;
+        memcpy(&card, base + sizeof(header) + i * sizeof(uint64_t),
+               sizeof(card));
+        (*howmany)[i] = (size_t)card;
+        answer[i] = (uint32_t *)malloc((card > 0 ? card : 1) * sizeof(uint32_t));
+        if (header.flags & INTEGER_CACHE_DELTA) {
+            uint32_t previous = 0;
+            for (size_t j = 0; j < card; j++) {
+                uint32_t delta = 0;
+                int shift = 0;
+                uint8_t byte;
+                do {
+                    if (payload >= payloadend) {
+                        ok = false;
+                        break;
+                    }
+                    byte = (uint8_t)*payload++;
+                    delta |= (uint32_t)(byte & 0x7F) << shift;
+                    shift += 7;
+                } while (byte & 0x80);
+                if (!ok) break;
+                previous += delta;
+                answer[i][j] = previous;
+            }
+        } else {
+            size_t bytes = (size_t)card * sizeof(uint32_t);
+            if ((size_t)(payloadend - payload) < bytes) {
+                ok = false;
+            } else {
+                memcpy(answer[i], payload, bytes);
+                payload += bytes;
+            }
+        }
+        if (!ok) break;
+    }
+    munmap(mapped, length);
+    if (!ok) {
+        for (size_t j = 0; j <= i; j++) free(answer[j]);
+        free(answer);
+        free(*howmany);
+        *howmany = NULL;
+        return NULL;
+    }
+    return answer;
+}
+
+/**
+ * Write the parsed directory to its cache. The differences between
+ * successive values are stored as variable-byte integers when that at
+ * least halves the payload; otherwise the values are stored as is, so
+ * that reading the cache is a plain copy. The cache is written to a
+ * temporary file first and renamed, so readers never see a partial cache.
+ */
+static bool write_integer_cache(const char *cachename, uint64_t fingerprint,
+                                uint32_t **numbers, size_t *howmany,
+                                size_t count) {
+    size_t rawsize = 0;
+    size_t deltasize = 0;
+    uint8_t scratch[5];
+    for (size_t i = 0; i < count; i++) {
+        rawsize += howmany[i] * sizeof(uint32_t);
+        uint32_t previous = 0;
+        for (size_t j = 0; j < howmany[i]; j++) {
+            deltasize += varint_encode(numbers[i][j] - previous, scratch);
+            previous = numbers[i][j];
+        }
+    }
+    bool delta = deltasize * 2 <= rawsize;
+    size_t tablesize = count * sizeof(uint64_t);
+    size_t bodysize = tablesize + (delta ? deltasize : rawsize);
+    char *body = (char *)malloc(bodysize > 0 ? bodysize : 1);
+    if (body == NULL) return false;
+    char *out = body + tablesize;
+    for (size_t i = 0; i < count; i++) {
+        uint64_t card = howmany[i];
+        memcpy(body + i * sizeof(uint64_t), &card, sizeof(card));
+        if (delta) {
+            uint32_t previous = 0;
+            for (size_t j = 0; j < howmany[i]; j++) {
+                out += varint_encode(numbers[i][j] - previous, (uint8_t *)out);
+                previous = numbers[i][j];
+            }
+        } else {
+            memcpy(out, numbers[i], howmany[i] * sizeof(uint32_t));
+            out += howmany[i] * sizeof(uint32_t);
+        }
+    }
+    integer_cache_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, INTEGER_CACHE_MAGIC, sizeof(header.magic));
+    header.version = INTEGER_CACHE_VERSION;
+    header.flags = delta ? INTEGER_CACHE_DELTA : 0;
+    header.count = count;
+    header.fingerprint = fingerprint;
+    header.checksum =
+        cache_hash_bytes(UINT64_C(0xcbf29ce484222325), body, bodysize);
+    size_t namelen = strlen(cachename);
+    char *tmpname = (char *)malloc(namelen + 32);
+    snprintf(tmpname, namelen + 32, "%s.%ld.tmp", cachename, (long)getpid());
+    FILE *fp = fopen(tmpname, "wb");
+    bool ok = (fp != NULL);
+    if (ok) {
+        ok = (fwrite(&header, sizeof(header), 1, fp) == 1) &&
+             ((bodysize == 0) || (fwrite(body, bodysize, 1, fp) == 1));
+        ok = (fclose(fp) == 0) && ok;
+        ok = ok && (rename(tmpname, cachename) == 0);
+        if (!ok) unlink(tmpname);
+    }
+    free(tmpname);
+    free(body);
+    return ok;
+}
+
+/**
+ * Number of threads used by read_all_integer_files to parse the files of
+ * a directory (the -j flag of the benchmark executables); 0 means one
+ * thread per online processor.
+ */
+static int loader_threads = 1;
+
+typedef struct {
+    char **files;
+    size_t count;
+    size_t *howmany;
+    uint32_t **answer;
+    uint64_t **answer64; /* set instead of answer for 64-bit integers */
+    size_t next; /* next file to parse, shared by all workers */
+} integer_file_queue_t;
+
+static void *integer_file_worker(void *arg) {
+    integer_file_queue_t *queue = (integer_file_queue_t *)arg;
+    while (true) {
+        size_t pos = __atomic_fetch_add(&queue->next, 1, __ATOMIC_RELAXED);
+        if (pos >= queue->count) break;
+        if (queue->answer64 != NULL) {
+            queue->answer64[pos] =
+                read_integer_file64(queue->files[pos], &queue->howmany[pos]);
+        } else {
+            queue->answer[pos] =
+                read_integer_file(queue->files[pos], &queue->howmany[pos]);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Run the workers of the queue on up to loader_threads threads. Each
+ * worker repeatedly claims the next unparsed file, so large and small
+ * files balance out; results land at the index of their file, so the
+ * order of the list is preserved.
+ */
+static void run_integer_file_queue(integer_file_queue_t *queue) {
+    size_t count = queue->count;
+    size_t threads = (loader_threads > 0)
+                         ? (size_t)loader_threads
+                         : (size_t)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1) threads = 1;
+    if (threads > count) threads = count;
+    pthread_t *workers = NULL;
+    size_t started = 0;
+    if (threads > 1) {
+        workers = (pthread_t *)malloc(sizeof(pthread_t) * (threads - 1));
+        for (; started < threads - 1; started++) {
+            if (pthread_create(&workers[started], NULL, integer_file_worker,
+                               queue) != 0)
+                break;
+        }
+    }
+    integer_file_worker(queue); /* the calling thread takes part */
+    for (size_t i = 0; i < started; i++) pthread_join(workers[i], NULL);
+    free(workers);
+}
+
+/**
+ * Parse every file of the list (see run_integer_file_queue). Caller is
+ * responsible for memory de-allocation.
+ */
+static uint32_t **read_integer_file_list(char **files, size_t count,
+                                         size_t **howmany) {
+    *howmany = (size_t *)malloc(sizeof(size_t) * (count > 0 ? count : 1));
+    uint32_t **answer =
+        (uint32_t **)malloc(sizeof(uint32_t *) * (count > 0 ? count : 1));
+    integer_file_queue_t queue;
+    queue.files = files;
+    queue.count = count;
+    queue.howmany = *howmany;
+    queue.answer = answer;
+    queue.answer64 = NULL;
+    queue.next = 0;
+    run_integer_file_queue(&queue);
+    return answer;
+}
+
+/**
+ * read all (count) integer files in a directory. Caller is responsible
+ * for memory de-allocation. In case of error, a NULL is returned.
+ *
+ * If use_binary_cache is set, the directory is read from its binary cache
+ * when the cache is up to date, and the cache is (re)built otherwise.
+ */
+static inline uint32_t **read_all_integer_files(const char *dirname,
+                                                const char *extension,
+                                                size_t **howmany,
+                                                size_t *count) {
+    char **files = list_integer_files(dirname, extension, count);
+    if (files == NULL) return NULL;
+    uint32_t **answer = NULL;
+    if (use_binary_cache) {
+        char *cachename = cache_filename(dirname, extension);
+        uint64_t fingerprint = cache_fingerprint(files, *count, extension);
+        answer = read_integer_cache(cachename, fingerprint, *count, howmany);
+        if (answer == NULL) {
+            answer = read_integer_file_list(files, *count, howmany);
+            bool complete = true;
+            for (size_t i = 0; i < *count; i++) {
+                if (answer[i] == NULL) complete = false;
+            }
+            if (complete && !write_integer_cache(cachename, fingerprint, answer, *howmany,
+                                     *count)) {
+                fprintf(stderr, "# could not write the binary cache %s\n", cachename);
+            }
+        }
+        free(cachename);
+    } else {
+        answer = read_integer_file_list(files, *count, howmany);
+    }
+    free_file_list(files, *count);
+    return answer;
+}
+
+/**
+ * read all (count) files of 64-bit integers in a directory. Caller is
+ * responsible for memory de-allocation. In case of error, a NULL is
+ * returned. The binary cache only holds 32-bit integers, so
+ * use_binary_cache is ignored.
+ */
+static inline uint64_t **read_all_integer_files64(const char *dirname,
+                                                  const char *extension,
+                                                  size_t **howmany,
+                                                  size_t *count) {
+    char **files = list_integer_files(dirname, extension, count);
+    if (files == NULL) return NULL;
+    *howmany = (size_t *)malloc(sizeof(size_t) * (*count > 0 ? *count : 1));
+    uint64_t **answer =
+        (uint64_t **)malloc(sizeof(uint64_t *) * (*count > 0 ? *count : 1));
+    integer_file_queue_t queue;
+    queue.files = files;
+    queue.count = *count;
+    queue.howmany = *howmany;
+    queue.answer = NULL;
+    queue.answer64 = answer;
+    queue.next = 0;
+    run_integer_file_queue(&queue);
+    free_file_list(files, *count);
+    return answer;
+}
+
 #endif /* BITMAPSFROMTEXTFILES_H_ */
@@ -0,0 +1,334 @@
+#define __STDC_FORMAT_MACROS 1
+#define _GNU_SOURCE
+
+#include <inttypes.h>
+#include "benchmark.h"
+#include "numbersfromtextfiles.h"
+#include "roaring.c"
+
+/**
+ * The benchmark of roaring_benchmarks over 64-bit integers, with the
+ * roaring64_bitmap_t of CRoaring, on files of 64-bit integers (e.g., made
+ * by gen -H) or of 32-bit integers.
+ */
+
+bool roaring64_iterator_increment(uint64_t value, void *param) {
+    size_t count;
+    memcpy(&count, param, sizeof(uint64_t));
+    count++;
+    memcpy(param, &count, sizeof(uint64_t));
+    (void) value;
+    return true;  // continue till the end
+}
+
+/**
+ * Once you have collected all the integers, build the bitmaps.
+ */
+static roaring64_bitmap_t **create_all_bitmaps(size_t *howmany,
+        uint64_t **numbers, size_t count, bool runoptimize, uint64_t * totalsize) {
+    *totalsize = 0;
+    if (numbers == NULL) return NULL;
+    roaring64_bitmap_t **answer = malloc(sizeof(roaring64_bitmap_t *) * count);
+    for (size_t i = 0; i < count; i++) {
+        answer[i] = roaring64_bitmap_of_ptr(howmany[i], numbers[i]);
+        if(runoptimize) roaring64_bitmap_run_optimize(answer[i]);
+        *totalsize += roaring64_bitmap_portable_size_in_bytes(answer[i]);
+    }
+    return answer;
+}
+
+static int roaring64_cardinality_compare(const void *a, const void *b) {
+    uint64_t ca = roaring64_bitmap_get_cardinality(*(const roaring64_bitmap_t **)a);
+    uint64_t cb = roaring64_bitmap_get_cardinality(*(const roaring64_bitmap_t **)b);
+    return (ca > cb) - (ca < cb);
+}
+
+static void printusage(char *command) {
+    printf(
+        " Try %s directory \n where directory could be "
+        "benchmarks/realdata/census1881\n",
+        command);
+    ;
+    printf("the -r flag turns on run optimization\n");
+    printf("the -v flag turns on verbose mode\n");
+    printf("the -b flag is accepted as in the other executables, but the binary cache only holds 32-bit integers\n");
+    printf("the -j flag sets the number of threads parsing the data files (0: one per processor)\n");
+    printf("the -p flag records hardware performance counters for each phase\n");
+    printf("the -n flag followed by a number repeats each phase that many times and reports statistics\n");
+    printf("the -w flag followed by a number runs each phase that many times before measuring it\n");
+    printf("the -o flag followed by text, json or csv sets the output format\n");
+
+}
+
+
+int main(int argc, char **argv) {
+    int c;
+    bool runoptimize = false;
+    bool verbose = false;
+    char *extension = ".txt";
+    uint64_t data[14];
+    while ((c = getopt(argc, argv, "bj:pn:w:o:vre:h")) != -1) switch (c) {
+        case 'e':
+            extension = optarg;
+            break;
+        case 'b':
+            use_binary_cache = true;
+            break;
+        case 'j':
+            loader_threads = atoi(optarg);
+            break;
+        case 'p':
+            perf_counters_enabled = perf_counters_init();
+            break;
+        case 'n':
+            benchmark_repetitions = atoi(optarg);
+            if (benchmark_repetitions < 1) benchmark_repetitions = 1;
+            break;
+        case 'w':
+            benchmark_warmups = atoi(optarg);
+            if (benchmark_warmups < 0) benchmark_warmups = 0;
+            break;
+        case 'o':
+            if (!report_set_format(optarg)) {
+                printf("Unknown output format %s (text, json or csv).\n", optarg);
+                return -1;
+            }
+            break;
+        case 'v':
+            verbose = true;
+            break;
+        case 'r':
+            runoptimize = true;
+            if(verbose) printf("enabling run optimization\n");
+            break;
+        case 'h':
+            printusage(argv[0]);
+            return 0;
+        default:
+            abort();
+        }
+    if (optind >= argc) {
+        printusage(argv[0]);
+        return -1;
+    }
+    char *dirname = argv[optind];
+    report_record_flags(argc, argv, optind);
+    size_t count;
+
+    size_t *howmany = NULL;
+    uint64_t **numbers =
+        read_all_integer_files64(dirname, extension, &howmany, &count);
+    if (numbers == NULL) {
+        printf(
+            "I could not find or load any data file with extension %s in "
+            "directory %s.\n",
+            extension, dirname);
+        return -1;
+    }
+    uint64_t maxvalue = 0;
+    for (size_t i = 0; i < count; i++) {
+        if( howmany[i] > 0 ) {
+            if(maxvalue < numbers[i][howmany[i]-1]) {
+                maxvalue = numbers[i][howmany[i]-1];
+            }
+        }
+    }
+    uint64_t totalcard = 0;
+    for (size_t i = 0; i < count; i++) {
+        totalcard += howmany[i];
+    }
+    uint64_t successivecard = 0;
+    for (size_t i = 1; i < count; i++) {
+        successivecard += howmany[i-1] + howmany[i];
+    }
+
+    uint64_t totalsize = 0;
+    roaring64_bitmap_t **bitmaps = NULL;
+    BEGIN_SINGLE_PHASE(0)
+    bitmaps = create_all_bitmaps(howmany, numbers, count, runoptimize, &totalsize);
+    END_PHASE(0, data[13])
+    if (bitmaps == NULL) return -1;
+    if(verbose) printf("Loaded %d bitmaps from directory %s \n", (int)count, dirname);
+    if(verbose) printf("Building the bitmaps took %" PRIu64 " cycles\n", data[13]);
+    data[0] = totalsize;
+    if(verbose) printf("Total size in bytes =  %" PRIu64 " \n", totalsize);
+    uint64_t successive_and = 0;
+    uint64_t successive_or = 0;
+    uint64_t total_or = 0;
+    uint64_t total_count = 0;
+
+    BEGIN_PHASE(1)
+    successive_and = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+        roaring64_bitmap_t *tempand =
+            roaring64_bitmap_and(bitmaps[i], bitmaps[i + 1]);
+        successive_and += roaring64_bitmap_get_cardinality(tempand);
+        roaring64_bitmap_free(tempand);
+    }
+    END_PHASE(1, data[1])
+
+    if(verbose) printf("Successive intersections on %zu bitmaps took %" PRIu64 " cycles\n", count,
+                           data[1]);
+
+    BEGIN_PHASE(2)
+    successive_or = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+        roaring64_bitmap_t *tempor =
+            roaring64_bitmap_or(bitmaps[i], bitmaps[i + 1]);
+        successive_or += roaring64_bitmap_get_cardinality(tempor);
+        roaring64_bitmap_free(tempor);
+    }
+    END_PHASE(2, data[2])
+    if(verbose) printf("Successive unions on %zu bitmaps took %" PRIu64 " cycles\n", count,
+                           data[2]);
+    BEGIN_PHASE(3)
+    if(count>0) {
+        roaring64_bitmap_t * totalorbitmap = roaring64_bitmap_copy(bitmaps[0]);
+        for (size_t i = 1; i < count; ++i) {
+            roaring64_bitmap_or_inplace(totalorbitmap, bitmaps[i]);
+        }
+        total_or = roaring64_bitmap_get_cardinality(totalorbitmap);
+        roaring64_bitmap_free(totalorbitmap);
+    }
+    END_PHASE(3, data[3])
+    if(verbose) printf("Total naive unions on %zu bitmaps took %" PRIu64 " cycles\n", count,
+                           data[3]);
+    // there is no wide union for 64-bit bitmaps: union in increasing order
+    // of cardinality, as stl_hashset_benchmarks does
+    BEGIN_PHASE(4)
+    if(count>0) {
+        roaring64_bitmap_t **sortedbitmaps = malloc(sizeof(roaring64_bitmap_t *) * count);
+        memcpy(sortedbitmaps, bitmaps, sizeof(roaring64_bitmap_t *) * count);
+        qsort(sortedbitmaps, count, sizeof(roaring64_bitmap_t *), roaring64_cardinality_compare);
+        roaring64_bitmap_t * totalorbitmapsorted = roaring64_bitmap_copy(sortedbitmaps[0]);
+        for (size_t i = 1; i < count; ++i) {
+            roaring64_bitmap_or_inplace(totalorbitmapsorted, sortedbitmaps[i]);
+        }
+        total_or = roaring64_bitmap_get_cardinality(totalorbitmapsorted);
+        roaring64_bitmap_free(totalorbitmapsorted);
+        free(sortedbitmaps);
+    }
+    END_PHASE(4, data[4])
+    if(verbose) printf("Total sorted unions on %zu bitmaps took %" PRIu64 " cycles\n", count,
+                           data[4]);
+
+    uint64_t quartcount = 0;
+    BEGIN_REPEATED_PHASE(5, quartile_test_repetitions)
+    quartcount = 0;
+    for (size_t i = 0; i < count ; ++i) {
+        quartcount += roaring64_bitmap_contains(bitmaps[i],maxvalue/4);
+        quartcount += roaring64_bitmap_contains(bitmaps[i],maxvalue/2);
+        quartcount += roaring64_bitmap_contains(bitmaps[i],3*maxvalue/4);
+    }
+    END_PHASE(5, data[5])
+
+    if(verbose) printf("Quartile queries on %zu bitmaps took %" PRIu64 " cycles\n", count,
+                           data[5]);
+
+    uint64_t successive_andnot = 0;
+    uint64_t successive_xor = 0;
+
+    BEGIN_PHASE(6)
+    successive_andnot = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+        roaring64_bitmap_t *tempandnot =
+            roaring64_bitmap_andnot(bitmaps[i], bitmaps[i + 1]);
+        successive_andnot += roaring64_bitmap_get_cardinality(tempandnot);
+        roaring64_bitmap_free(tempandnot);
+    }
+    END_PHASE(6, data[6])
+
+    if(verbose) printf("Successive differences on %zu bitmaps took %" PRIu64 " cycles\n", count,
+                           data[6]);
+
+
+    BEGIN_PHASE(7)
+    successive_xor = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+        roaring64_bitmap_t *tempxor =
+            roaring64_bitmap_xor(bitmaps[i], bitmaps[i + 1]);
+        successive_xor += roaring64_bitmap_get_cardinality(tempxor);
+        roaring64_bitmap_free(tempxor);
+    }
+    END_PHASE(7, data[7])
+
+    if(verbose) printf("Successive symmetric differences on %zu bitmaps took %" PRIu64 " cycles\n", count,
+                           data[7]);
+
+    BEGIN_PHASE(8)
+    total_count = 0;
+    for (size_t i = 0; i < count; ++i) {
+        roaring64_bitmap_iterate(bitmaps[i], roaring64_iterator_increment, &total_count);
+    }
+    END_PHASE(8, data[8])
+    if(verbose) printf("Iterating over %zu bitmaps took %" PRIu64 " cycles\n", count,
+                           data[8]);
+
+    assert(totalcard == total_count);
+
+    if(verbose) printf("Collected stats  %" PRIu64 "  %" PRIu64 "  %" PRIu64 " %" PRIu64 "\n",successive_and,successive_or,total_or,quartcount);
+
+    /**
+    * and, or, andnot and xor cardinality
+    */
+    uint64_t successive_andcard = 0;
+    uint64_t successive_orcard = 0;
+    uint64_t successive_andnotcard = 0;
+    uint64_t successive_xorcard = 0;
+
+    BEGIN_PHASE(9)
+    successive_andcard = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+        successive_andcard += roaring64_bitmap_and_cardinality(bitmaps[i], bitmaps[i + 1]);
+    }
+    END_PHASE(9, data[9])
+
+    BEGIN_PHASE(10)
+    successive_orcard = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+        successive_orcard += roaring64_bitmap_or_cardinality(bitmaps[i], bitmaps[i + 1]);
+    }
+    END_PHASE(10, data[10])
+
+    BEGIN_PHASE(11)
+    successive_andnotcard = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+        successive_andnotcard += roaring64_bitmap_andnot_cardinality(bitmaps[i], bitmaps[i + 1]);
+    }
+    END_PHASE(11, data[11])
+
+    BEGIN_PHASE(12)
+    successive_xorcard = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+        successive_xorcard += roaring64_bitmap_xor_cardinality(bitmaps[i], bitmaps[i + 1]);
+    }
+    END_PHASE(12, data[12])
+
+    assert(successive_andcard == successive_and);
+    assert(successive_orcard == successive_or);
+    assert(successive_xorcard == successive_xor);
+    assert(successive_andnotcard == successive_andnot);
+
+    /**
+    * end and, or, andnot and xor cardinality
+    */
+
+
+    report_cardinalities(successive_and, successive_or, total_or, quartcount,
+                         successive_andnot, successive_xor, total_count);
+    benchmark_report(report_basename(argv[0]), dirname, data, 14, count,
+                     totalcard, successivecard);
+    perf_counters_print();
+    phase_stats_print();
+
+    for (int i = 0; i < (int)count; ++i) {
+        free(numbers[i]);
+        numbers[i] = NULL;  // paranoid
+        roaring64_bitmap_free(bitmaps[i]);
+        bitmaps[i] = NULL;  // paranoid
+    }
+    free(bitmaps);
+    free(howmany);
+    free(numbers);
+    return 0;
+}
@@ -9,6 +9,9 @@
 #include "benchmark.h"
 #include "numbersfromtextfiles.h"
 #include "roaring.c"
+#include "roaringparallel.h"
+#include "mappedstore.h"
+#include "arena.h"
 
 bool roaring_iterator_increment(uint32_t value, void *param) {
     size_t count;
@@ -19,6 +22,52 @@ bool roaring_iterator_increment(uint32_t value, void *param) {
     return true;  // continue till the end
 }
 
+/**
+ * With -A, the temporary results come from the arena (see arena.h), through
+ * the memory hooks of CRoaring. Anything else goes to the system allocator.
+ */
+static void *arena_roaring_malloc(size_t size) {
+    return arena_active ? arena_alloc(size, 16) : malloc(size);
+}
+
+static void *arena_roaring_realloc(void *p, size_t size) {
+    if (p == NULL) return arena_roaring_malloc(size);
+    if (!arena_owns(p)) return realloc(p, size);
+    if (arena_active) return arena_realloc(p, size);
+    // the next arena_reset would clobber the block: move it out
+    const size_t oldsize = arena_block_size(p);
+    void *answer = malloc(size);
+    if (answer != NULL) memcpy(answer, p, oldsize < size ? oldsize : size);
+    return answer;
+}
+
+static void *arena_roaring_calloc(size_t n, size_t size) {
+    if (!arena_active) return calloc(n, size);
+    void *p = arena_alloc(n * size, 16);
+    if (p != NULL) memset(p, 0, n * size);
+    return p;
+}
+
+static void arena_roaring_free(void *p) {
+    if ((p != NULL) && !arena_owns(p)) free(p);
+}
+
+static void *arena_roaring_aligned_malloc(size_t alignment, size_t size) {
+    if (arena_active) return arena_alloc(size, alignment);
+    void *p = NULL;
+    return posix_memalign(&p, alignment, size) == 0 ? p : NULL;
+}
+
+static void arena_roaring_hooks(void) {
+    roaring_memory_t hooks = {.malloc = arena_roaring_malloc,
+                              .realloc = arena_roaring_realloc,
+                              .calloc = arena_roaring_calloc,
+                              .free = arena_roaring_free,
+                              .aligned_malloc = arena_roaring_aligned_malloc,
+                              .aligned_free = arena_roaring_free};
+    roaring_init_memory_hook(hooks);
+}
+
 /**
  * Once you have collected all the integers, build the bitmaps.
  */
@@ -32,17 +81,17 @@ static roaring_bitmap_t **create_all_bitmaps(size_t *howmany,
 #endif
     roaring_bitmap_t **answer = malloc(sizeof(roaring_bitmap_t *) * count);
 #ifdef RECORD_MALLOCS
-    size_t bef = malloced_memory_usage;
+    size_t bef = malloced_memory_usage();
 #endif
     for (size_t i = 0; i < count; i++) {
         answer[i] = roaring_bitmap_of_ptr(howmany[i], numbers[i]);
-        answer[i]->copy_on_write = copyonwrite;
+        roaring_bitmap_set_copy_on_write(answer[i], copyonwrite);
         if(runoptimize) roaring_bitmap_run_optimize(answer[i]);
         savedmem += roaring_bitmap_shrink_to_fit(answer[i]);
         *totalsize += roaring_bitmap_portable_size_in_bytes(answer[i]);
     }
 #ifdef RECORD_MALLOCS
-    size_t aft = malloced_memory_usage;
+    size_t aft = malloced_memory_usage();
     totalmalloced += aft - bef;
     if(verbose) printf("total malloc: %zu vs. reported %llu (%f %%) \n",totalmalloced,(unsigned long long)*totalsize,(totalmalloced-*totalsize)*100.0/ *totalsize);
     *totalsize = totalmalloced;
@@ -51,15 +100,94 @@ static roaring_bitmap_t **create_all_bitmaps(size_t *howmany,
     return answer;
 }
 
+/**
+ * Write the frozen serialization of every bitmap, one after the other, into
+ * a new buffer (to free) of offsets[count] bytes. A frozen view needs the
+ * exact size of the serialization and a 32-byte boundary: bitmap i starts
+ * at offsets[i], a multiple of 32, and takes sizes[i] bytes.
+ */
+static char *frozen_serialize_all(roaring_bitmap_t **bitmaps, size_t count,
+        size_t *offsets, size_t *sizes) {
+    offsets[0] = 0;
+    for (size_t i = 0; i < count; i++) {
+        sizes[i] = roaring_bitmap_frozen_size_in_bytes(bitmaps[i]);
+        offsets[i + 1] = offsets[i] + ((sizes[i] + 31) & ~(size_t)31);
+    }
+    char *buffer = NULL;
+    if (posix_memalign((void **)&buffer, 32, offsets[count] + 32) != 0) return NULL;
+    for (size_t i = 0; i < count; i++) {
+        roaring_bitmap_frozen_serialize(bitmaps[i], buffer + offsets[i]);
+    }
+    return buffer;
+}
+
+static bool frozen_view_all(const char *buffer, const size_t *offsets,
+        const size_t *sizes, size_t count, const roaring_bitmap_t **views) {
+    bool ok = true;
+    for (size_t i = 0; i < count; i++) {
+        views[i] = roaring_bitmap_frozen_view(buffer + offsets[i], sizes[i]);
+        ok = ok && (views[i] != NULL);
+    }
+    return ok;
+}
+
+static void free_views(const roaring_bitmap_t **views, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (views[i] != NULL) roaring_bitmap_free(views[i]);
+        views[i] = NULL;
+    }
+}
+
+/**
+ * The queries of the -m flag over views of the bitmaps: successive
+ * intersections, union counts and quartile queries, as in phases 1, 10
+ * and 5.
+ */
+static uint64_t mapped_query(int query, const roaring_bitmap_t **views,
+        size_t count, uint32_t maxvalue) {
+    uint64_t answer = 0;
+    switch (query) {
+        case 0:
+            for (size_t i = 0; i + 1 < count; ++i) {
+                roaring_bitmap_t *tempand = roaring_bitmap_and(views[i], views[i + 1]);
+                answer += roaring_bitmap_get_cardinality(tempand);
+                roaring_bitmap_free(tempand);
+            }
+            break;
+        case 1:
+            for (size_t i = 0; i + 1 < count; ++i) {
+                answer += roaring_bitmap_or_cardinality(views[i], views[i + 1]);
+            }
+            break;
+        default:
+            for (size_t i = 0; i < count; ++i) {
+                answer += roaring_bitmap_contains(views[i], maxvalue / 4);
+                answer += roaring_bitmap_contains(views[i], maxvalue / 2);
+                answer += roaring_bitmap_contains(views[i], 3 * maxvalue / 4);
+            }
+    }
+    return answer;
+}
+
 static void printusage(char *command) {
     printf(
         " Try %s directory \n where directory could be "
         "benchmarks/realdata/census1881\n",
         command);
     ;
-    printf("the -r flag turns on run optimization");
-    printf("the -c flag turns on copy-on-write");
-    printf("the -v flag turns on verbose mode");
+    printf("the -r flag turns on run optimization\n");
+    printf("the -c flag turns on copy-on-write\n");
+    printf("the -t flag followed by a number of threads adds a column for a parallel total union\n");
+    printf("the -v flag turns on verbose mode\n");
+    printf("the -b flag reads the data from a binary cache next to the directory, creating it if needed\n");
+    printf("the -j flag sets the number of threads parsing the data files (0: one per processor)\n");
+    printf("the -p flag records hardware performance counters for each phase\n");
+    printf("the -n flag followed by a number repeats each phase that many times and reports statistics\n");
+    printf("the -w flag followed by a number runs each phase that many times before measuring it\n");
+    printf("the -o flag followed by text, json or csv sets the output format\n");
+    printf("the -s flag measures serialization, deserialization and frozen views\n");
+    printf("the -m flag followed by a file name writes the frozen bitmaps to that file and queries them through a mapping, cold and warm\n");
+    printf("the -A flag takes the temporary results from an arena reset between operations (not with -c)\n");
 
 }
 
@@ -69,12 +197,38 @@ int main(int argc, char **argv) {
     bool runoptimize = false;
     bool verbose = false;
     bool copyonwrite = false;
+    bool serialize = false;
+    const char *mappedfile = NULL;
+    int threads = 0;
     char *extension = ".txt";
-    uint64_t data[13];
-    while ((c = getopt(argc, argv, "cvre:h")) != -1) switch (c) {
+    uint64_t data[15];
+    while ((c = getopt(argc, argv, "bj:pn:w:o:t:m:cvrsAe:h")) != -1) switch (c) {
         case 'e':
             extension = optarg;
             break;
+        case 'b':
+            use_binary_cache = true;
+            break;
+        case 'j':
+            loader_threads = atoi(optarg);
+            break;
+        case 'p':
+            perf_counters_enabled = perf_counters_init();
+            break;
+        case 'n':
+            benchmark_repetitions = atoi(optarg);
+            if (benchmark_repetitions < 1) benchmark_repetitions = 1;
+            break;
+        case 'w':
+            benchmark_warmups = atoi(optarg);
+            if (benchmark_warmups < 0) benchmark_warmups = 0;
+            break;
+        case 'o':
+            if (!report_set_format(optarg)) {
+                printf("Unknown output format %s (text, json or csv).\n", optarg);
+                return -1;
+            }
+            break;
         case 'v':
             verbose = true;
             break;
@@ -82,6 +236,18 @@ int main(int argc, char **argv) {
             runoptimize = true;
             if(verbose) printf("enabling run optimization\n");
             break;
+        case 't':
+            threads = atoi(optarg);
+            break;
+        case 's':
+            serialize = true;
+            break;
+        case 'm':
+            mappedfile = optarg;
+            break;
+        case 'A':
+            arena_enabled = true;
+            break;
         case 'c':
             copyonwrite = true;
             if(verbose) printf("enabling copyonwrite\n");
@@ -96,7 +262,16 @@ int main(int argc, char **argv) {
         printusage(argv[0]);
         return -1;
     }
+    if (arena_enabled) {
+        // with copy-on-write, results share containers with the bitmaps
+        if (copyonwrite) {
+            printf("The -A flag cannot be combined with -c.\n");
+            return -1;
+        }
+        arena_roaring_hooks();
+    }
     char *dirname = argv[optind];
+    report_record_flags(argc, argv, optind);
     size_t count;
 
     size_t *howmany = NULL;
@@ -125,14 +300,15 @@ int main(int argc, char **argv) {
     for (size_t i = 1; i < count; i++) {
         successivecard += howmany[i-1] + howmany[i];
     }
-    uint64_t cycles_start = 0, cycles_final = 0;
 
-    RDTSC_START(cycles_start);
     uint64_t totalsize = 0;
-    roaring_bitmap_t **bitmaps = create_all_bitmaps(howmany, numbers, count,runoptimize,copyonwrite, verbose, &totalsize);
-    RDTSC_FINAL(cycles_final);
+    roaring_bitmap_t **bitmaps = NULL;
+    BEGIN_SINGLE_PHASE(0)
+    bitmaps = create_all_bitmaps(howmany, numbers, count,runoptimize,copyonwrite, verbose, &totalsize);
+    END_PHASE(0, data[13])
     if (bitmaps == NULL) return -1;
     if(verbose) printf("Loaded %d bitmaps from directory %s \n", (int)count, dirname);
+    if(verbose) printf("Building the bitmaps took %" PRIu64 " cycles\n", data[13]);
     data[0] = totalsize;
     if(verbose) printf("Total size in bytes =  %" PRIu64 " \n", totalsize);
     uint64_t successive_and = 0;
@@ -140,56 +316,79 @@ int main(int argc, char **argv) {
     uint64_t total_or = 0;
     uint64_t total_count = 0;
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(1)
+    arena_start();
+    successive_and = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         roaring_bitmap_t *tempand =
             roaring_bitmap_and(bitmaps[i], bitmaps[i + 1]);
         successive_and += roaring_bitmap_get_cardinality(tempand);
         roaring_bitmap_free(tempand);
+        arena_reset();
     }
-    RDTSC_FINAL(cycles_final);
-    data[1] = cycles_final - cycles_start;
+    arena_stop();
+    END_PHASE(1, data[1])
 
     if(verbose) printf("Successive intersections on %zu bitmaps took %" PRIu64 " cycles\n", count,
-                           cycles_final - cycles_start);
+                           data[1]);
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(2)
+    arena_start();
+    successive_or = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         roaring_bitmap_t *tempor =
             roaring_bitmap_or(bitmaps[i], bitmaps[i + 1]);
         successive_or += roaring_bitmap_get_cardinality(tempor);
         roaring_bitmap_free(tempor);
+        arena_reset();
     }
-    RDTSC_FINAL(cycles_final);
+    arena_stop();
+    END_PHASE(2, data[2])
     if(verbose) printf("Successive unions on %zu bitmaps took %" PRIu64 " cycles\n", count,
-                           cycles_final - cycles_start);
-    data[2] = cycles_final - cycles_start;
-    RDTSC_START(cycles_start);
+                           data[2]);
+    BEGIN_PHASE(3)
+    arena_start(); // intermediate results pile up until arena_stop (see arena.h)
     roaring_bitmap_t * totalorbitmap = roaring_bitmap_or_many(count,(const roaring_bitmap_t **)bitmaps);
     total_or = roaring_bitmap_get_cardinality(totalorbitmap);
     roaring_bitmap_free(totalorbitmap);
-    RDTSC_FINAL(cycles_final);
+    arena_stop();
+    END_PHASE(3, data[3])
     if(verbose) printf("Total unions on %zu bitmaps took %" PRIu64 " cycles\n", count,
-                           cycles_final - cycles_start);
-    data[3] = cycles_final - cycles_start;
-    RDTSC_START(cycles_start);
+                           data[3]);
+    BEGIN_PHASE(4)
+    arena_start(); // intermediate results pile up until arena_stop (see arena.h)
     roaring_bitmap_t * totalorbitmapheap = roaring_bitmap_or_many_heap(count,(const roaring_bitmap_t **)bitmaps);
     total_or = roaring_bitmap_get_cardinality(totalorbitmapheap);
     roaring_bitmap_free(totalorbitmapheap);
-    RDTSC_FINAL(cycles_final);
+    arena_stop();
+    END_PHASE(4, data[4])
     if(verbose) printf("Total unions with heap on %zu bitmaps took %" PRIu64 " cycles\n", count,
-                           cycles_final - cycles_start);
-    data[4] = cycles_final - cycles_start;
+                           data[4]);
+
+    data[14] = 0;
+    if (threads > 0) {
+        parallel_union_pool_t *pool = parallel_union_pool_create(threads, count);
+        uint64_t parallel_or = 0;
+        BEGIN_PHASE(13)
+        roaring_bitmap_t * totalorbitmapparallel = roaring_bitmap_or_many_parallel(pool, count,(const roaring_bitmap_t **)bitmaps);
+        parallel_or = roaring_bitmap_get_cardinality(totalorbitmapparallel);
+        roaring_bitmap_free(totalorbitmapparallel);
+        END_PHASE(13, data[14])
+        parallel_union_pool_free(pool);
+        assert(parallel_or == total_or);
+        if(verbose) printf("Total parallel unions on %zu bitmaps with %d threads took %" PRIu64 " cycles\n", count,
+                               threads, data[14]);
+    }
 
-    uint64_t quartcount;
-    STARTBEST(quartile_test_repetitions)
+    uint64_t quartcount = 0;
+    BEGIN_REPEATED_PHASE(5, quartile_test_repetitions)
     quartcount = 0;
     for (size_t i = 0; i < count ; ++i) {
         quartcount += roaring_bitmap_contains(bitmaps[i],maxvalue/4);
         quartcount += roaring_bitmap_contains(bitmaps[i],maxvalue/2);
         quartcount += roaring_bitmap_contains(bitmaps[i],3*maxvalue/4);
     }
-    ENDBEST(data[5])
+    END_PHASE(5, data[5])
 
     if(verbose) printf("Quartile queries on %zu bitmaps took %" PRIu64 " cycles\n", count,
                            data[5]);
@@ -200,36 +399,43 @@ int main(int argc, char **argv) {
     uint64_t successive_andnot = 0;
     uint64_t successive_xor = 0;
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(6)
+    arena_start();
+    successive_andnot = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         roaring_bitmap_t *tempandnot =
             roaring_bitmap_andnot(bitmaps[i], bitmaps[i + 1]);
         successive_andnot += roaring_bitmap_get_cardinality(tempandnot);
         roaring_bitmap_free(tempandnot);
+        arena_reset();
     }
-    RDTSC_FINAL(cycles_final);
-    data[6] = cycles_final - cycles_start;
+    arena_stop();
+    END_PHASE(6, data[6])
 
     if(verbose) printf("Successive differences on %zu bitmaps took %" PRIu64 " cycles\n", count,
-                           cycles_final - cycles_start);
+                           data[6]);
 
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(7)
+    arena_start();
+    successive_xor = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         roaring_bitmap_t *tempxor =
             roaring_bitmap_xor(bitmaps[i], bitmaps[i + 1]);
         successive_xor += roaring_bitmap_get_cardinality(tempxor);
         roaring_bitmap_free(tempxor);
+        arena_reset();
     }
-    RDTSC_FINAL(cycles_final);
-    data[7] = cycles_final - cycles_start;
+    arena_stop();
+    END_PHASE(7, data[7])
 
     if(verbose) printf("Successive symmetric differences on %zu bitmaps took %" PRIu64 " cycles\n", count,
-                           cycles_final - cycles_start);
+                           data[7]);
     /***
     * End of ANDNOT and XOR
     ***/
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(8)
+    total_count = 0;
     for (size_t i = 0; i < count; ++i) {
         roaring_bitmap_t *ra = bitmaps[i];
         roaring_iterate(ra, roaring_iterator_increment, &total_count);
@@ -238,17 +444,16 @@ int main(int argc, char **argv) {
     for (size_t i = 0; i < count; ++i) {
         roaring_bitmap_t *ra = bitmaps[i];
         roaring_uint32_iterator_t  j;
-        roaring_init_iterator(ra, &j);
+        roaring_iterator_init(ra, &j);
         while(j.has_value) {
             total_count ++;
-            roaring_advance_uint32_iterator(&j);
+            roaring_uint32_iterator_advance(&j);
         }
     }
     */
-    RDTSC_FINAL(cycles_final);
-    data[8] = cycles_final - cycles_start;
+    END_PHASE(8, data[8])
     if(verbose) printf("Iterating over %zu bitmaps took %" PRIu64 " cycles\n", count,
-                           cycles_final - cycles_start);
+                           data[8]);
 
     assert(totalcard == total_count);
 
@@ -262,33 +467,33 @@ int main(int argc, char **argv) {
     uint64_t successive_andnotcard = 0;
     uint64_t successive_xorcard = 0;
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(9)
+    successive_andcard = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         successive_andcard += roaring_bitmap_and_cardinality(bitmaps[i], bitmaps[i + 1]);
     }
-    RDTSC_FINAL(cycles_final);
-    data[9] = cycles_final - cycles_start;
+    END_PHASE(9, data[9])
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(10)
+    successive_orcard = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         successive_orcard += roaring_bitmap_or_cardinality(bitmaps[i], bitmaps[i + 1]);
     }
-    RDTSC_FINAL(cycles_final);
-    data[10] = cycles_final - cycles_start;
+    END_PHASE(10, data[10])
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(11)
+    successive_andnotcard = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         successive_andnotcard += roaring_bitmap_andnot_cardinality(bitmaps[i], bitmaps[i + 1]);
     }
-    RDTSC_FINAL(cycles_final);
-    data[11] = cycles_final - cycles_start;
+    END_PHASE(11, data[11])
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(12)
+    successive_xorcard = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         successive_xorcard += roaring_bitmap_xor_cardinality(bitmaps[i], bitmaps[i + 1]);
     }
-    RDTSC_FINAL(cycles_final);
-    data[12] = cycles_final - cycles_start;
+    END_PHASE(12, data[12])
 
     assert(successive_andcard == successive_and);
     assert(successive_orcard == successive_or);
@@ -299,22 +504,134 @@ int main(int argc, char **argv) {
     * end and, or, andnot and xor cardinality
     */
 
+    if (serialize) {
+        /**
+        * serialize all bitmaps, one after the other, into a single buffer,
+        * then read them back, and then view them in place from their frozen
+        * serialization
+        */
+        size_t *offsets = malloc((count + 1) * sizeof(size_t));
+        offsets[0] = 0;
+        for (int i = 0; i < (int)count; ++i) {
+            offsets[i + 1] = offsets[i] + roaring_bitmap_portable_size_in_bytes(bitmaps[i]);
+        }
+        char *buffer = malloc(offsets[count] + 1);
+        BEGIN_PHASE(PHASE_SERIALIZATION)
+        for (int i = 0; i < (int)count; ++i) {
+            roaring_bitmap_portable_serialize(bitmaps[i], buffer + offsets[i]);
+        }
+        END_PHASE(PHASE_SERIALIZATION, serialization_report.cycles[0])
+        uint64_t deserializedcard = 0;
+        BEGIN_PHASE(PHASE_DESERIALIZATION)
+        deserializedcard = 0;
+        for (int i = 0; i < (int)count; ++i) {
+            roaring_bitmap_t *r = roaring_bitmap_portable_deserialize(buffer + offsets[i]);
+            deserializedcard += roaring_bitmap_get_cardinality(r);
+            roaring_bitmap_free(r);
+        }
+        END_PHASE(PHASE_DESERIALIZATION, serialization_report.cycles[1])
+        assert(deserializedcard == totalcard);
+        size_t *frozenoffsets = malloc((count + 1) * sizeof(size_t));
+        size_t *frozensizes = malloc(count * sizeof(size_t));
+        char *frozenbuffer = frozen_serialize_all(bitmaps, count, frozenoffsets, frozensizes);
+        if (frozenbuffer == NULL) {
+            printf("I could not allocate %zu bytes.\n", frozenoffsets[count]);
+            return -1;
+        }
+        size_t frozenbytes = 0;
+        for (int i = 0; i < (int)count; ++i) {
+            frozenbytes += frozensizes[i];
+        }
+        uint64_t frozencard = 0;
+        BEGIN_PHASE(PHASE_FROZEN_VIEW)
+        frozencard = 0;
+        for (int i = 0; i < (int)count; ++i) {
+            const roaring_bitmap_t *r =
+                roaring_bitmap_frozen_view(frozenbuffer + frozenoffsets[i], frozensizes[i]);
+            frozencard += roaring_bitmap_get_cardinality(r);
+            roaring_bitmap_free(r);
+        }
+        END_PHASE(PHASE_FROZEN_VIEW, serialization_report.frozen_cycles)
+        assert(frozencard == totalcard);
+        if(verbose) printf("Serialized cardinalities %" PRIu64 " %" PRIu64 " \n", deserializedcard, frozencard);
+        serialization_report.measured = true;
+        serialization_report.bytes = offsets[count];
+        serialization_report.frozen = true;
+        serialization_report.frozen_bytes = frozenbytes;
+        free(frozenbuffer);
+        free(buffer);
+        free(frozensizes);
+        free(frozenoffsets);
+        free(offsets);
+    }
+
+    if (mappedfile != NULL) {
+        /**
+        * write the frozen bitmaps to a file and query views over a mapping
+        * of it: cold, mapping the file anew after evicting it from the page
+        * cache, then warm, over a mapping whose pages were all touched
+        */
+        size_t *offsets = malloc((count + 1) * sizeof(size_t));
+        size_t *sizes = malloc(count * sizeof(size_t));
+        char *buffer = frozen_serialize_all(bitmaps, count, offsets, sizes);
+        if ((buffer == NULL) || !mapped_store_create(mappedfile, buffer, offsets[count])) {
+            return -1;
+        }
+        free(buffer);
+        const uint64_t expected[MAPPED_QUERIES] = {successive_and, successive_or, quartcount};
+        const roaring_bitmap_t **views = calloc(count, sizeof(roaring_bitmap_t *));
+        mapped_store_t store;
+        for (int q = 0; q < MAPPED_QUERIES; ++q) {
+            uint64_t answer = 0;
+            bool mapped = false;
+            mapped_store_drop_cache(mappedfile);
+            BEGIN_SINGLE_PHASE(PHASE_MAPPED_COLD + q)
+            mapped = mapped_store_map(&store, mappedfile) &&
+                     frozen_view_all(store.data, offsets, sizes, count, views);
+            if (mapped) answer = mapped_query(q, views, count, maxvalue);
+            free_views(views, count);
+            END_PHASE(PHASE_MAPPED_COLD + q, mapped_report.cycles[0][q])
+            mapped_store_unmap(&store);
+            if (!mapped) {
+                printf("I could not map %s.\n", mappedfile);
+                return -1;
+            }
+            assert(answer == expected[q]);
+        }
+        if (!mapped_store_map(&store, mappedfile) ||
+            !frozen_view_all(store.data, offsets, sizes, count, views)) {
+            printf("I could not map %s.\n", mappedfile);
+            return -1;
+        }
+        for (int q = 0; q < MAPPED_QUERIES; ++q) {
+            mapped_query(q, views, count, maxvalue);  // touch the pages
+        }
+        for (int q = 0; q < MAPPED_QUERIES; ++q) {
+            uint64_t answer = 0;
+            BEGIN_REPEATED_PHASE(PHASE_MAPPED_WARM + q, q == 2 ? quartile_test_repetitions : 1)
+            answer = mapped_query(q, views, count, maxvalue);
+            END_PHASE(PHASE_MAPPED_WARM + q, mapped_report.cycles[1][q])
+            assert(answer == expected[q]);
+        }
+        if(verbose) printf("Mapped %zu bytes from %s\n", store.length, mappedfile);
+        mapped_report.measured = true;
+        mapped_report.bytes = store.length;
+        free_views(views, count);
+        mapped_store_unmap(&store);
+        unlink(mappedfile);
+        free(views);
+        free(sizes);
+        free(offsets);
+    }
+
 
-    printf(" %20.2f %20.2f %20.2f %20.2f %20.2f %20.2f  %20.2f  %20.2f     %20.2f    %20.2f  %20.2f  %20.2f  %20.2f\n",
-           data[0]*8.0/totalcard,
-           data[1]*1.0/successivecard,
-           data[2]*1.0/successivecard,
-           data[3]*1.0/totalcard,
-           data[4]*1.0/totalcard,
-           data[5]*1.0/(3*count),
-           data[6]*1.0/successivecard,
-           data[7]*1.0/successivecard,
-           data[8]*1.0/totalcard,
-           data[9]*1.0/successivecard,
-           data[10]*1.0/successivecard,
-           data[11]*1.0/successivecard,
-           data[12]*1.0/successivecard
-          );
+    report_cardinalities(successive_and, successive_or, total_or, quartcount,
+                         successive_andnot, successive_xor, total_count);
+    benchmark_report(report_basename(argv[0]), dirname, data, threads > 0 ? 15 : 14, count,
+                     totalcard, successivecard);
+    perf_counters_print();
+    alloc_counters_print(count);
+    phase_stats_print();
 
     for (int i = 0; i < (int)count; ++i) {
         free(numbers[i]);
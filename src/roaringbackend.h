@@ -0,0 +1,248 @@
+#ifndef INCLUDE_ROARINGBACKEND_H
+#define INCLUDE_ROARINGBACKEND_H
+
+/*
+ * Backends over CRoaring, as in roaring_benchmarks: with or without run
+ * optimization (-r) and copy-on-write (-c). The amalgamated roaring.c is
+ * compiled separately as C and linked in.
+ */
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "bitmapbackend.h"
+#include "roaring.h"
+
+template <bool runoptimize, bool copyonwrite>
+struct roaring_backend {
+    typedef roaring_bitmap_t *bitmap;
+
+    // with copy-on-write, computing a result turns the containers of the
+    // inputs into shared containers, so even "read-only" operations write
+    static const bool concurrent_reads = !copyonwrite;
+
+    static const char *name() {
+        if (runoptimize) return copyonwrite ? "roaring_run_cow" : "roaring_run";
+        return copyonwrite ? "roaring_cow" : "roaring";
+    }
+
+    static void build(bitmap &b, const uint32_t *values, size_t n) {
+        b = roaring_bitmap_of_ptr(n, values);
+        roaring_bitmap_set_copy_on_write(b, copyonwrite);
+        if (runoptimize) roaring_bitmap_run_optimize(b);
+        roaring_bitmap_shrink_to_fit(b);
+    }
+
+    static void release(bitmap &b) {
+        roaring_bitmap_free(b);
+        b = NULL;
+    }
+
+    static uint64_t size_in_bytes(const bitmap &b) {
+        return roaring_bitmap_portable_size_in_bytes(b);
+    }
+
+    static uint64_t and_op(const bitmap &a, const bitmap &b) {
+        roaring_bitmap_t *tempand = roaring_bitmap_and(a, b);
+        uint64_t card = roaring_bitmap_get_cardinality(tempand);
+        roaring_bitmap_free(tempand);
+        return card;
+    }
+
+    static uint64_t or_op(const bitmap &a, const bitmap &b) {
+        roaring_bitmap_t *tempor = roaring_bitmap_or(a, b);
+        uint64_t card = roaring_bitmap_get_cardinality(tempor);
+        roaring_bitmap_free(tempor);
+        return card;
+    }
+
+    static uint64_t andnot_op(const bitmap &a, const bitmap &b) {
+        roaring_bitmap_t *tempandnot = roaring_bitmap_andnot(a, b);
+        uint64_t card = roaring_bitmap_get_cardinality(tempandnot);
+        roaring_bitmap_free(tempandnot);
+        return card;
+    }
+
+    static uint64_t xor_op(const bitmap &a, const bitmap &b) {
+        roaring_bitmap_t *tempxor = roaring_bitmap_xor(a, b);
+        uint64_t card = roaring_bitmap_get_cardinality(tempxor);
+        roaring_bitmap_free(tempxor);
+        return card;
+    }
+
+    static uint64_t and_count(const bitmap &a, const bitmap &b) {
+        return roaring_bitmap_and_cardinality(a, b);
+    }
+
+    static uint64_t or_count(const bitmap &a, const bitmap &b) {
+        return roaring_bitmap_or_cardinality(a, b);
+    }
+
+    static uint64_t andnot_count(const bitmap &a, const bitmap &b) {
+        return roaring_bitmap_andnot_cardinality(a, b);
+    }
+
+    static uint64_t xor_count(const bitmap &a, const bitmap &b) {
+        return roaring_bitmap_xor_cardinality(a, b);
+    }
+
+    static uint64_t wide_or(const std::vector<bitmap> &all) {
+        roaring_bitmap_t *totalorbitmap = roaring_bitmap_or_many(
+            all.size(), (const roaring_bitmap_t **)all.data());
+        uint64_t card = roaring_bitmap_get_cardinality(totalorbitmap);
+        roaring_bitmap_free(totalorbitmap);
+        return card;
+    }
+
+    static uint64_t wide_or_heap(const std::vector<bitmap> &all) {
+        roaring_bitmap_t *totalorbitmapheap = roaring_bitmap_or_many_heap(
+            all.size(), (const roaring_bitmap_t **)all.data());
+        uint64_t card = roaring_bitmap_get_cardinality(totalorbitmapheap);
+        roaring_bitmap_free(totalorbitmapheap);
+        return card;
+    }
+
+    // the smallest bitmaps first, in place, stopping once the intersection
+    // is empty
+    static uint64_t wide_and(const bitmap *first, size_t n) {
+        std::vector<std::pair<uint64_t, const roaring_bitmap_t *> > sorted(n);
+        for (size_t i = 0; i < n; ++i) {
+            sorted[i] = std::make_pair(roaring_bitmap_get_cardinality(first[i]),
+                                       (const roaring_bitmap_t *)first[i]);
+        }
+        std::sort(sorted.begin(), sorted.end());
+        if (n == 1) return sorted[0].first;
+        roaring_bitmap_t *tempand = roaring_bitmap_and(sorted[0].second, sorted[1].second);
+        for (size_t i = 2; (i < n) && !roaring_bitmap_is_empty(tempand); ++i) {
+            roaring_bitmap_and_inplace(tempand, sorted[i].second);
+        }
+        uint64_t card = roaring_bitmap_get_cardinality(tempand);
+        roaring_bitmap_free(tempand);
+        return card;
+    }
+
+    // ScanCount, one chunk of 2^16 values at a time: a counter per value of
+    // the chunk, fed by an iterator over each bitmap. We scan all counters
+    // of dense chunks, and only the touched ones of sparse chunks.
+    static uint64_t threshold(const bitmap *first, size_t n, size_t t) {
+        std::vector<roaring_uint32_iterator_t *> its(n);
+        for (size_t i = 0; i < n; ++i) its[i] = roaring_iterator_create(first[i]);
+        std::vector<uint32_t> counters(1 << 16, 0);
+        std::vector<uint16_t> touched;
+        std::vector<uint32_t> values;
+        roaring_bitmap_t *result = roaring_bitmap_create();
+        while (true) {
+            bool any = false;
+            uint32_t chunk = UINT32_MAX;
+            for (size_t i = 0; i < n; ++i) {
+                if (its[i]->has_value) {
+                    any = true;
+                    chunk = std::min(chunk, its[i]->current_value >> 16);
+                }
+            }
+            if (!any) break;
+            const uint64_t end = ((uint64_t)chunk + 1) << 16;
+            touched.clear();
+            for (size_t i = 0; i < n; ++i) {
+                while (its[i]->has_value && (its[i]->current_value < end)) {
+                    const uint16_t low = its[i]->current_value & 0xFFFF;
+                    if (counters[low]++ == 0) touched.push_back(low);
+                    roaring_uint32_iterator_advance(its[i]);
+                }
+            }
+            values.clear();
+            if (touched.size() > (1 << 12)) {
+                for (uint32_t low = 0; low < (1 << 16); ++low) {
+                    if (counters[low] >= t) values.push_back((chunk << 16) | low);
+                }
+                std::fill(counters.begin(), counters.end(), 0);
+            } else {
+                std::sort(touched.begin(), touched.end());
+                for (size_t k = 0; k < touched.size(); ++k) {
+                    if (counters[touched[k]] >= t) values.push_back((chunk << 16) | touched[k]);
+                    counters[touched[k]] = 0;
+                }
+            }
+            roaring_bitmap_add_many(result, values.size(), values.data());
+        }
+        for (size_t i = 0; i < n; ++i) roaring_uint32_iterator_free(its[i]);
+        uint64_t card = roaring_bitmap_get_cardinality(result);
+        roaring_bitmap_free(result);
+        return card;
+    }
+
+    static uint64_t range_count(const bitmap &b, uint64_t lo, uint64_t hi) {
+        return roaring_bitmap_range_cardinality(b, lo, hi);
+    }
+
+    static bool range_intersects(const bitmap &b, uint64_t lo, uint64_t hi) {
+        return roaring_bitmap_intersect_with_range(b, lo, hi);
+    }
+
+    // an iterator moved to lo, read in batches
+    static void range_values(const bitmap &b, uint64_t lo, uint64_t hi,
+                             std::vector<uint32_t> &out) {
+        uint32_t buffer[256];
+        roaring_uint32_iterator_t *it = roaring_iterator_create(b);
+        roaring_uint32_iterator_move_equalorlarger(it, (uint32_t)lo);
+        while (true) {
+            const uint32_t read = roaring_uint32_iterator_read(it, buffer, 256);
+            uint32_t k = 0;
+            while ((k < read) && (buffer[k] < hi)) out.push_back(buffer[k++]);
+            if ((k < read) || (read < 256)) break;
+        }
+        roaring_uint32_iterator_free(it);
+    }
+
+    static uint64_t rank(const bitmap &b, uint32_t x) {
+        return roaring_bitmap_rank(b, x);
+    }
+
+    static uint32_t select(const bitmap &b, uint64_t i) {
+        uint32_t value = 0;
+        roaring_bitmap_select(b, (uint32_t)i, &value);
+        return value;
+    }
+
+    static void add(bitmap &b, uint32_t value) { roaring_bitmap_add(b, value); }
+
+    static void remove(bitmap &b, uint32_t value) { roaring_bitmap_remove(b, value); }
+
+    static void add_many(bitmap &b, const uint32_t *values, size_t n) {
+        roaring_bitmap_add_many(b, n, values);
+    }
+
+    static void optimize(bitmap &b) {
+        if (runoptimize) roaring_bitmap_run_optimize(b);
+        roaring_bitmap_shrink_to_fit(b);
+    }
+
+    static bool contains(const bitmap &b, uint32_t value) {
+        return roaring_bitmap_contains(b, value);
+    }
+
+    static bool iterator_increment(uint32_t value, void *param) {
+        (void)value;
+        (*(uint64_t *)param)++;
+        return true;  // continue till the end
+    }
+
+    static uint64_t iterate(const bitmap &b) {
+        uint64_t card = 0;
+        roaring_iterate(b, iterator_increment, &card);
+        return card;
+    }
+};
+
+typedef roaring_backend<false, false> roaring_plain_backend;
+typedef roaring_backend<false, true> roaring_cow_backend;
+typedef roaring_backend<true, false> roaring_run_backend;
+typedef roaring_backend<true, true> roaring_run_cow_backend;
+
+REGISTER_BACKEND(roaring_plain_backend)
+REGISTER_BACKEND(roaring_cow_backend)
+REGISTER_BACKEND(roaring_run_backend)
+REGISTER_BACKEND(roaring_run_cow_backend)
+
+#endif
@@ -0,0 +1,198 @@
+#ifndef INCLUDE_ROARINGPARALLEL_H
+#define INCLUDE_ROARINGPARALLEL_H
+
+/*
+ * A parallel wide union for roaring_benchmarks (-t). It must be included
+ * after roaring.c since it works on the containers directly.
+ *
+ * The 16-bit key space is cut into as many ranges as there are threads,
+ * each holding about the same number of containers over all inputs. Each
+ * thread unions, with roaring_bitmap_or_many, "views" of the inputs
+ * restricted to its key range: bitmaps whose high_low_container points
+ * into the arrays of the original bitmaps. Since the ranges are disjoint
+ * and increasing, the partial results are concatenated as they are, without
+ * any locking or merging of containers.
+ *
+ * The threads are created once and wait on a barrier between unions.
+ */
+
+#include <pthread.h>
+
+#define PARALLEL_UNION_MAX_THREADS 256
+
+typedef struct parallel_union_pool_s parallel_union_pool_t;
+
+typedef struct parallel_union_task_s {
+    parallel_union_pool_t *pool;
+    int index;
+    roaring_bitmap_t *views;
+    const roaring_bitmap_t **viewpointers;
+    roaring_bitmap_t *result;
+} parallel_union_task_t;
+
+struct parallel_union_pool_s {
+    int threads;
+    bool stopping;
+    pthread_barrier_t start;
+    pthread_barrier_t finish;
+    pthread_t workers[PARALLEL_UNION_MAX_THREADS];
+    parallel_union_task_t tasks[PARALLEL_UNION_MAX_THREADS];
+    // the current union
+    size_t n;
+    const roaring_bitmap_t **inputs;
+    uint32_t boundaries[PARALLEL_UNION_MAX_THREADS + 1];
+    uint32_t histogram[1 << 16];
+};
+
+// first index whose key is at least key
+static int32_t parallel_union_lower_bound(const roaring_array_t *ra,
+                                          uint32_t key) {
+    int32_t low = 0, high = ra->size;
+    while (low < high) {
+        int32_t middle = (low + high) >> 1;
+        if (ra->keys[middle] < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+static void parallel_union_range(parallel_union_task_t *task) {
+    parallel_union_pool_t *pool = task->pool;
+    const uint32_t lo = pool->boundaries[task->index];
+    const uint32_t hi = pool->boundaries[task->index + 1];
+    size_t nviews = 0;
+    for (size_t i = 0; i < pool->n; i++) {
+        const roaring_array_t *ra = &pool->inputs[i]->high_low_container;
+        int32_t begin = parallel_union_lower_bound(ra, lo);
+        int32_t end = parallel_union_lower_bound(ra, hi);
+        if (begin == end) continue;
+        roaring_bitmap_t *view = &task->views[nviews];
+        memset(view, 0, sizeof(*view));
+        view->high_low_container.size = end - begin;
+        view->high_low_container.allocation_size = end - begin;
+        view->high_low_container.keys = ra->keys + begin;
+        view->high_low_container.containers = ra->containers + begin;
+        view->high_low_container.typecodes = ra->typecodes + begin;
+        roaring_bitmap_set_copy_on_write(
+            view, roaring_bitmap_get_copy_on_write(pool->inputs[i]));
+        task->viewpointers[nviews++] = view;
+    }
+    task->result = roaring_bitmap_or_many(nviews, task->viewpointers);
+}
+
+static void *parallel_union_worker(void *arg) {
+    parallel_union_task_t *task = (parallel_union_task_t *)arg;
+    parallel_union_pool_t *pool = task->pool;
+    while (true) {
+        pthread_barrier_wait(&pool->start);
+        if (pool->stopping) break;
+        parallel_union_range(task);
+        pthread_barrier_wait(&pool->finish);
+    }
+    return NULL;
+}
+
+/*
+ * Start threads - 1 workers (the caller is the last thread); count is the
+ * largest number of bitmaps that will be unioned at once.
+ */
+static parallel_union_pool_t *parallel_union_pool_create(int threads,
+                                                         size_t count) {
+    if (threads < 1) threads = 1;
+    if (threads > PARALLEL_UNION_MAX_THREADS) threads = PARALLEL_UNION_MAX_THREADS;
+    parallel_union_pool_t *pool =
+        (parallel_union_pool_t *)calloc(1, sizeof(parallel_union_pool_t));
+    pool->threads = threads;
+    pthread_barrier_init(&pool->start, NULL, threads);
+    pthread_barrier_init(&pool->finish, NULL, threads);
+    for (int t = 0; t < threads; t++) {
+        pool->tasks[t].pool = pool;
+        pool->tasks[t].index = t;
+        pool->tasks[t].views =
+            (roaring_bitmap_t *)malloc(count * sizeof(roaring_bitmap_t) + 1);
+        pool->tasks[t].viewpointers = (const roaring_bitmap_t **)malloc(
+            count * sizeof(roaring_bitmap_t *) + 1);
+    }
+    for (int t = 1; t < threads; t++) {
+        pthread_create(&pool->workers[t], NULL, parallel_union_worker,
+                       &pool->tasks[t]);
+    }
+    return pool;
+}
+
+static void parallel_union_pool_free(parallel_union_pool_t *pool) {
+    pool->stopping = true;
+    pthread_barrier_wait(&pool->start);
+    for (int t = 1; t < pool->threads; t++) pthread_join(pool->workers[t], NULL);
+    for (int t = 0; t < pool->threads; t++) {
+        free(pool->tasks[t].views);
+        free(pool->tasks[t].viewpointers);
+    }
+    pthread_barrier_destroy(&pool->start);
+    pthread_barrier_destroy(&pool->finish);
+    free(pool);
+}
+
+/*
+ * Compute the union of the n bitmaps on the threads of the pool.
+ */
+static roaring_bitmap_t *roaring_bitmap_or_many_parallel(
+    parallel_union_pool_t *pool, size_t n, const roaring_bitmap_t **x) {
+    // cut the key space so that every thread gets about as many containers
+    uint64_t totalcontainers = 0;
+    for (size_t i = 0; i < n; i++) {
+        const roaring_array_t *ra = &x[i]->high_low_container;
+        for (int32_t k = 0; k < ra->size; k++) pool->histogram[ra->keys[k]]++;
+        totalcontainers += ra->size;
+    }
+    int t = 0;
+    uint64_t seen = 0;
+    pool->boundaries[0] = 0;
+    for (uint32_t key = 0; (key < (1 << 16)) && (t + 1 < pool->threads); key++) {
+        seen += pool->histogram[key];
+        if (seen * pool->threads >= totalcontainers * (uint64_t)(t + 1)) {
+            pool->boundaries[++t] = key + 1;
+        }
+    }
+    while (t < pool->threads) pool->boundaries[++t] = 1 << 16;
+    for (size_t i = 0; i < n; i++) {  // leave the histogram cleared
+        const roaring_array_t *ra = &x[i]->high_low_container;
+        for (int32_t k = 0; k < ra->size; k++) pool->histogram[ra->keys[k]] = 0;
+    }
+
+    pool->n = n;
+    pool->inputs = x;
+    pthread_barrier_wait(&pool->start);
+    parallel_union_range(&pool->tasks[0]);
+    pthread_barrier_wait(&pool->finish);
+
+    // concatenate the partial results, whose keys are increasing
+    int32_t total = 0;
+    for (t = 0; t < pool->threads; t++) {
+        total += pool->tasks[t].result->high_low_container.size;
+    }
+    roaring_bitmap_t *answer = roaring_bitmap_create_with_capacity(total);
+    roaring_array_t *out = &answer->high_low_container;
+    for (t = 0; t < pool->threads; t++) {
+        roaring_bitmap_t *partial = pool->tasks[t].result;
+        roaring_array_t *in = &partial->high_low_container;
+        memcpy(out->keys + out->size, in->keys, in->size * sizeof(uint16_t));
+        memcpy(out->containers + out->size, in->containers,
+               in->size * sizeof(void *));
+        memcpy(out->typecodes + out->size, in->typecodes,
+               in->size * sizeof(uint8_t));
+        out->size += in->size;
+        ra_clear_without_containers(in);
+        roaring_free(partial);  // allocated by CRoaring, maybe through hooks
+    }
+    if (n > 0) {
+        roaring_bitmap_set_copy_on_write(answer,
+                                         roaring_bitmap_get_copy_on_write(x[0]));
+    }
+    return answer;
+}
+
+#endif
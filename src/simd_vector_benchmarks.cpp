@@ -0,0 +1,403 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#define __STDC_FORMAT_MACROS 1
+#include <inttypes.h>
+#include <cstdint>
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <queue>
+#include <cassert>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "benchmark.h"
+#include "numbersfromtextfiles.h"
+#ifdef __cplusplus
+}
+#endif
+
+#include "sortedarrays.h"
+
+/**
+ * The same sorted arrays as stl_vector_benchmarks, with the set operations
+ * of sortedarrays.h (vectorized, galloping) writing into outputs allocated
+ * once at their largest possible size, instead of std::set_* algorithms
+ * growing a std::vector through std::back_inserter.
+ */
+typedef std::vector<uint32_t> vector;
+
+/**
+ * The result of an operation. The values are not initialized and there is
+ * room past the end for the vector code.
+ */
+class result_array {
+public:
+    explicit result_array(size_t capacity)
+        : values((uint32_t *)malloc((capacity + SORTED_ARRAY_SLACK) * sizeof(uint32_t))),
+          size(0) {}
+    ~result_array() { free(values); }
+    void swap(result_array &o) {
+        std::swap(values, o.values);
+        std::swap(size, o.size);
+    }
+    uint32_t *values;
+    size_t size;
+private:
+    result_array(const result_array &);
+    result_array &operator=(const result_array &);
+};
+
+static size_t intersection(const vector &a, const vector &b) {
+    result_array r(std::min(a.size(), b.size()));
+    r.size = sorted_intersect(a.data(), a.size(), b.data(), b.size(), r.values);
+    return r.size;
+}
+
+static size_t union_size(const vector &a, const vector &b) {
+    result_array r(a.size() + b.size());
+    r.size = sorted_union(a.data(), a.size(), b.data(), b.size(), r.values);
+    return r.size;
+}
+
+static size_t difference(const vector &a, const vector &b) {
+    result_array r(a.size());
+    r.size = sorted_andnot(a.data(), a.size(), b.data(), b.size(), r.values);
+    return r.size;
+}
+
+static size_t symmetric_difference(const vector &a, const vector &b) {
+    result_array r(a.size() + b.size());
+    r.size = sorted_xor(a.data(), a.size(), b.data(), b.size(), r.values);
+    return r.size;
+}
+
+/**
+ * Union of all arrays, always merging the two smallest (as fast_logicalor
+ * in stl_vector_benchmarks).
+ */
+static size_t fast_logicalor(size_t n, const vector *inputs) {
+    class SortedArrayPtr {
+    public:
+        SortedArrayPtr(const uint32_t *v, size_t s, result_array *o)
+            : values(v), size(s), own(o) {}
+        const uint32_t *values;
+        size_t size;
+        result_array *own;  // to clean, if not an input
+
+        bool operator<(const SortedArrayPtr &o) const {
+            return o.size < size;  // backward on purpose
+        }
+    };
+
+    if (n == 0) return 0;
+    if (n == 1) return inputs[0].size();
+    std::priority_queue<SortedArrayPtr> pq;
+    for (size_t i = 0; i < n; i++) {
+        pq.push(SortedArrayPtr(inputs[i].data(), inputs[i].size(), NULL));
+    }
+    while (pq.size() > 1) {
+        SortedArrayPtr x1 = pq.top();
+        pq.pop();
+        SortedArrayPtr x2 = pq.top();
+        pq.pop();
+        result_array *buffer = new result_array(x1.size + x2.size);
+        buffer->size = sorted_union(x1.values, x1.size, x2.values, x2.size, buffer->values);
+        delete x1.own;
+        delete x2.own;
+        pq.push(SortedArrayPtr(buffer->values, buffer->size, buffer));
+    }
+    SortedArrayPtr x = pq.top();
+    size_t answer = x.size;
+    delete x.own;
+    return answer;
+}
+
+/**
+ * Once you have collected all the integers, build the bitmaps.
+ */
+static std::vector<vector > create_all_bitmaps(size_t *howmany,
+        uint32_t **numbers, size_t count) {
+    if (numbers == NULL) return std::vector<vector >();
+    std::vector<vector > answer(count);
+
+    for (size_t i = 0; i < count; i++) {
+        answer[i].assign(numbers[i], numbers[i] + howmany[i]);
+    }
+    return answer;
+}
+
+static void printusage(char *command) {
+    printf(
+        " Try %s directory \n where directory could be "
+        "benchmarks/realdata/census1881\n",
+        command);
+    ;
+    printf("the -v flag turns on verbose mode\n");
+    printf("the -b flag reads the data from a binary cache next to the directory, creating it if needed\n");
+    printf("the -j flag sets the number of threads parsing the data files (0: one per processor)\n");
+    printf("the -p flag records hardware performance counters for each phase\n");
+    printf("the -n flag followed by a number repeats each phase that many times and reports statistics\n");
+    printf("the -w flag followed by a number runs each phase that many times before measuring it\n");
+    printf("the -o flag followed by text, json or csv sets the output format\n");
+
+}
+
+int main(int argc, char **argv) {
+    int c;
+    const char *extension = ".txt";
+    bool verbose = false;
+    uint64_t data[14];
+    while ((c = getopt(argc, argv, "bj:pn:w:o:ve:h")) != -1) switch (c) {
+        case 'e':
+            extension = optarg;
+            break;
+        case 'b':
+            use_binary_cache = true;
+            break;
+        case 'j':
+            loader_threads = atoi(optarg);
+            break;
+        case 'p':
+            perf_counters_enabled = perf_counters_init();
+            break;
+        case 'n':
+            benchmark_repetitions = atoi(optarg);
+            if (benchmark_repetitions < 1) benchmark_repetitions = 1;
+            break;
+        case 'w':
+            benchmark_warmups = atoi(optarg);
+            if (benchmark_warmups < 0) benchmark_warmups = 0;
+            break;
+        case 'o':
+            if (!report_set_format(optarg)) {
+                printf("Unknown output format %s (text, json or csv).\n", optarg);
+                return -1;
+            }
+            break;
+        case 'v':
+            verbose = true;
+            break;
+        case 'h':
+            printusage(argv[0]);
+            return 0;
+        default:
+            abort();
+        }
+    if (optind >= argc) {
+        printusage(argv[0]);
+        return -1;
+    }
+    char *dirname = argv[optind];
+    report_record_flags(argc, argv, optind);
+    size_t count;
+
+
+    size_t *howmany = NULL;
+    uint32_t **numbers =
+        read_all_integer_files(dirname, extension, &howmany, &count);
+    if (numbers == NULL) {
+        printf(
+            "I could not find or load any data file with extension %s in "
+            "directory %s.\n",
+            extension, dirname);
+        return -1;
+    }
+    uint32_t maxvalue = 0;
+    for (size_t i = 0; i < count; i++) {
+      if( howmany[i] > 0 ) {
+        if(maxvalue < numbers[i][howmany[i]-1]) {
+           maxvalue = numbers[i][howmany[i]-1];
+         }
+      }
+    }
+    uint64_t totalcard = 0;
+    for (size_t i = 0; i < count; i++) {
+      totalcard += howmany[i];
+    }
+    uint64_t successivecard = 0;
+    for (size_t i = 1; i < count; i++) {
+       successivecard += howmany[i-1] + howmany[i];
+    }
+
+    std::vector<vector> bitmaps;
+    BEGIN_SINGLE_PHASE(0)
+    bitmaps = create_all_bitmaps(howmany, numbers, count);
+    END_PHASE(0, data[13])
+    if (bitmaps.empty()) return -1;
+    if(verbose) printf("Loaded %d bitmaps from directory %s \n", (int)count, dirname);
+    if(verbose) printf("Building the bitmaps took %" PRIu64 " cycles\n", data[13]);
+    uint64_t totalsize = 0;
+    for (size_t i = 0; i < count; i++) {
+      totalsize += bitmaps[i].capacity() * sizeof(uint32_t);
+    }
+    data[0] = totalsize;
+
+    if(verbose) printf("Total size in bytes =  %" PRIu64 " \n", totalsize);
+
+    uint64_t successive_and = 0;
+    uint64_t successive_or = 0;
+    uint64_t total_or = 0;
+    uint64_t total_count = 0;
+    uint64_t successive_andnot = 0;
+    uint64_t successive_xor = 0;
+
+
+    BEGIN_PHASE(1)
+    successive_and = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+        successive_and += intersection(bitmaps[i], bitmaps[i+1]);
+    }
+    END_PHASE(1, data[1])
+    if(verbose) printf("Successive intersections on %zu bitmaps took %" PRIu64 " cycles\n", count,
+                           data[1]);
+
+    BEGIN_PHASE(2)
+    successive_or = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+        successive_or += union_size(bitmaps[i], bitmaps[i+1]);
+    }
+    END_PHASE(2, data[2])
+    if(verbose) printf("Successive unions on %zu bitmaps took %" PRIu64 " cycles\n", count,
+                           data[2]);
+
+    BEGIN_PHASE(3)
+    if(count>1) {
+        result_array v(bitmaps[0].size() + bitmaps[1].size());
+        v.size = sorted_union(bitmaps[0].data(), bitmaps[0].size(), bitmaps[1].data(), bitmaps[1].size(), v.values);
+        for (int i = 2; i < (int)count ; ++i) {
+            result_array newv(v.size + bitmaps[i].size());
+            newv.size = sorted_union(v.values, v.size, bitmaps[i].data(), bitmaps[i].size(), newv.values);
+            v.swap(newv);
+        }
+        total_or = v.size;
+    }
+    END_PHASE(3, data[3])
+    if(verbose) printf("Total naive unions on %zu bitmaps took %" PRIu64 " cycles\n", count,
+                           data[3]);
+    BEGIN_PHASE(4)
+    if(count>1) {
+        total_or = fast_logicalor(count, bitmaps.data());
+    }
+    END_PHASE(4, data[4])
+    if(verbose) printf("Total heap unions on %zu bitmaps took %" PRIu64 " cycles\n", count,
+                           data[4]);
+
+    uint64_t quartcount = 0;
+    BEGIN_REPEATED_PHASE(5, quartile_test_repetitions)
+    quartcount = 0;
+    for (size_t i = 0; i < count ; ++i) {
+      quartcount += sorted_contains(bitmaps[i].data(), bitmaps[i].size(), maxvalue/4);
+      quartcount += sorted_contains(bitmaps[i].data(), bitmaps[i].size(), maxvalue/2);
+      quartcount += sorted_contains(bitmaps[i].data(), bitmaps[i].size(), 3*maxvalue/4);
+    }
+    END_PHASE(5, data[5])
+
+    if(verbose) printf("Quartile queries on %zu bitmaps took %" PRIu64 " cycles\n", count,
+           data[5]);
+
+    if(verbose) printf("Collected stats  %" PRIu64 "  %" PRIu64 "  %" PRIu64 " %" PRIu64 "\n",successive_and,successive_or,total_or,quartcount);
+
+    BEGIN_PHASE(6)
+    successive_andnot = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+        successive_andnot += difference(bitmaps[i], bitmaps[i+1]);
+    }
+    END_PHASE(6, data[6])
+
+    if(verbose) printf("Successive differences on %zu bitmaps took %" PRIu64 " cycles\n", count,
+           data[6]);
+
+    BEGIN_PHASE(7)
+    successive_xor = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+        successive_xor += symmetric_difference(bitmaps[i], bitmaps[i+1]);
+    }
+    END_PHASE(7, data[7])
+
+    if(verbose) printf("Successive symmetric differences on %zu bitmaps took %" PRIu64 " cycles\n", count,
+           data[7]);
+
+    BEGIN_PHASE(8)
+    total_count = 0;
+    for (size_t i = 0; i < count; ++i) {
+        vector & b = bitmaps[i];
+        for(auto j = b.begin(); j != b.end() ; j++) {
+            total_count++;
+        }
+    }
+    END_PHASE(8, data[8])
+    assert(total_count == totalcard);
+
+    if(verbose) printf("Iterating over %zu bitmaps took %" PRIu64 " cycles\n", count,
+           data[8]);
+
+    assert(successive_xor + successive_and == successive_or);
+
+    /**
+    * and, or, andnot and xor cardinality: all follow from the size of the
+    * intersection
+    */
+    uint64_t successive_andcard = 0;
+    uint64_t successive_orcard = 0;
+    uint64_t successive_andnotcard = 0;
+    uint64_t successive_xorcard = 0;
+
+    BEGIN_PHASE(9)
+    successive_andcard = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+      successive_andcard += sorted_intersect_count(bitmaps[i].data(), bitmaps[i].size(), bitmaps[i+1].data(), bitmaps[i+1].size());
+    }
+    END_PHASE(9, data[9])
+
+    BEGIN_PHASE(10)
+    successive_orcard = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+      successive_orcard += bitmaps[i].size() + bitmaps[i+1].size()
+          - sorted_intersect_count(bitmaps[i].data(), bitmaps[i].size(), bitmaps[i+1].data(), bitmaps[i+1].size());
+    }
+    END_PHASE(10, data[10])
+
+    BEGIN_PHASE(11)
+    successive_andnotcard = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+      successive_andnotcard += bitmaps[i].size()
+          - sorted_intersect_count(bitmaps[i].data(), bitmaps[i].size(), bitmaps[i+1].data(), bitmaps[i+1].size());
+    }
+    END_PHASE(11, data[11])
+
+    BEGIN_PHASE(12)
+    successive_xorcard = 0;
+    for (int i = 0; i < (int)count - 1; ++i) {
+      successive_xorcard += bitmaps[i].size() + bitmaps[i+1].size()
+          - 2 * sorted_intersect_count(bitmaps[i].data(), bitmaps[i].size(), bitmaps[i+1].data(), bitmaps[i+1].size());
+    }
+    END_PHASE(12, data[12])
+
+    assert(successive_andcard == successive_and);
+    assert(successive_orcard == successive_or);
+    assert(successive_xorcard == successive_xor);
+    assert(successive_andnotcard == successive_andnot);
+
+    /**
+    * end and, or, andnot and xor cardinality
+    */
+
+    report_cardinalities(successive_and, successive_or, total_or, quartcount,
+                         successive_andnot, successive_xor, total_count);
+    benchmark_report(report_basename(argv[0]), dirname, data, 14, count,
+                     totalcard, successivecard);
+    perf_counters_print();
+    phase_stats_print();
+
+    for (int i = 0; i < (int)count; ++i) {
+        free(numbers[i]);
+        numbers[i] = NULL;  // paranoid
+    }
+    free(howmany);
+    free(numbers);
+
+    return 0;
+}
@@ -0,0 +1,463 @@
+#ifndef INCLUDE_SORTEDARRAYS_H
+#define INCLUDE_SORTEDARRAYS_H
+
+/*
+ * Set operations over sorted arrays of distinct 32-bit integers, for
+ * simd_vector_benchmarks: the same data as stl_vector_benchmarks, but with
+ * the algorithms of CRoaring's array containers, widened to 32 bits.
+ *
+ * - intersections compare blocks of 8 values from each side all against
+ *   all with AVX2, or gallop through the larger array when the sizes are
+ *   very different;
+ * - unions and symmetric differences merge blocks of 4 values with an
+ *   SSE4.1 min/max network, dropping duplicates as they are stored;
+ * - differences use the same block comparisons as intersections.
+ *
+ * The caller provides the output: intersections need room for
+ * min(na, nb) + SORTED_ARRAY_SLACK values, differences for
+ * na + SORTED_ARRAY_SLACK and unions and symmetric differences for
+ * na + nb + SORTED_ARRAY_SLACK (the vector code stores whole registers).
+ * Without AVX2, the scalar versions are used.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#define SORTED_ARRAY_SLACK 8
+
+// beyond this ratio of sizes, intersections gallop through the larger array
+#define SORTED_ARRAY_GALLOP_RATIO 32
+
+/*
+ * Scalar versions.
+ */
+
+// first index i >= lo such that array[i] >= target, or n
+static inline size_t sorted_gallop(const uint32_t *array, size_t lo, size_t n,
+                                   uint32_t target) {
+    if ((lo >= n) || (array[lo] >= target)) return lo;
+    size_t span = 1;
+    while ((lo + span < n) && (array[lo + span] < target)) span *= 2;
+    size_t low = lo + span / 2;  // array[low] < target
+    size_t high = (lo + span < n) ? lo + span : n;
+    while (low + 1 < high) {
+        size_t middle = (low + high) / 2;
+        if (array[middle] < target) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    return high;
+}
+
+static inline bool sorted_contains(const uint32_t *array, size_t n,
+                                   uint32_t value) {
+    if (n == 0) return false;
+    const uint32_t *base = array;
+    while (n > 1) {  // branchless binary search
+        size_t half = n / 2;
+        base = (base[half] <= value) ? base + half : base;
+        n -= half;
+    }
+    return *base == value;
+}
+
+static inline size_t sorted_intersect_gallop(const uint32_t *small, size_t ns,
+                                             const uint32_t *large, size_t nl,
+                                             uint32_t *out) {
+    size_t k = 0, j = 0;
+    for (size_t i = 0; i < ns; i++) {
+        j = sorted_gallop(large, j, nl, small[i]);
+        if (j == nl) break;
+        if (large[j] == small[i]) out[k++] = small[i];
+    }
+    return k;
+}
+
+static inline size_t sorted_intersect_scalar(const uint32_t *a, size_t na,
+                                             const uint32_t *b, size_t nb,
+                                             uint32_t *out) {
+    size_t i = 0, j = 0, k = 0;
+    while ((i < na) && (j < nb)) {
+        const uint32_t x = a[i], y = b[j];
+        out[k] = x;
+        k += (x == y);
+        i += (x <= y);
+        j += (y <= x);
+    }
+    return k;
+}
+
+static inline size_t sorted_intersect_count_scalar(const uint32_t *a, size_t na,
+                                                   const uint32_t *b, size_t nb) {
+    size_t i = 0, j = 0, k = 0;
+    while ((i < na) && (j < nb)) {
+        const uint32_t x = a[i], y = b[j];
+        k += (x == y);
+        i += (x <= y);
+        j += (y <= x);
+    }
+    return k;
+}
+
+static inline size_t sorted_union_scalar(const uint32_t *a, size_t na,
+                                         const uint32_t *b, size_t nb,
+                                         uint32_t *out) {
+    size_t i = 0, j = 0, k = 0;
+    while ((i < na) && (j < nb)) {
+        const uint32_t x = a[i], y = b[j];
+        out[k++] = (x <= y) ? x : y;
+        i += (x <= y);
+        j += (y <= x);
+    }
+    if (i < na) memcpy(out + k, a + i, (na - i) * sizeof(uint32_t));
+    k += na - i;
+    if (j < nb) memcpy(out + k, b + j, (nb - j) * sizeof(uint32_t));
+    return k + nb - j;
+}
+
+static inline size_t sorted_andnot_scalar(const uint32_t *a, size_t na,
+                                          const uint32_t *b, size_t nb,
+                                          uint32_t *out) {
+    size_t i = 0, j = 0, k = 0;
+    while ((i < na) && (j < nb)) {
+        const uint32_t x = a[i], y = b[j];
+        out[k] = x;
+        k += (x < y);
+        i += (x <= y);
+        j += (y <= x);
+    }
+    if (i < na) memcpy(out + k, a + i, (na - i) * sizeof(uint32_t));
+    return k + na - i;
+}
+
+static inline size_t sorted_xor_scalar(const uint32_t *a, size_t na,
+                                       const uint32_t *b, size_t nb,
+                                       uint32_t *out) {
+    size_t i = 0, j = 0, k = 0;
+    while ((i < na) && (j < nb)) {
+        const uint32_t x = a[i], y = b[j];
+        out[k] = (x < y) ? x : y;
+        k += (x != y);
+        i += (x <= y);
+        j += (y <= x);
+    }
+    if (i < na) memcpy(out + k, a + i, (na - i) * sizeof(uint32_t));
+    k += na - i;
+    if (j < nb) memcpy(out + k, b + j, (nb - j) * sizeof(uint32_t));
+    return k + nb - j;
+}
+
+static inline int sorted_compare(const void *x, const void *y) {
+    uint32_t a = *(const uint32_t *)x, b = *(const uint32_t *)y;
+    return (a > b) - (a < b);
+}
+
+// remove the repeated values of a sorted array
+static inline size_t sorted_unique(uint32_t *array, size_t n) {
+    if (n == 0) return 0;
+    size_t k = 1;
+    for (size_t i = 1; i < n; i++) {
+        if (array[i] != array[k - 1]) array[k++] = array[i];
+    }
+    return k;
+}
+
+// remove the values of a sorted array that appear twice, both copies
+static inline size_t sorted_unique_xor(uint32_t *array, size_t n) {
+    size_t k = 0;
+    for (size_t i = 0; i < n; i++) {
+        if ((i + 1 < n) && (array[i] == array[i + 1])) {
+            i++;
+        } else {
+            array[k++] = array[i];
+        }
+    }
+    return k;
+}
+
+#ifdef __AVX2__
+
+/*
+ * Vectorized versions.
+ */
+
+// bit l of the mask set for every lane l of x that is in y
+static inline int sorted_block_matches(__m256i x, __m256i y) {
+    __m256i eq = _mm256_cmpeq_epi32(x, y);
+    eq = _mm256_or_si256(eq, _mm256_cmpeq_epi32(x, _mm256_shuffle_epi32(y, 0x39)));
+    eq = _mm256_or_si256(eq, _mm256_cmpeq_epi32(x, _mm256_shuffle_epi32(y, 0x4E)));
+    eq = _mm256_or_si256(eq, _mm256_cmpeq_epi32(x, _mm256_shuffle_epi32(y, 0x93)));
+    const __m256i swapped = _mm256_permute2x128_si256(y, y, 1);
+    eq = _mm256_or_si256(eq, _mm256_cmpeq_epi32(x, swapped));
+    eq = _mm256_or_si256(eq, _mm256_cmpeq_epi32(x, _mm256_shuffle_epi32(swapped, 0x39)));
+    eq = _mm256_or_si256(eq, _mm256_cmpeq_epi32(x, _mm256_shuffle_epi32(swapped, 0x4E)));
+    eq = _mm256_or_si256(eq, _mm256_cmpeq_epi32(x, _mm256_shuffle_epi32(swapped, 0x93)));
+    return _mm256_movemask_ps(_mm256_castsi256_ps(eq));
+}
+
+// store the lanes of x selected by the mask, contiguously; returns how many
+static inline size_t sorted_store_selected(__m256i x, int mask, uint32_t *out) {
+    const uint64_t lanes = _pdep_u64((uint64_t)mask, 0x0101010101010101ULL) * 0xFF;
+    const uint64_t indexes = _pext_u64(0x0706050403020100ULL, lanes);
+    const __m256i permutation = _mm256_cvtepu8_epi32(_mm_cvtsi64_si128((long long)indexes));
+    _mm256_storeu_si256((__m256i *)out, _mm256_permutevar8x32_epi32(x, permutation));
+    return (size_t)_mm_popcnt_u32((unsigned)mask);
+}
+
+static inline size_t sorted_intersect(const uint32_t *a, size_t na,
+                                      const uint32_t *b, size_t nb,
+                                      uint32_t *out) {
+    if (na * SORTED_ARRAY_GALLOP_RATIO < nb) return sorted_intersect_gallop(a, na, b, nb, out);
+    if (nb * SORTED_ARRAY_GALLOP_RATIO < na) return sorted_intersect_gallop(b, nb, a, na, out);
+    size_t i = 0, j = 0, k = 0;
+    while ((i + 8 <= na) && (j + 8 <= nb)) {
+        const __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+        const __m256i y = _mm256_loadu_si256((const __m256i *)(b + j));
+        k += sorted_store_selected(x, sorted_block_matches(x, y), out + k);
+        const uint32_t amax = a[i + 7], bmax = b[j + 7];
+        i += (amax <= bmax) ? 8 : 0;
+        j += (bmax <= amax) ? 8 : 0;
+    }
+    return k + sorted_intersect_scalar(a + i, na - i, b + j, nb - j, out + k);
+}
+
+static inline size_t sorted_intersect_count(const uint32_t *a, size_t na,
+                                            const uint32_t *b, size_t nb) {
+    size_t i = 0, j = 0, k = 0;
+    while ((i + 8 <= na) && (j + 8 <= nb)) {
+        const __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+        const __m256i y = _mm256_loadu_si256((const __m256i *)(b + j));
+        k += (size_t)_mm_popcnt_u32((unsigned)sorted_block_matches(x, y));
+        const uint32_t amax = a[i + 7], bmax = b[j + 7];
+        i += (amax <= bmax) ? 8 : 0;
+        j += (bmax <= amax) ? 8 : 0;
+    }
+    return k + sorted_intersect_count_scalar(a + i, na - i, b + j, nb - j);
+}
+
+static inline size_t sorted_andnot(const uint32_t *a, size_t na,
+                                   const uint32_t *b, size_t nb,
+                                   uint32_t *out) {
+    size_t i = 0, j = 0, k = 0;
+    int found = 0;  // the values of the current block of a seen in b so far
+    while ((i + 8 <= na) && (j + 8 <= nb)) {
+        const __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+        const __m256i y = _mm256_loadu_si256((const __m256i *)(b + j));
+        found |= sorted_block_matches(x, y);
+        const uint32_t amax = a[i + 7], bmax = b[j + 7];
+        if (amax <= bmax) {
+            k += sorted_store_selected(x, ~found & 0xFF, out + k);
+            found = 0;
+            i += 8;
+        }
+        j += (bmax <= amax) ? 8 : 0;
+    }
+    if (found != 0) {  // the first values of a + i may have been seen already
+        for (size_t l = 0; l < 8; l++) {
+            if (((found >> l) & 1) == 0) {
+                const size_t p = sorted_gallop(b, j, nb, a[i + l]);
+                if ((p == nb) || (b[p] != a[i + l])) out[k++] = a[i + l];
+            }
+        }
+        i += 8;
+    }
+    return k + sorted_andnot_scalar(a + i, na - i, b + j, nb - j, out + k);
+}
+
+static const uint8_t sorted_pack_shuffle[16][16] = {
+    {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f},
+    {0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff, 0xff, 0xff, 0xff},
+    {0x00, 0x01, 0x02, 0x03, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff, 0xff, 0xff, 0xff},
+    {0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x0c, 0x0d, 0x0e, 0x0f, 0xff, 0xff, 0xff, 0xff},
+    {0x04, 0x05, 0x06, 0x07, 0x0c, 0x0d, 0x0e, 0x0f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0x00, 0x01, 0x02, 0x03, 0x0c, 0x0d, 0x0e, 0x0f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0x0c, 0x0d, 0x0e, 0x0f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0xff, 0xff, 0xff, 0xff},
+    {0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0x00, 0x01, 0x02, 0x03, 0x08, 0x09, 0x0a, 0x0b, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0x08, 0x09, 0x0a, 0x0b, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0x04, 0x05, 0x06, 0x07, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0x00, 0x01, 0x02, 0x03, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff}};
+
+// store the lanes of x not selected by the mask, contiguously
+static inline size_t sorted_store_packed(__m128i x, int dropped, uint32_t *out) {
+    const __m128i shuffle = _mm_loadu_si128((const __m128i *)sorted_pack_shuffle[dropped]);
+    _mm_storeu_si128((__m128i *)out, _mm_shuffle_epi8(x, shuffle));
+    return 4 - (size_t)_mm_popcnt_u32((unsigned)dropped);
+}
+
+/*
+ * Merge two sorted blocks of 4 values: vecmin gets the 4 smallest values
+ * and vecmax the 4 largest, both sorted (as sse_merge in CRoaring).
+ */
+static inline void sorted_merge_blocks(__m128i x, __m128i y, __m128i *vecmin,
+                                       __m128i *vecmax) {
+    __m128i tmp = _mm_min_epu32(x, y);
+    *vecmax = _mm_max_epu32(x, y);
+    for (int r = 0; r < 3; r++) {
+        tmp = _mm_alignr_epi8(tmp, tmp, 4);
+        *vecmin = _mm_min_epu32(tmp, *vecmax);
+        *vecmax = _mm_max_epu32(tmp, *vecmax);
+        tmp = *vecmin;
+    }
+    *vecmin = _mm_alignr_epi8(tmp, tmp, 4);
+}
+
+// store the values of block that differ from their predecessor
+static inline size_t sorted_store_unique(__m128i last, __m128i block,
+                                         uint32_t *out) {
+    const __m128i previous = _mm_alignr_epi8(block, last, 12);
+    const int dropped = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(previous, block)));
+    return sorted_store_packed(block, dropped, out);
+}
+
+/*
+ * Store the values preceding those of block (the last value of last, then
+ * the first three of block) that differ from both of their neighbours.
+ */
+static inline size_t sorted_store_unique_xor(__m128i last, __m128i block,
+                                             uint32_t *out) {
+    const __m128i left = _mm_alignr_epi8(block, last, 8);
+    const __m128i middle = _mm_alignr_epi8(block, last, 12);
+    const __m128i equal = _mm_or_si128(_mm_cmpeq_epi32(middle, left),
+                                       _mm_cmpeq_epi32(middle, block));
+    return sorted_store_packed(middle, _mm_movemask_ps(_mm_castsi128_ps(equal)), out);
+}
+
+/*
+ * The vectorized merge shared by unions and symmetric differences, as in
+ * CRoaring's union_vector16 and xor_vector16: blocks of 4 values are taken
+ * from the array whose next block starts with the smaller value and merged
+ * with the largest values so far; the values that fall below are stored.
+ * The end is merged with the scalar code.
+ */
+static inline size_t sorted_merge(const uint32_t *a, size_t na, const uint32_t *b,
+                                  size_t nb, uint32_t *out, bool symmetric) {
+    if ((na < 4) || (nb < 4)) {
+        return symmetric ? sorted_xor_scalar(a, na, b, nb, out)
+                         : sorted_union_scalar(a, na, b, nb, out);
+    }
+    const size_t len1 = na / 4, len2 = nb / 4;
+    size_t pos1 = 1, pos2 = 1, k = 0;
+    __m128i vecmin, vecmax, block;
+    // a sentinel that differs from the smallest value
+    const uint32_t smallest = (a[0] < b[0]) ? a[0] : b[0];
+    __m128i last = _mm_set1_epi32((int)(smallest - 1));
+    sorted_merge_blocks(_mm_loadu_si128((const __m128i *)a),
+                        _mm_loadu_si128((const __m128i *)b), &vecmin, &vecmax);
+    k += symmetric ? sorted_store_unique_xor(last, vecmin, out + k)
+                   : sorted_store_unique(last, vecmin, out + k);
+    last = vecmin;
+    if ((pos1 < len1) && (pos2 < len2)) {
+        uint32_t cur1 = a[4 * pos1], cur2 = b[4 * pos2];
+        while (true) {
+            if (cur1 <= cur2) {
+                block = _mm_loadu_si128((const __m128i *)(a + 4 * pos1));
+                ++pos1;
+                if (pos1 == len1) break;
+                cur1 = a[4 * pos1];
+            } else {
+                block = _mm_loadu_si128((const __m128i *)(b + 4 * pos2));
+                ++pos2;
+                if (pos2 == len2) break;
+                cur2 = b[4 * pos2];
+            }
+            sorted_merge_blocks(block, vecmax, &vecmin, &vecmax);
+            k += symmetric ? sorted_store_unique_xor(last, vecmin, out + k)
+                           : sorted_store_unique(last, vecmin, out + k);
+            last = vecmin;
+        }
+        sorted_merge_blocks(block, vecmax, &vecmin, &vecmax);
+        k += symmetric ? sorted_store_unique_xor(last, vecmin, out + k)
+                       : sorted_store_unique(last, vecmin, out + k);
+        last = vecmin;
+    }
+    // the largest values so far, plus the rest of the exhausted array,
+    // are merged with the rest of the other array
+    uint32_t buffer[4 + 4 + 4];
+    size_t leftover;
+    if (symmetric) {
+        leftover = sorted_store_unique_xor(last, vecmax, buffer);
+        const uint32_t max3 = (uint32_t)_mm_extract_epi32(vecmax, 3);
+        const uint32_t max2 = (uint32_t)_mm_extract_epi32(vecmax, 2);
+        if (max3 != max2) buffer[leftover++] = max3;
+    } else {
+        leftover = sorted_store_unique(last, vecmax, buffer);
+    }
+    const uint32_t *rest;
+    size_t restsize;
+    if (pos1 == len1) {
+        memcpy(buffer + leftover, a + 4 * pos1, (na - 4 * len1) * sizeof(uint32_t));
+        leftover += na - 4 * len1;
+        rest = b + 4 * pos2;
+        restsize = nb - 4 * pos2;
+    } else {
+        memcpy(buffer + leftover, b + 4 * pos2, (nb - 4 * len2) * sizeof(uint32_t));
+        leftover += nb - 4 * len2;
+        rest = a + 4 * pos1;
+        restsize = na - 4 * pos1;
+    }
+    qsort(buffer, leftover, sizeof(uint32_t), sorted_compare);
+    if (symmetric) {
+        leftover = sorted_unique_xor(buffer, leftover);
+        return k + sorted_xor_scalar(buffer, leftover, rest, restsize, out + k);
+    }
+    leftover = sorted_unique(buffer, leftover);
+    return k + sorted_union_scalar(buffer, leftover, rest, restsize, out + k);
+}
+
+static inline size_t sorted_union(const uint32_t *a, size_t na, const uint32_t *b,
+                                  size_t nb, uint32_t *out) {
+    return sorted_merge(a, na, b, nb, out, false);
+}
+
+static inline size_t sorted_xor(const uint32_t *a, size_t na, const uint32_t *b,
+                                size_t nb, uint32_t *out) {
+    return sorted_merge(a, na, b, nb, out, true);
+}
+
+#else
+
+static inline size_t sorted_intersect(const uint32_t *a, size_t na,
+                                      const uint32_t *b, size_t nb,
+                                      uint32_t *out) {
+    if (na * SORTED_ARRAY_GALLOP_RATIO < nb) return sorted_intersect_gallop(a, na, b, nb, out);
+    if (nb * SORTED_ARRAY_GALLOP_RATIO < na) return sorted_intersect_gallop(b, nb, a, na, out);
+    return sorted_intersect_scalar(a, na, b, nb, out);
+}
+
+static inline size_t sorted_intersect_count(const uint32_t *a, size_t na,
+                                            const uint32_t *b, size_t nb) {
+    return sorted_intersect_count_scalar(a, na, b, nb);
+}
+
+static inline size_t sorted_andnot(const uint32_t *a, size_t na,
+                                   const uint32_t *b, size_t nb,
+                                   uint32_t *out) {
+    return sorted_andnot_scalar(a, na, b, nb, out);
+}
+
+static inline size_t sorted_union(const uint32_t *a, size_t na, const uint32_t *b,
+                                  size_t nb, uint32_t *out) {
+    return sorted_union_scalar(a, na, b, nb, out);
+}
+
+static inline size_t sorted_xor(const uint32_t *a, size_t na, const uint32_t *b,
+                                size_t nb, uint32_t *out) {
+    return sorted_xor_scalar(a, na, b, nb, out);
+}
+
+#endif  // __AVX2__
+
+#endif
@@ -24,37 +24,53 @@ extern "C" {
 
 
 
-#ifdef MEMTRACKED
-#include "memtrackingallocator.h"
+/**
+ * With -DKEY64, the values are 64-bit integers (stl_vector64_benchmarks and
+ * stl_hashset64_benchmarks, over files made by gen -H).
+ */
+#ifdef KEY64
+typedef uint64_t integer;
 #else
-size_t memory_usage;
+typedef uint32_t integer;
 #endif
 
+#ifdef MEMTRACKED
+#include "memtrackingallocator.h"
+
 void initializeMemUsageCounter()  {
-    memory_usage = 0;
+    memcounters_reset();
 }
 
 uint64_t getMemUsageInBytes()  {
-    return memory_usage;
+    return tracked_memory_usage();
+}
+#else
+void initializeMemUsageCounter()  {
 }
 
+uint64_t getMemUsageInBytes()  {
+    return 0;
+}
+#endif
+
 
 #ifdef MEMTRACKED
-typedef std::unordered_set<uint32_t,std::hash<uint32_t>,std::equal_to<uint32_t>,MemoryCountingAllocator<uint32_t> >  hashset;
+typedef std::unordered_set<integer,std::hash<integer>,std::equal_to<integer>,MemoryCountingAllocator<integer> >  hashset;
 #else
-typedef std::unordered_set<uint32_t>  hashset;
+typedef std::unordered_set<integer>  hashset;
 #endif
 
 /**
  * Once you have collected all the integers, build the bitmaps.
  */
 static std::vector<hashset> create_all_bitmaps(size_t *howmany,
-        uint32_t **numbers, size_t count) {
+        integer **numbers, size_t count) {
     if (numbers == NULL) return std::vector<hashset >();
     std::vector<hashset> answer(count);
     for (size_t i = 0; i < count; i++) {
         hashset & bm = answer[i];
-        uint32_t * mynumbers = numbers[i];
+        integer * mynumbers = numbers[i];
+        bm.reserve(howmany[i]);
         for(size_t j = 0; j < howmany[i] ; ++j) {
             bm.insert(mynumbers[j]);
         }
@@ -137,7 +153,13 @@ static void printusage(char *command) {
         "benchmarks/realdata/census1881\n",
         command);
     ;
-    printf("the -v flag turns on verbose mode");
+    printf("the -v flag turns on verbose mode\n");
+    printf("the -b flag reads the data from a binary cache next to the directory, creating it if needed\n");
+    printf("the -j flag sets the number of threads parsing the data files (0: one per processor)\n");
+    printf("the -p flag records hardware performance counters for each phase\n");
+    printf("the -n flag followed by a number repeats each phase that many times and reports statistics\n");
+    printf("the -w flag followed by a number runs each phase that many times before measuring it\n");
+    printf("the -o flag followed by text, json or csv sets the output format\n");
 
 }
 
@@ -152,12 +174,35 @@ int main(int argc, char **argv) {
     int c;
     const char *extension = ".txt";
     bool verbose = false;
-    uint64_t data[13];
+    uint64_t data[14];
     initializeMemUsageCounter();
-    while ((c = getopt(argc, argv, "ve:h")) != -1) switch (c) {
+    while ((c = getopt(argc, argv, "bj:pn:w:o:ve:h")) != -1) switch (c) {
         case 'e':
             extension = optarg;
             break;
+        case 'b':
+            use_binary_cache = true;
+            break;
+        case 'j':
+            loader_threads = atoi(optarg);
+            break;
+        case 'p':
+            perf_counters_enabled = perf_counters_init();
+            break;
+        case 'n':
+            benchmark_repetitions = atoi(optarg);
+            if (benchmark_repetitions < 1) benchmark_repetitions = 1;
+            break;
+        case 'w':
+            benchmark_warmups = atoi(optarg);
+            if (benchmark_warmups < 0) benchmark_warmups = 0;
+            break;
+        case 'o':
+            if (!report_set_format(optarg)) {
+                printf("Unknown output format %s (text, json or csv).\n", optarg);
+                return -1;
+            }
+            break;
         case 'v':
             verbose = true;
             break;
@@ -172,12 +217,18 @@ int main(int argc, char **argv) {
         return -1;
     }
     char *dirname = argv[optind];
+    report_record_flags(argc, argv, optind);
     size_t count;
 
 
     size_t *howmany = NULL;
-    uint32_t **numbers =
+#ifdef KEY64
+    integer **numbers =
+        read_all_integer_files64(dirname, extension, &howmany, &count);
+#else
+    integer **numbers =
         read_all_integer_files(dirname, extension, &howmany, &count);
+#endif
     if (numbers == NULL) {
         printf(
             "I could not find or load any data file with extension %s in "
@@ -185,7 +236,7 @@ int main(int argc, char **argv) {
             extension, dirname);
         return -1;
     }
-    uint32_t maxvalue = 0;
+    integer maxvalue = 0;
     for (size_t i = 0; i < count; i++) {
       if( howmany[i] > 0 ) {
         if(maxvalue < numbers[i][howmany[i]-1]) {
@@ -201,13 +252,14 @@ int main(int argc, char **argv) {
     for (size_t i = 1; i < count; i++) {
       successivecard += howmany[i-1] + howmany[i];
     }
-    uint64_t cycles_start = 0, cycles_final = 0;
 
-    RDTSC_START(cycles_start);
-    std::vector<hashset > bitmaps = create_all_bitmaps(howmany, numbers, count);
-    RDTSC_FINAL(cycles_final);
+    std::vector<hashset > bitmaps;
+    BEGIN_SINGLE_PHASE(0)
+    bitmaps = create_all_bitmaps(howmany, numbers, count);
+    END_PHASE(0, data[13])
     if (bitmaps.empty()) return -1;
     if(verbose) printf("Loaded %d bitmaps from directory %s \n", (int)count, dirname);
+    if(verbose) printf("Building the bitmaps took %" PRIu64 " cycles\n", data[13]);
     uint64_t totalsize = getMemUsageInBytes();
     data[0] = totalsize;
 
@@ -221,29 +273,29 @@ int main(int argc, char **argv) {
     uint64_t successive_xor = 0;
 
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(1)
+    successive_and = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         hashset v;
         intersection(bitmaps[i], bitmaps[i + 1], v);
         successive_and += v.size();
     }
-    RDTSC_FINAL(cycles_final);
-    data[1] = cycles_final - cycles_start;
+    END_PHASE(1, data[1])
     if(verbose) printf("Successive intersections on %zu bitmaps took %" PRIu64 " cycles\n", count,
-                           cycles_final - cycles_start);
+                           data[1]);
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(2)
+    successive_or = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         hashset v (bitmaps[i]);
         inplace_union(v, bitmaps[i + 1]);
         successive_or += v.size();
     }
-    RDTSC_FINAL(cycles_final);
-    data[2] = cycles_final - cycles_start;
+    END_PHASE(2, data[2])
     if(verbose) printf("Successive unions on %zu bitmaps took %" PRIu64 " cycles\n", count,
-                           cycles_final - cycles_start);
+                           data[2]);
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(3)
     if(count>1) {
         hashset v (bitmaps[0]);
         inplace_union(v, bitmaps[1]);
@@ -252,11 +304,10 @@ int main(int argc, char **argv) {
         }
         total_or = v.size();
     }
-    RDTSC_FINAL(cycles_final);
-    data[3] = cycles_final - cycles_start;
+    END_PHASE(3, data[3])
     if(verbose) printf("Total naive unions on %zu bitmaps took %" PRIu64 " cycles\n", count,
-                           cycles_final - cycles_start);
-    RDTSC_START(cycles_start);
+                           data[3]);
+    BEGIN_PHASE(4)
     if(count>1){
       hashset **sortedbitmaps = (hashset**) malloc(sizeof(hashset*) * count);
       for (int i = 0; i < (int)count ; ++i) sortedbitmaps[i] = & bitmaps[i];
@@ -268,61 +319,60 @@ int main(int argc, char **argv) {
         total_or = v.size();
         free(sortedbitmaps);
     }
-    RDTSC_FINAL(cycles_final);
-    data[4] = cycles_final - cycles_start;
+    END_PHASE(4, data[4])
     if(verbose) printf("Total sorted unions on %zu bitmaps took %" PRIu64 " cycles\n", count,
-                           cycles_final - cycles_start);
+                           data[4]);
 
-    uint64_t quartcount;
-    STARTBEST(quartile_test_repetitions)
+    uint64_t quartcount = 0;
+    BEGIN_REPEATED_PHASE(5, quartile_test_repetitions)
     quartcount = 0;
     for (size_t i = 0; i < count ; ++i) {
-      quartcount += (bitmaps[i].find(maxvalue/4) == bitmaps[i].end());
-      quartcount += (bitmaps[i].find(maxvalue/2) == bitmaps[i].end());
-      quartcount += (bitmaps[i].find(3*maxvalue/4) == bitmaps[i].end());
+      quartcount += (bitmaps[i].find(maxvalue/4) != bitmaps[i].end());
+      quartcount += (bitmaps[i].find(maxvalue/2) != bitmaps[i].end());
+      quartcount += (bitmaps[i].find(3*maxvalue/4) != bitmaps[i].end());
     }
-    ENDBEST(data[5])
+    END_PHASE(5, data[5])
 
     if(verbose) printf("Quartile queries on %zu bitmaps took %" PRIu64 " cycles\n", count,
            data[5]);
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(6)
+    successive_andnot = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         hashset v;
         difference(bitmaps[i], bitmaps[i + 1], v);
         successive_andnot += v.size();
     }
-    RDTSC_FINAL(cycles_final);
-    data[6] = cycles_final - cycles_start;
+    END_PHASE(6, data[6])
 
     if(verbose) printf("Successive differences on %zu bitmaps took %" PRIu64 " cycles\n", count,
-           cycles_final - cycles_start);
+           data[6]);
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(7)
+    successive_xor = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         hashset v;
         symmetric_difference(bitmaps[i], bitmaps[i + 1], v);
         successive_xor += v.size();
     }
-    RDTSC_FINAL(cycles_final);
-    data[7] = cycles_final - cycles_start;
+    END_PHASE(7, data[7])
 
     if(verbose) printf("Successive symmetric differences on %zu bitmaps took %" PRIu64 " cycles\n", count,
-           cycles_final - cycles_start);
+           data[7]);
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(8)
+    total_count = 0;
     for (size_t i = 0; i < count; ++i) {
         hashset & b = bitmaps[i];
         for(auto j = b.begin(); j != b.end() ; j++) {
             total_count++;
         }
     }
-    RDTSC_FINAL(cycles_final);
-    data[8] = cycles_final - cycles_start;
+    END_PHASE(8, data[8])
     assert(total_count == totalcard);
 
     if(verbose) printf("Iterating over %zu bitmaps took %" PRIu64 " cycles\n", count,
-           cycles_final - cycles_start);
+           data[8]);
 
 
     if(verbose) printf("Collected stats  %" PRIu64 "  %" PRIu64 "  %" PRIu64 " %" PRIu64 "\n",successive_and,successive_or,total_or,quartcount);
@@ -338,33 +388,33 @@ int main(int argc, char **argv) {
     uint64_t successive_andnotcard = 0;
     uint64_t successive_xorcard = 0;
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(9)
+    successive_andcard = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         successive_andcard += intersection_count(bitmaps[i], bitmaps[i + 1]);
     }
-    RDTSC_FINAL(cycles_final);
-    data[9] = cycles_final - cycles_start;
+    END_PHASE(9, data[9])
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(10)
+    successive_orcard = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         successive_orcard += union_count(bitmaps[i], bitmaps[i + 1]);
     }
-    RDTSC_FINAL(cycles_final);
-    data[10] = cycles_final - cycles_start;
+    END_PHASE(10, data[10])
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(11)
+    successive_andnotcard = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         successive_andnotcard += difference_count(bitmaps[i], bitmaps[i + 1]);
     }
-    RDTSC_FINAL(cycles_final);
-    data[11] = cycles_final - cycles_start;
+    END_PHASE(11, data[11])
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(12)
+    successive_xorcard = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
         successive_xorcard += symmetric_difference_count(bitmaps[i], bitmaps[i + 1]);
     }
-    RDTSC_FINAL(cycles_final);
-    data[12] = cycles_final - cycles_start;
+    END_PHASE(12, data[12])
 
     assert(successive_andcard == successive_and);
     assert(successive_orcard == successive_or);
@@ -374,21 +424,12 @@ int main(int argc, char **argv) {
     /**
     * end and, or, andnot and xor cardinality
     */
-    printf(" %20.2f %20.2f %20.2f %20.2f %20.2f %20.2f  %20.2f  %20.2f     %20.2f    %20.2f  %20.2f  %20.2f  %20.2f\n",
-      data[0]*8.0/totalcard,
-      data[1]*1.0/successivecard,
-      data[2]*1.0/successivecard,
-      data[3]*1.0/totalcard,
-      data[4]*1.0/totalcard,
-      data[5]*1.0/(3*count),
-      data[6]*1.0/successivecard,
-      data[7]*1.0/successivecard,
-      data[8]*1.0/totalcard,
-      data[9]*1.0/successivecard,
-      data[10]*1.0/successivecard,
-      data[11]*1.0/successivecard,
-      data[12]*1.0/successivecard
-    );
+    report_cardinalities(successive_and, successive_or, total_or, quartcount,
+                         successive_andnot, successive_xor, total_count);
+    benchmark_report(report_basename(argv[0]), dirname, data, 14, count,
+                     totalcard, successivecard);
+    perf_counters_print();
+    phase_stats_print();
 
     for (int i = 0; i < (int)count; ++i) {
         free(numbers[i]);
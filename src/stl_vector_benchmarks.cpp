@@ -19,20 +19,36 @@ extern "C" {
 #ifdef __cplusplus
 }
 #endif
+#include "arena.h"
 
-#ifdef MEMTRACKED
-#include "memtrackingallocator.h"
+/**
+ * With -DKEY64, the values are 64-bit integers (stl_vector64_benchmarks and
+ * stl_hashset64_benchmarks, over files made by gen -H).
+ */
+#ifdef KEY64
+typedef uint64_t integer;
 #else
-size_t memory_usage;
+typedef uint32_t integer;
 #endif
 
+#ifdef MEMTRACKED
+#include "memtrackingallocator.h"
+
 void initializeMemUsageCounter()  {
-    memory_usage = 0;
+    memcounters_reset();
 }
 
 uint64_t getMemUsageInBytes()  {
-    return memory_usage;
+    return tracked_memory_usage();
 }
+#else
+void initializeMemUsageCounter()  {
+}
+
+uint64_t getMemUsageInBytes()  {
+    return 0;
+}
+#endif
 
 // credit http://stackoverflow.com/questions/37767585/count-elements-in-union-of-two-sets-using-stl
 template <typename T>
@@ -50,37 +66,42 @@ public:
     count_back_inserter &operator++(){ count++;return *this; }
 
 };
-typedef count_back_inserter<uint32_t> inserter;
+typedef count_back_inserter<integer> inserter;
 
 #ifdef MEMTRACKED
-typedef std::vector<uint32_t,MemoryCountingAllocator<uint32_t> >  vector;
+typedef std::vector<integer,MemoryCountingAllocator<integer> >  vector;
+// the temporary results come from the arena with -A (see arena.h)
+typedef std::vector<integer,ArenaAllocator<integer, MemoryCountingAllocator<integer> > >  temp_vector;
 #else
-typedef std::vector<uint32_t>  vector;
+typedef std::vector<integer>  vector;
+typedef std::vector<integer,ArenaAllocator<integer> >  temp_vector;
 #endif
 
-static vector  fast_logicalor(size_t n, const vector **inputs) {
+static temp_vector  fast_logicalor(size_t n, const vector **inputs) {
+	  // an input or an intermediate result, which we own
 	  class StdVectorPtr {
 
 	  public:
-	    StdVectorPtr(const vector *p, bool o) : ptr(p), own(o) {}
-	    const vector *ptr;
-	    bool own; // whether to clean
+	    StdVectorPtr(const integer *b, const integer *e, const temp_vector *o) : first(b), last(e), own(o) {}
+	    const integer *first;
+	    const integer *last;
+	    const temp_vector *own; // to clean, if not NULL
 
 	    bool operator<(const StdVectorPtr &o) const {
-	      return o.ptr->size() < ptr->size(); // backward on purpose
+	      return o.last - o.first < last - first; // backward on purpose
 	    }
 	  };
 
 	  if (n == 0) {
-		return vector();
+		return temp_vector();
 	  }
 	  if (n == 1) {
-	    return vector(*inputs[0]);
+	    return temp_vector(inputs[0]->begin(), inputs[0]->end());
 	  }
 	  std::priority_queue<StdVectorPtr> pq;
 	  for (size_t i = 0; i < n; i++) {
 	    // could use emplace
-	    pq.push(StdVectorPtr(inputs[i], false));
+	    pq.push(StdVectorPtr(inputs[i]->data(), inputs[i]->data() + inputs[i]->size(), NULL));
 	  }
 	  while (pq.size() > 2) {
 
@@ -89,15 +110,11 @@ static vector  fast_logicalor(size_t n, const vector **inputs) {
 
 	    StdVectorPtr x2 = pq.top();
 	    pq.pop();
-	    vector * buffer = new vector();
-      std::set_union(x1.ptr->begin(), x1.ptr->end(),x2.ptr->begin(), x2.ptr->end(),std::back_inserter(*buffer));
-	    if (x1.own) {
-	      delete x1.ptr;
-	    }
-	    if (x2.own) {
-	      delete x2.ptr;
-	    }
-	    pq.push(StdVectorPtr(buffer, true));
+	    temp_vector * buffer = new temp_vector();
+      std::set_union(x1.first, x1.last,x2.first, x2.last,std::back_inserter(*buffer));
+	    delete x1.own;
+	    delete x2.own;
+	    pq.push(StdVectorPtr(buffer->data(), buffer->data() + buffer->size(), buffer));
 	  }
 	  StdVectorPtr x1 = pq.top();
 	  pq.pop();
@@ -105,15 +122,11 @@ static vector  fast_logicalor(size_t n, const vector **inputs) {
 	  StdVectorPtr x2 = pq.top();
 	  pq.pop();
 
-	  vector  container;
-    std::set_union(x1.ptr->begin(), x1.ptr->end(),x2.ptr->begin(), x2.ptr->end(),std::back_inserter(container));
+	  temp_vector  container;
+    std::set_union(x1.first, x1.last,x2.first, x2.last,std::back_inserter(container));
 
-	  if (x1.own) {
-	    delete x1.ptr;
-	  }
-	  if (x2.own) {
-	    delete x2.ptr;
-	  }
+	  delete x1.own;
+	  delete x2.own;
 	  return container;
 	}
 
@@ -123,17 +136,12 @@ static vector  fast_logicalor(size_t n, const vector **inputs) {
  * Once you have collected all the integers, build the bitmaps.
  */
 static std::vector<vector > create_all_bitmaps(size_t *howmany,
-        uint32_t **numbers, size_t count) {
+        integer **numbers, size_t count) {
     if (numbers == NULL) return std::vector<vector >();
     std::vector<vector > answer(count);
 
     for (size_t i = 0; i < count; i++) {
-        vector & bm = answer[i];
-        uint32_t * mynumbers = numbers[i];
-        for(size_t j = 0; j < howmany[i] ; ++j) {
-            bm.push_back(mynumbers[j]);
-        }
-        bm.shrink_to_fit();
+        answer[i].assign(numbers[i], numbers[i] + howmany[i]);
     }
     return answer;
 }
@@ -144,7 +152,14 @@ static void printusage(char *command) {
         "benchmarks/realdata/census1881\n",
         command);
     ;
-    printf("the -v flag turns on verbose mode");
+    printf("the -v flag turns on verbose mode\n");
+    printf("the -b flag reads the data from a binary cache next to the directory, creating it if needed\n");
+    printf("the -j flag sets the number of threads parsing the data files (0: one per processor)\n");
+    printf("the -p flag records hardware performance counters for each phase\n");
+    printf("the -n flag followed by a number repeats each phase that many times and reports statistics\n");
+    printf("the -w flag followed by a number runs each phase that many times before measuring it\n");
+    printf("the -o flag followed by text, json or csv sets the output format\n");
+    printf("the -A flag takes the temporary results from an arena reset between operations\n");
 
 }
 
@@ -152,12 +167,38 @@ int main(int argc, char **argv) {
     int c;
     const char *extension = ".txt";
     bool verbose = false;
-    uint64_t data[13];
+    uint64_t data[14];
     initializeMemUsageCounter();
-    while ((c = getopt(argc, argv, "ve:h")) != -1) switch (c) {
+    while ((c = getopt(argc, argv, "bj:pn:w:o:Ave:h")) != -1) switch (c) {
         case 'e':
             extension = optarg;
             break;
+        case 'b':
+            use_binary_cache = true;
+            break;
+        case 'j':
+            loader_threads = atoi(optarg);
+            break;
+        case 'p':
+            perf_counters_enabled = perf_counters_init();
+            break;
+        case 'n':
+            benchmark_repetitions = atoi(optarg);
+            if (benchmark_repetitions < 1) benchmark_repetitions = 1;
+            break;
+        case 'w':
+            benchmark_warmups = atoi(optarg);
+            if (benchmark_warmups < 0) benchmark_warmups = 0;
+            break;
+        case 'o':
+            if (!report_set_format(optarg)) {
+                printf("Unknown output format %s (text, json or csv).\n", optarg);
+                return -1;
+            }
+            break;
+        case 'A':
+            arena_enabled = true;
+            break;
         case 'v':
             verbose = true;
             break;
@@ -172,12 +213,18 @@ int main(int argc, char **argv) {
         return -1;
     }
     char *dirname = argv[optind];
+    report_record_flags(argc, argv, optind);
     size_t count;
 
 
     size_t *howmany = NULL;
-    uint32_t **numbers =
+#ifdef KEY64
+    integer **numbers =
+        read_all_integer_files64(dirname, extension, &howmany, &count);
+#else
+    integer **numbers =
         read_all_integer_files(dirname, extension, &howmany, &count);
+#endif
     if (numbers == NULL) {
         printf(
             "I could not find or load any data file with extension %s in "
@@ -185,7 +232,7 @@ int main(int argc, char **argv) {
             extension, dirname);
         return -1;
     }
-    uint32_t maxvalue = 0;
+    integer maxvalue = 0;
     for (size_t i = 0; i < count; i++) {
       if( howmany[i] > 0 ) {
         if(maxvalue < numbers[i][howmany[i]-1]) {
@@ -201,13 +248,14 @@ int main(int argc, char **argv) {
     for (size_t i = 1; i < count; i++) {
        successivecard += howmany[i-1] + howmany[i];
     }
-    uint64_t cycles_start = 0, cycles_final = 0;
 
-    RDTSC_START(cycles_start);
-    std::vector<vector> bitmaps = create_all_bitmaps(howmany, numbers, count);
-    RDTSC_FINAL(cycles_final);
+    std::vector<vector> bitmaps;
+    BEGIN_SINGLE_PHASE(0)
+    bitmaps = create_all_bitmaps(howmany, numbers, count);
+    END_PHASE(0, data[13])
     if (bitmaps.empty()) return -1;
     if(verbose) printf("Loaded %d bitmaps from directory %s \n", (int)count, dirname);
+    if(verbose) printf("Building the bitmaps took %" PRIu64 " cycles\n", data[13]);
     uint64_t totalsize = getMemUsageInBytes();
     data[0] = totalsize;
 
@@ -221,58 +269,67 @@ int main(int argc, char **argv) {
     uint64_t successive_xor = 0;
 
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(1)
+    arena_start();
+    successive_and = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
-        vector v;
+        arena_reset(); // the previous result is gone
+        temp_vector v;
         std::set_intersection(bitmaps[i].begin(), bitmaps[i].end(),bitmaps[i+1].begin(), bitmaps[i+1].end(),std::back_inserter(v));
         successive_and += v.size();
     }
-    RDTSC_FINAL(cycles_final);
-    data[1] = cycles_final - cycles_start;
+    arena_stop();
+    END_PHASE(1, data[1])
     if(verbose) printf("Successive intersections on %zu bitmaps took %" PRIu64 " cycles\n", count,
-                           cycles_final - cycles_start);
+                           data[1]);
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(2)
+    arena_start();
+    successive_or = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
-        vector v;
+        arena_reset(); // the previous result is gone
+        temp_vector v;
         std::set_union(bitmaps[i].begin(), bitmaps[i].end(),bitmaps[i+1].begin(), bitmaps[i+1].end(),std::back_inserter(v));
         successive_or += v.size();
     }
-    RDTSC_FINAL(cycles_final);
-    data[2] = cycles_final - cycles_start;
+    arena_stop();
+    END_PHASE(2, data[2])
     if(verbose) printf("Successive unions on %zu bitmaps took %" PRIu64 " cycles\n", count,
-                           cycles_final - cycles_start);
+                           data[2]);
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(3)
+    arena_start(); // intermediate results pile up until arena_stop (see arena.h)
     if(count>1) {
-        vector v;
+        temp_vector v;
         std::set_union(bitmaps[0].begin(), bitmaps[0].end(),bitmaps[1].begin(), bitmaps[1].end(),std::back_inserter(v));
         for (int i = 2; i < (int)count ; ++i) {
-            vector newv;
+            temp_vector newv;
             std::set_union(v.begin(), v.end(),bitmaps[i].begin(), bitmaps[i].end(),std::back_inserter(newv));
             v.swap(newv);
         }
         total_or = v.size();
     }
-    RDTSC_FINAL(cycles_final);
-    data[3] = cycles_final - cycles_start;
+    arena_stop();
+    END_PHASE(3, data[3])
     if(verbose) printf("Total naive unions on %zu bitmaps took %" PRIu64 " cycles\n", count,
-                           cycles_final - cycles_start);
-    RDTSC_START(cycles_start);
+                           data[3]);
+    BEGIN_PHASE(4)
+    arena_start(); // intermediate results pile up until arena_stop (see arena.h)
     if(count>1) {
         const vector  ** allofthem = new const vector* [count];
         for(int i = 0 ; i < (int) count; ++i) allofthem[i] = & bitmaps[i];
-        vector totalorbitmap = fast_logicalor(count, allofthem);
+        temp_vector totalorbitmap = fast_logicalor(count, allofthem);
         total_or = totalorbitmap.size();
         delete[] allofthem;
     }
-    RDTSC_FINAL(cycles_final);
-    data[4] = cycles_final - cycles_start;
+    arena_stop();
+    END_PHASE(4, data[4])
     if(verbose) printf("Total heap unions on %zu bitmaps took %" PRIu64 " cycles\n", count,
-                           cycles_final - cycles_start);
+                           data[4]);
 
-    RDTSC_START(cycles_start);
     uint64_t quartcount = 0;
+    BEGIN_PHASE(5)
+    quartcount = 0;
     for (size_t i = 0; i < count ; ++i) {
       if ( std::binary_search(bitmaps[i].begin(),bitmaps[i].end(),maxvalue/4 ) )
       	quartcount ++;
@@ -281,51 +338,56 @@ int main(int argc, char **argv) {
       if ( std::binary_search(bitmaps[i].begin(),bitmaps[i].end(),3*maxvalue/4 ) )
       	quartcount ++;
     }
-    RDTSC_FINAL(cycles_final);
-    data[5] = cycles_final - cycles_start;
+    END_PHASE(5, data[5])
 
     if(verbose) printf("Quartile queries on %zu bitmaps took %" PRIu64 " cycles\n", count,
-           cycles_final - cycles_start);
+           data[5]);
 
     if(verbose) printf("Collected stats  %" PRIu64 "  %" PRIu64 "  %" PRIu64 " %" PRIu64 "\n",successive_and,successive_or,total_or,quartcount);
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(6)
+    arena_start();
+    successive_andnot = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
-        vector v;
+        arena_reset(); // the previous result is gone
+        temp_vector v;
         std::set_difference(bitmaps[i].begin(), bitmaps[i].end(),bitmaps[i+1].begin(), bitmaps[i+1].end(),std::back_inserter(v));
         successive_andnot += v.size();
     }
-    RDTSC_FINAL(cycles_final);
-    data[6] = cycles_final - cycles_start;
+    arena_stop();
+    END_PHASE(6, data[6])
 
     if(verbose) printf("Successive differences on %zu bitmaps took %" PRIu64 " cycles\n", count,
-           cycles_final - cycles_start);
+           data[6]);
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(7)
+    arena_start();
+    successive_xor = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
-        vector v;
+        arena_reset(); // the previous result is gone
+        temp_vector v;
         std::set_symmetric_difference(bitmaps[i].begin(), bitmaps[i].end(),bitmaps[i+1].begin(), bitmaps[i+1].end(),std::back_inserter(v));
         successive_xor += v.size();
     }
-    RDTSC_FINAL(cycles_final);
-    data[7] = cycles_final - cycles_start;
+    arena_stop();
+    END_PHASE(7, data[7])
 
     if(verbose) printf("Successive symmetric differences on %zu bitmaps took %" PRIu64 " cycles\n", count,
-           cycles_final - cycles_start);
+           data[7]);
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(8)
+    total_count = 0;
     for (size_t i = 0; i < count; ++i) {
         vector & b = bitmaps[i];
         for(auto j = b.begin(); j != b.end() ; j++) {
             total_count++;
         }
     }
-    RDTSC_FINAL(cycles_final);
-    data[8] = cycles_final - cycles_start;
+    END_PHASE(8, data[8])
     assert(total_count == totalcard);
 
     if(verbose) printf("Iterating over %zu bitmaps took %" PRIu64 " cycles\n", count,
-           cycles_final - cycles_start);
+           data[8]);
 
     assert(successive_xor + successive_and == successive_or);
 
@@ -337,33 +399,33 @@ int main(int argc, char **argv) {
     uint64_t successive_andnotcard = 0;
     uint64_t successive_xorcard = 0;
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(9)
+    successive_andcard = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
       std::set_intersection(bitmaps[i].begin(), bitmaps[i].end(),bitmaps[i+1].begin(), bitmaps[i+1].end(),inserter(successive_andcard));
     }
-    RDTSC_FINAL(cycles_final);
-    data[9] = cycles_final - cycles_start;
+    END_PHASE(9, data[9])
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(10)
+    successive_orcard = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
       std::set_union(bitmaps[i].begin(), bitmaps[i].end(),bitmaps[i+1].begin(), bitmaps[i+1].end(),inserter(successive_orcard));
     }
-    RDTSC_FINAL(cycles_final);
-    data[10] = cycles_final - cycles_start;
+    END_PHASE(10, data[10])
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(11)
+    successive_andnotcard = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
       std::set_difference(bitmaps[i].begin(), bitmaps[i].end(),bitmaps[i+1].begin(), bitmaps[i+1].end(),inserter(successive_andnotcard));
     }
-    RDTSC_FINAL(cycles_final);
-    data[11] = cycles_final - cycles_start;
+    END_PHASE(11, data[11])
 
-    RDTSC_START(cycles_start);
+    BEGIN_PHASE(12)
+    successive_xorcard = 0;
     for (int i = 0; i < (int)count - 1; ++i) {
       std::set_symmetric_difference(bitmaps[i].begin(), bitmaps[i].end(),bitmaps[i+1].begin(), bitmaps[i+1].end(),inserter(successive_xorcard));
     }
-    RDTSC_FINAL(cycles_final);
-    data[12] = cycles_final - cycles_start;
+    END_PHASE(12, data[12])
 
     assert(successive_andcard == successive_and);
     assert(successive_orcard == successive_or);
@@ -374,21 +436,12 @@ int main(int argc, char **argv) {
     * end and, or, andnot and xor cardinality
     */
 
-    printf(" %20.2f %20.2f %20.2f %20.2f %20.2f %20.2f  %20.2f  %20.2f     %20.2f    %20.2f  %20.2f  %20.2f  %20.2f\n",
-      data[0]*8.0/totalcard,
-      data[1]*1.0/successivecard,
-      data[2]*1.0/successivecard,
-      data[3]*1.0/totalcard,
-      data[4]*1.0/totalcard,
-      data[5]*1.0/(3*count),
-      data[6]*1.0/successivecard,
-      data[7]*1.0/successivecard,
-      data[8]*1.0/totalcard,
-      data[9]*1.0/successivecard,
-      data[10]*1.0/successivecard,
-      data[11]*1.0/successivecard,
-      data[12]*1.0/successivecard
-    );
+    report_cardinalities(successive_and, successive_or, total_or, quartcount,
+                         successive_andnot, successive_xor, total_count);
+    benchmark_report(report_basename(argv[0]), dirname, data, 14, count,
+                     totalcard, successivecard);
+    perf_counters_print();
+    phase_stats_print();
 
     for (int i = 0; i < (int)count; ++i) {
         free(numbers[i]);
@@ -0,0 +1,656 @@
+#ifndef INCLUDE_STLBACKENDS_H
+#define INCLUDE_STLBACKENDS_H
+
+/*
+ * Backends over the standard library containers, as in
+ * stl_vector_benchmarks, simd_vector_benchmarks and stl_hashset_benchmarks.
+ */
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <queue>
+#include <unordered_set>
+#include <vector>
+
+#include "bitmapbackend.h"
+#include "sortedarrays.h"
+
+// credit http://stackoverflow.com/questions/37767585/count-elements-in-union-of-two-sets-using-stl
+template <typename T>
+class count_back_inserter {
+public:
+    uint64_t & count;
+    typedef void value_type;
+    typedef void difference_type;
+    typedef void pointer;
+    typedef void reference;
+    typedef std::output_iterator_tag iterator_category;
+    count_back_inserter(uint64_t & c) : count(c) {};
+    void operator=(const T &){ }
+    count_back_inserter &operator *(){ return *this; }
+    count_back_inserter &operator++(){ count++;return *this; }
+
+};
+
+// the first value of the sorted vector at least x (x <= 2^32)
+static inline std::vector<uint32_t>::const_iterator sorted_range_end(
+    const std::vector<uint32_t> &b, uint64_t x) {
+    if (x > UINT32_MAX) return b.end();
+    return std::lower_bound(b.begin(), b.end(), (uint32_t)x);
+}
+
+// the values in at least t of the n sorted vectors, in order: a heap of
+// cursors merges the vectors, and we count how many of them hold each value
+static inline void heap_threshold(const std::vector<uint32_t> *first, size_t n,
+                                  size_t t, std::vector<uint32_t> &out) {
+    typedef std::pair<uint32_t, size_t> cursor;  // value, vector
+    std::priority_queue<cursor, std::vector<cursor>, std::greater<cursor> > pq;
+    std::vector<size_t> position(n, 0);
+    for (size_t i = 0; i < n; i++) {
+        if (!first[i].empty()) pq.push(cursor(first[i][0], i));
+    }
+    while (!pq.empty()) {
+        const uint32_t value = pq.top().first;
+        size_t occurrences = 0;
+        while (!pq.empty() && (pq.top().first == value)) {
+            const size_t i = pq.top().second;
+            pq.pop();
+            occurrences++;
+            if (++position[i] < first[i].size()) pq.push(cursor(first[i][position[i]], i));
+        }
+        if (occurrences >= t) out.push_back(value);
+    }
+}
+
+struct stl_vector_backend {
+    typedef std::vector<uint32_t> bitmap;
+    typedef count_back_inserter<uint32_t> inserter;
+
+    static const char *name() { return "stl_vector"; }
+
+    static void build(bitmap &b, const uint32_t *values, size_t n) {
+        b.assign(values, values + n);
+    }
+
+    static void release(bitmap &b) { bitmap().swap(b); }
+
+    // what stl_vector_benchmarks_memtracked reports
+    static uint64_t size_in_bytes(const bitmap &b) {
+        return b.capacity() * sizeof(uint32_t);
+    }
+
+    static uint64_t and_op(const bitmap &a, const bitmap &b) {
+        bitmap v;
+        std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(v));
+        return v.size();
+    }
+
+    static uint64_t or_op(const bitmap &a, const bitmap &b) {
+        bitmap v;
+        std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(v));
+        return v.size();
+    }
+
+    static uint64_t andnot_op(const bitmap &a, const bitmap &b) {
+        bitmap v;
+        std::set_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(v));
+        return v.size();
+    }
+
+    static uint64_t xor_op(const bitmap &a, const bitmap &b) {
+        bitmap v;
+        std::set_symmetric_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(v));
+        return v.size();
+    }
+
+    static uint64_t and_count(const bitmap &a, const bitmap &b) {
+        uint64_t card = 0;
+        std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), inserter(card));
+        return card;
+    }
+
+    static uint64_t or_count(const bitmap &a, const bitmap &b) {
+        uint64_t card = 0;
+        std::set_union(a.begin(), a.end(), b.begin(), b.end(), inserter(card));
+        return card;
+    }
+
+    static uint64_t andnot_count(const bitmap &a, const bitmap &b) {
+        uint64_t card = 0;
+        std::set_difference(a.begin(), a.end(), b.begin(), b.end(), inserter(card));
+        return card;
+    }
+
+    static uint64_t xor_count(const bitmap &a, const bitmap &b) {
+        uint64_t card = 0;
+        std::set_symmetric_difference(a.begin(), a.end(), b.begin(), b.end(), inserter(card));
+        return card;
+    }
+
+    static uint64_t wide_or(const std::vector<bitmap> &all) {
+        if (all.size() < 2) return all.empty() ? 0 : all[0].size();
+        bitmap v;
+        std::set_union(all[0].begin(), all[0].end(), all[1].begin(), all[1].end(), std::back_inserter(v));
+        for (size_t i = 2; i < all.size(); ++i) {
+            bitmap newv;
+            std::set_union(v.begin(), v.end(), all[i].begin(), all[i].end(), std::back_inserter(newv));
+            v.swap(newv);
+        }
+        return v.size();
+    }
+
+    // merge the two smallest vectors first, as fast_logicalor does in
+    // stl_vector_benchmarks
+    static uint64_t wide_or_heap(const std::vector<bitmap> &all) {
+        struct vector_ptr {
+            const bitmap *ptr;
+            bool own;
+            bool operator<(const vector_ptr &o) const {
+                return o.ptr->size() < ptr->size(); // backward on purpose
+            }
+        };
+        if (all.size() < 2) return all.empty() ? 0 : all[0].size();
+        std::priority_queue<vector_ptr> pq;
+        for (size_t i = 0; i < all.size(); i++) {
+            vector_ptr p = {&all[i], false};
+            pq.push(p);
+        }
+        while (pq.size() > 1) {
+            vector_ptr x1 = pq.top();
+            pq.pop();
+            vector_ptr x2 = pq.top();
+            pq.pop();
+            bitmap *buffer = new bitmap();
+            std::set_union(x1.ptr->begin(), x1.ptr->end(), x2.ptr->begin(), x2.ptr->end(), std::back_inserter(*buffer));
+            if (x1.own) delete x1.ptr;
+            if (x2.own) delete x2.ptr;
+            vector_ptr p = {buffer, true};
+            pq.push(p);
+        }
+        vector_ptr x = pq.top();
+        uint64_t card = x.ptr->size();
+        delete x.ptr;
+        return card;
+    }
+
+    // the smallest vectors first, stopping once the intersection is empty
+    static uint64_t wide_and(const bitmap *first, size_t n) {
+        std::vector<const bitmap *> sorted(n);
+        for (size_t i = 0; i < n; ++i) sorted[i] = &first[i];
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const bitmap *x, const bitmap *y) { return x->size() < y->size(); });
+        bitmap v(*sorted[0]);
+        for (size_t i = 1; (i < n) && !v.empty(); ++i) {
+            bitmap newv;
+            std::set_intersection(v.begin(), v.end(), sorted[i]->begin(), sorted[i]->end(), std::back_inserter(newv));
+            v.swap(newv);
+        }
+        return v.size();
+    }
+
+    static uint64_t threshold(const bitmap *first, size_t n, size_t t) {
+        bitmap v;
+        heap_threshold(first, n, t, v);
+        return v.size();
+    }
+
+    static uint64_t range_count(const bitmap &b, uint64_t lo, uint64_t hi) {
+        return sorted_range_end(b, hi) - sorted_range_end(b, lo);
+    }
+
+    static bool range_intersects(const bitmap &b, uint64_t lo, uint64_t hi) {
+        bitmap::const_iterator j = sorted_range_end(b, lo);
+        return (j != b.end()) && (*j < hi);
+    }
+
+    static void range_values(const bitmap &b, uint64_t lo, uint64_t hi,
+                             std::vector<uint32_t> &out) {
+        out.insert(out.end(), sorted_range_end(b, lo), sorted_range_end(b, hi));
+    }
+
+    static uint64_t rank(const bitmap &b, uint32_t x) {
+        return std::upper_bound(b.begin(), b.end(), x) - b.begin();
+    }
+
+    static uint32_t select(const bitmap &b, uint64_t i) { return b[i]; }
+
+    static void add(bitmap &b, uint32_t value) {
+        bitmap::iterator j = std::lower_bound(b.begin(), b.end(), value);
+        if ((j == b.end()) || (*j != value)) b.insert(j, value);
+    }
+
+    static void remove(bitmap &b, uint32_t value) {
+        bitmap::iterator j = std::lower_bound(b.begin(), b.end(), value);
+        if ((j != b.end()) && (*j == value)) b.erase(j);
+    }
+
+    // sort the new values at the end, then merge them in
+    static void add_many(bitmap &b, const uint32_t *values, size_t n) {
+        const size_t old = b.size();
+        b.insert(b.end(), values, values + n);
+        std::sort(b.begin() + old, b.end());
+        std::inplace_merge(b.begin(), b.begin() + old, b.end());
+        b.erase(std::unique(b.begin(), b.end()), b.end());
+    }
+
+    static void optimize(bitmap &b) { b.shrink_to_fit(); }
+
+    static bool contains(const bitmap &b, uint32_t value) {
+        return std::binary_search(b.begin(), b.end(), value);
+    }
+
+    static uint64_t iterate(const bitmap &b) {
+        uint64_t card = 0;
+        for (auto j = b.begin(); j != b.end(); j++) {
+            card++;
+        }
+        return card;
+    }
+};
+
+REGISTER_BACKEND(stl_vector_backend)
+
+// the same vectors, with the operations of sortedarrays.h
+struct simd_vector_backend {
+    typedef std::vector<uint32_t> bitmap;
+    typedef size_t (*operation)(const uint32_t *, size_t, const uint32_t *,
+                                size_t, uint32_t *);
+
+    static const char *name() { return "simd_vector"; }
+
+    static void build(bitmap &b, const uint32_t *values, size_t n) {
+        b.assign(values, values + n);
+    }
+
+    static void release(bitmap &b) { bitmap().swap(b); }
+
+    static uint64_t size_in_bytes(const bitmap &b) {
+        return b.capacity() * sizeof(uint32_t);
+    }
+
+    // materialize the result in an output of the given capacity
+    static uint64_t materialize(operation op, const bitmap &a, const bitmap &b,
+                                size_t capacity) {
+        uint32_t *out = (uint32_t *)malloc((capacity + SORTED_ARRAY_SLACK) * sizeof(uint32_t));
+        uint64_t card = op(a.data(), a.size(), b.data(), b.size(), out);
+        free(out);
+        return card;
+    }
+
+    static uint64_t and_op(const bitmap &a, const bitmap &b) {
+        return materialize(sorted_intersect, a, b, std::min(a.size(), b.size()));
+    }
+
+    static uint64_t or_op(const bitmap &a, const bitmap &b) {
+        return materialize(sorted_union, a, b, a.size() + b.size());
+    }
+
+    static uint64_t andnot_op(const bitmap &a, const bitmap &b) {
+        return materialize(sorted_andnot, a, b, a.size());
+    }
+
+    static uint64_t xor_op(const bitmap &a, const bitmap &b) {
+        return materialize(sorted_xor, a, b, a.size() + b.size());
+    }
+
+    static uint64_t and_count(const bitmap &a, const bitmap &b) {
+        return sorted_intersect_count(a.data(), a.size(), b.data(), b.size());
+    }
+
+    static uint64_t or_count(const bitmap &a, const bitmap &b) {
+        return a.size() + b.size() - and_count(a, b);
+    }
+
+    static uint64_t andnot_count(const bitmap &a, const bitmap &b) {
+        return a.size() - and_count(a, b);
+    }
+
+    static uint64_t xor_count(const bitmap &a, const bitmap &b) {
+        return a.size() + b.size() - 2 * and_count(a, b);
+    }
+
+    static uint64_t wide_or(const std::vector<bitmap> &all) {
+        if (all.size() < 2) return all.empty() ? 0 : all[0].size();
+        size_t total = 0;
+        for (size_t i = 0; i < all.size(); ++i) total += all[i].size();
+        // two buffers large enough for any partial union, swapped as we go
+        uint32_t *v = (uint32_t *)malloc((total + SORTED_ARRAY_SLACK) * sizeof(uint32_t));
+        uint32_t *newv = (uint32_t *)malloc((total + SORTED_ARRAY_SLACK) * sizeof(uint32_t));
+        size_t size = sorted_union(all[0].data(), all[0].size(), all[1].data(), all[1].size(), v);
+        for (size_t i = 2; i < all.size(); ++i) {
+            size = sorted_union(v, size, all[i].data(), all[i].size(), newv);
+            std::swap(v, newv);
+        }
+        free(v);
+        free(newv);
+        return size;
+    }
+
+    // merge the two smallest arrays first
+    static uint64_t wide_or_heap(const std::vector<bitmap> &all) {
+        struct array_ptr {
+            const uint32_t *values;
+            size_t size;
+            uint32_t *own;  // to free, if not an input
+            bool operator<(const array_ptr &o) const {
+                return o.size < size; // backward on purpose
+            }
+        };
+        if (all.size() < 2) return all.empty() ? 0 : all[0].size();
+        std::priority_queue<array_ptr> pq;
+        for (size_t i = 0; i < all.size(); i++) {
+            array_ptr p = {all[i].data(), all[i].size(), NULL};
+            pq.push(p);
+        }
+        while (pq.size() > 1) {
+            array_ptr x1 = pq.top();
+            pq.pop();
+            array_ptr x2 = pq.top();
+            pq.pop();
+            uint32_t *buffer = (uint32_t *)malloc((x1.size + x2.size + SORTED_ARRAY_SLACK) * sizeof(uint32_t));
+            size_t size = sorted_union(x1.values, x1.size, x2.values, x2.size, buffer);
+            free(x1.own);
+            free(x2.own);
+            array_ptr p = {buffer, size, buffer};
+            pq.push(p);
+        }
+        array_ptr x = pq.top();
+        free(x.own);
+        return x.size;
+    }
+
+    // the smallest arrays first (so that sorted_intersect gallops through
+    // the larger ones), stopping once the intersection is empty
+    static uint64_t wide_and(const bitmap *first, size_t n) {
+        std::vector<const bitmap *> sorted(n);
+        for (size_t i = 0; i < n; ++i) sorted[i] = &first[i];
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const bitmap *x, const bitmap *y) { return x->size() < y->size(); });
+        if (n == 1) return sorted[0]->size();
+        // two buffers large enough for any partial intersection, swapped as we go
+        const size_t capacity = sorted[0]->size() + SORTED_ARRAY_SLACK;
+        uint32_t *v = (uint32_t *)malloc(capacity * sizeof(uint32_t));
+        uint32_t *newv = (uint32_t *)malloc(capacity * sizeof(uint32_t));
+        size_t size = sorted_intersect(sorted[0]->data(), sorted[0]->size(),
+                                       sorted[1]->data(), sorted[1]->size(), v);
+        for (size_t i = 2; (i < n) && (size > 0); ++i) {
+            size = sorted_intersect(v, size, sorted[i]->data(), sorted[i]->size(), newv);
+            std::swap(v, newv);
+        }
+        free(v);
+        free(newv);
+        return size;
+    }
+
+    static uint64_t threshold(const bitmap *first, size_t n, size_t t) {
+        bitmap v;
+        heap_threshold(first, n, t, v);
+        return v.size();
+    }
+
+    static uint64_t range_count(const bitmap &b, uint64_t lo, uint64_t hi) {
+        return sorted_range_end(b, hi) - sorted_range_end(b, lo);
+    }
+
+    static bool range_intersects(const bitmap &b, uint64_t lo, uint64_t hi) {
+        bitmap::const_iterator j = sorted_range_end(b, lo);
+        return (j != b.end()) && (*j < hi);
+    }
+
+    static void range_values(const bitmap &b, uint64_t lo, uint64_t hi,
+                             std::vector<uint32_t> &out) {
+        out.insert(out.end(), sorted_range_end(b, lo), sorted_range_end(b, hi));
+    }
+
+    static uint64_t rank(const bitmap &b, uint32_t x) {
+        return std::upper_bound(b.begin(), b.end(), x) - b.begin();
+    }
+
+    static uint32_t select(const bitmap &b, uint64_t i) { return b[i]; }
+
+    static void add(bitmap &b, uint32_t value) { stl_vector_backend::add(b, value); }
+
+    static void remove(bitmap &b, uint32_t value) { stl_vector_backend::remove(b, value); }
+
+    static void add_many(bitmap &b, const uint32_t *values, size_t n) {
+        stl_vector_backend::add_many(b, values, n);
+    }
+
+    static void optimize(bitmap &b) { b.shrink_to_fit(); }
+
+    static bool contains(const bitmap &b, uint32_t value) {
+        return sorted_contains(b.data(), b.size(), value);
+    }
+
+    static uint64_t iterate(const bitmap &b) {
+        uint64_t card = 0;
+        for (auto j = b.begin(); j != b.end(); j++) {
+            card++;
+        }
+        return card;
+    }
+};
+
+REGISTER_BACKEND(simd_vector_backend)
+
+struct stl_hashset_backend {
+    typedef std::unordered_set<uint32_t> bitmap;
+
+    static const char *name() { return "stl_hashset"; }
+
+    static void build(bitmap &b, const uint32_t *values, size_t n) {
+        b.reserve(n);
+        for (size_t j = 0; j < n; ++j) {
+            b.insert(values[j]);
+        }
+        b.rehash(n);
+    }
+
+    static void release(bitmap &b) { bitmap().swap(b); }
+
+    // An estimate for libstdc++: one pointer per bucket and, per value, a
+    // node holding the next pointer and the value. This is what
+    // stl_hashset_benchmarks_memtracked reports, up to allocator rounding.
+    static uint64_t size_in_bytes(const bitmap &b) {
+        return b.bucket_count() * sizeof(void *) +
+               b.size() * (sizeof(void *) + sizeof(void *));
+    }
+
+    static uint64_t and_count(const bitmap &a, const bitmap &b) {
+        if (a.size() > b.size()) return and_count(b, a);
+        uint64_t card = 0;
+        for (bitmap::const_iterator i = a.begin(); i != a.end(); i++) {
+            if (b.find(*i) != b.end()) ++card;
+        }
+        return card;
+    }
+
+    static uint64_t or_count(const bitmap &a, const bitmap &b) {
+        return a.size() + b.size() - and_count(a, b);
+    }
+
+    static uint64_t andnot_count(const bitmap &a, const bitmap &b) {
+        uint64_t card = 0;
+        for (bitmap::const_iterator i = a.begin(); i != a.end(); i++) {
+            if (b.find(*i) == b.end()) card++;
+        }
+        return card;
+    }
+
+    static uint64_t xor_count(const bitmap &a, const bitmap &b) {
+        return a.size() + b.size() - 2 * and_count(a, b);
+    }
+
+    static uint64_t and_op(const bitmap &a, const bitmap &b) {
+        if (a.size() > b.size()) return and_op(b, a);
+        bitmap v;
+        for (bitmap::const_iterator i = a.begin(); i != a.end(); i++) {
+            if (b.find(*i) != b.end()) v.insert(*i);
+        }
+        return v.size();
+    }
+
+    static uint64_t or_op(const bitmap &a, const bitmap &b) {
+        bitmap v(a);
+        v.insert(b.begin(), b.end());
+        return v.size();
+    }
+
+    static uint64_t andnot_op(const bitmap &a, const bitmap &b) {
+        bitmap v;
+        for (bitmap::const_iterator i = a.begin(); i != a.end(); i++) {
+            if (b.find(*i) == b.end()) v.insert(*i);
+        }
+        return v.size();
+    }
+
+    static uint64_t xor_op(const bitmap &a, const bitmap &b) {
+        bitmap v(a.begin(), a.end());
+        for (bitmap::const_iterator i = b.begin(); i != b.end(); i++) {
+            auto x = v.find(*i);
+            if (x == v.end())
+                v.insert(*i);
+            else
+                v.erase(x);
+        }
+        return v.size();
+    }
+
+    static uint64_t wide_or(const std::vector<bitmap> &all) {
+        if (all.empty()) return 0;
+        bitmap v(all[0]);
+        for (size_t i = 1; i < all.size(); ++i) {
+            v.insert(all[i].begin(), all[i].end());
+        }
+        return v.size();
+    }
+
+    // union in increasing order of size, as stl_hashset_benchmarks does
+    static uint64_t wide_or_heap(const std::vector<bitmap> &all) {
+        if (all.empty()) return 0;
+        std::vector<const bitmap *> sorted(all.size());
+        for (size_t i = 0; i < all.size(); ++i) sorted[i] = &all[i];
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const bitmap *x, const bitmap *y) { return x->size() < y->size(); });
+        bitmap v(*sorted[0]);
+        for (size_t i = 1; i < sorted.size(); ++i) {
+            v.insert(sorted[i]->begin(), sorted[i]->end());
+        }
+        return v.size();
+    }
+
+    // probe the others with the values of the smallest set, the smaller
+    // sets first since they reject the most
+    static uint64_t wide_and(const bitmap *first, size_t n) {
+        std::vector<const bitmap *> sorted(n);
+        for (size_t i = 0; i < n; ++i) sorted[i] = &first[i];
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const bitmap *x, const bitmap *y) { return x->size() < y->size(); });
+        bitmap v;
+        for (bitmap::const_iterator j = sorted[0]->begin(); j != sorted[0]->end(); j++) {
+            size_t i = 1;
+            while ((i < n) && (sorted[i]->find(*j) != sorted[i]->end())) i++;
+            if (i == n) v.insert(*j);
+        }
+        return v.size();
+    }
+
+    // a value in at least t of the n sets is in one of the first n - t + 1:
+    // probe the following sets with the values of each of these that none
+    // of the preceding sets holds
+    static uint64_t threshold(const bitmap *first, size_t n, size_t t) {
+        bitmap v;
+        for (size_t i = 0; i + t <= n; ++i) {
+            for (bitmap::const_iterator j = first[i].begin(); j != first[i].end(); j++) {
+                size_t k = 0;
+                while ((k < i) && (first[k].find(*j) == first[k].end())) k++;
+                if (k < i) continue;
+                size_t occurrences = 1;
+                for (k = i + 1; (k < n) && (occurrences < t); ++k) {
+                    if (first[k].find(*j) != first[k].end()) occurrences++;
+                }
+                if (occurrences >= t) v.insert(*j);
+            }
+        }
+        return v.size();
+    }
+
+    // probe the values of short ranges, scan the whole set for long ones
+    static uint64_t range_count(const bitmap &b, uint64_t lo, uint64_t hi) {
+        uint64_t card = 0;
+        if (hi - lo <= b.size()) {
+            for (uint64_t x = lo; x < hi; ++x) card += (b.find((uint32_t)x) != b.end());
+        } else {
+            for (auto j = b.begin(); j != b.end(); j++) card += (*j >= lo) && (*j < hi);
+        }
+        return card;
+    }
+
+    static bool range_intersects(const bitmap &b, uint64_t lo, uint64_t hi) {
+        if (hi - lo <= b.size()) {
+            for (uint64_t x = lo; x < hi; ++x) {
+                if (b.find((uint32_t)x) != b.end()) return true;
+            }
+        } else {
+            for (auto j = b.begin(); j != b.end(); j++) {
+                if ((*j >= lo) && (*j < hi)) return true;
+            }
+        }
+        return false;
+    }
+
+    // in no particular order
+    static void range_values(const bitmap &b, uint64_t lo, uint64_t hi,
+                             std::vector<uint32_t> &out) {
+        if (hi - lo <= b.size()) {
+            for (uint64_t x = lo; x < hi; ++x) {
+                if (b.find((uint32_t)x) != b.end()) out.push_back((uint32_t)x);
+            }
+        } else {
+            for (auto j = b.begin(); j != b.end(); j++) {
+                if ((*j >= lo) && (*j < hi)) out.push_back(*j);
+            }
+        }
+    }
+
+    // no order: count the smaller values, or partially sort a copy
+    static uint64_t rank(const bitmap &b, uint32_t x) {
+        uint64_t card = 0;
+        for (auto j = b.begin(); j != b.end(); j++) card += (*j <= x);
+        return card;
+    }
+
+    static uint32_t select(const bitmap &b, uint64_t i) {
+        std::vector<uint32_t> values(b.begin(), b.end());
+        std::nth_element(values.begin(), values.begin() + i, values.end());
+        return values[i];
+    }
+
+    static void add(bitmap &b, uint32_t value) { b.insert(value); }
+
+    static void remove(bitmap &b, uint32_t value) { b.erase(value); }
+
+    static void add_many(bitmap &b, const uint32_t *values, size_t n) {
+        b.insert(values, values + n);
+    }
+
+    // fewest buckets for the load factor
+    static void optimize(bitmap &b) { b.rehash(0); }
+
+    static bool contains(const bitmap &b, uint32_t value) {
+        return b.find(value) != b.end();
+    }
+
+    static uint64_t iterate(const bitmap &b) {
+        uint64_t card = 0;
+        for (auto j = b.begin(); j != b.end(); j++) {
+            card++;
+        }
+        return card;
+    }
+};
+
+REGISTER_BACKEND(stl_hashset_backend)
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef INCLUDE_THREADPOOL_H
+#define INCLUDE_THREADPOOL_H
+
+/*
+ * A fixed set of threads for the parallel phases of unified_benchmarks.
+ * The threads are created once, outside of any timed region, and wait on a
+ * barrier; run() releases them on a job and times it, with the time stamp
+ * counter, from the common start to the moment the last thread is done.
+ * The calling thread takes part in every job as thread 0.
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <vector>
+
+extern "C" {
+#include "benchmark.h"
+}
+
+class benchmark_thread_pool {
+public:
+    explicit benchmark_thread_pool(int threads)
+        : threadcount(threads < 1 ? 1 : threads), job(NULL), jobcontext(NULL),
+          stopping(false), workers(threadcount - 1), arguments(threadcount - 1) {
+        pthread_barrier_init(&start, NULL, threadcount);
+        pthread_barrier_init(&finish, NULL, threadcount);
+        for (int t = 1; t < threadcount; t++) {
+            arguments[t - 1].pool = this;
+            arguments[t - 1].index = t;
+            pthread_create(&workers[t - 1], NULL, worker, &arguments[t - 1]);
+        }
+    }
+
+    ~benchmark_thread_pool() {
+        stopping = true;
+        pthread_barrier_wait(&start);
+        for (int t = 1; t < threadcount; t++) pthread_join(workers[t - 1], NULL);
+        pthread_barrier_destroy(&start);
+        pthread_barrier_destroy(&finish);
+    }
+
+    int size() const { return threadcount; }
+
+    /*
+     * Call f(thread_index) on every thread and return the elapsed cycles.
+     */
+    template <class F>
+    uint64_t run(F &f) {
+        uint64_t cycles_start = 0, cycles_final = 0;
+        job = &call<F>;
+        jobcontext = &f;
+        RDTSC_START(cycles_start);
+        pthread_barrier_wait(&start);
+        f(0);
+        pthread_barrier_wait(&finish);
+        RDTSC_FINAL(cycles_final);
+        return cycles_final - cycles_start;
+    }
+
+private:
+    struct worker_argument {
+        benchmark_thread_pool *pool;
+        int index;
+    };
+
+    template <class F>
+    static void call(void *context, int index) {
+        (*(F *)context)(index);
+    }
+
+    static void *worker(void *arg) {
+        worker_argument *wa = (worker_argument *)arg;
+        benchmark_thread_pool *pool = wa->pool;
+        while (true) {
+            pthread_barrier_wait(&pool->start);
+            if (pool->stopping) break;
+            pool->job(pool->jobcontext, wa->index);
+            pthread_barrier_wait(&pool->finish);
+        }
+        return NULL;
+    }
+
+    benchmark_thread_pool(const benchmark_thread_pool &);
+    benchmark_thread_pool &operator=(const benchmark_thread_pool &);
+
+    const int threadcount;
+    void (*job)(void *, int);
+    void *jobcontext;
+    bool stopping;
+    pthread_barrier_t start;
+    pthread_barrier_t finish;
+    std::vector<pthread_t> workers;
+    std::vector<worker_argument> arguments;
+};
+
+#endif
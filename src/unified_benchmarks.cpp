@@ -0,0 +1,193 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#define __STDC_FORMAT_MACROS 1
+#include <inttypes.h>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "benchmark.h"
+#include "numbersfromtextfiles.h"
+#ifdef __cplusplus
+}
+#endif
+
+#include "bitmapbackend.h"
+
+/*
+ * Each backend can be left out with -DWITHOUT_<LIBRARY>, e.g. when the
+ * corresponding submodule is not checked out: the UNIFIED_WITHOUT variable
+ * of the Makefile sets these flags and drops the objects of the libraries.
+ */
+#ifndef WITHOUT_BITSET
+#include "bitsetbackend.h"
+#endif
+#include "stlbackends.h"
+#include "eliasfanobackend.h"
+#include "flathashsetbackend.h"
+#ifndef WITHOUT_BITMAGIC
+#include "bitmagicbackend.h"
+#endif
+#ifndef WITHOUT_ROARING
+#include "roaringbackend.h"
+#endif
+#ifndef WITHOUT_EWAH
+#include "ewahbackend.h"
+#endif
+#ifndef WITHOUT_CONCISE
+#include "concisebackend.h"
+#endif
+
+static void printusage(char *command) {
+    printf(
+        " Try %s directory \n where directory could be "
+        "benchmarks/realdata/census1881\n",
+        command);
+    ;
+    printf("the -v flag turns on verbose mode\n");
+    printf("the -b flag reads the data from a binary cache next to the directory, creating it if needed\n");
+    printf("the -j flag sets the number of threads parsing the data files (0: one per processor)\n");
+    printf("the -p flag records hardware performance counters for each phase\n");
+    printf("the -n flag followed by a number repeats each phase that many times and reports statistics\n");
+    printf("the -w flag followed by a number runs each phase that many times before measuring it\n");
+    printf("the -o flag followed by text, json or csv sets the output format\n");
+    printf("the -t flag followed by a number also times the successive operations on up to that many threads\n");
+    printf("the -k flag followed by a number (at least 2) also times the intersections of that many successive bitmaps, and of all bitmaps\n");
+    printf("the -T flag followed by a number N (at least 3) also times, over N successive bitmaps, the values in at least 2, N/2 and N-1 of them\n");
+    printf("the -R flag followed by a number also times that many random range queries (counts, tests and extraction)\n");
+    printf("the -q flag followed by a number also times that many random rank and select queries\n");
+    printf("the -u flag followed by a number also times batches of that many inserts and removals on each bitmap (last, as it modifies them)\n");
+    printf("the -a flag followed by a comma-separated list of backends selects them (default: all)\n");
+    printf("the -l flag lists the backends\n");
+
+}
+
+int main(int argc, char **argv) {
+    int c;
+    const char *extension = ".txt";
+    bool verbose = false;
+    char *backendlist = NULL;
+    uint64_t data[14];
+    while ((c = getopt(argc, argv, "bj:pn:w:o:t:k:T:R:q:u:a:lve:h")) != -1) switch (c) {
+        case 'e':
+            extension = optarg;
+            break;
+        case 'b':
+            use_binary_cache = true;
+            break;
+        case 'j':
+            loader_threads = atoi(optarg);
+            break;
+        case 'p':
+            perf_counters_enabled = perf_counters_init();
+            break;
+        case 'n':
+            benchmark_repetitions = atoi(optarg);
+            if (benchmark_repetitions < 1) benchmark_repetitions = 1;
+            break;
+        case 'w':
+            benchmark_warmups = atoi(optarg);
+            if (benchmark_warmups < 0) benchmark_warmups = 0;
+            break;
+        case 'o':
+            if (!report_set_format(optarg)) {
+                printf("Unknown output format %s (text, json or csv).\n", optarg);
+                return -1;
+            }
+            break;
+        case 't':
+            benchmark_threads = atoi(optarg);
+            break;
+        case 'k':
+            wide_and_window = atoi(optarg);
+            break;
+        case 'T':
+            threshold_window = atoi(optarg);
+            break;
+        case 'R':
+            range_queries = atoi(optarg);
+            break;
+        case 'q':
+            rank_select_queries = atoi(optarg);
+            break;
+        case 'u':
+            mutation_batch = atoi(optarg);
+            break;
+        case 'a':
+            backendlist = optarg;
+            break;
+        case 'l':
+            for (size_t i = 0; i < backend_registry().size(); i++) {
+                printf("%s\n", backend_registry()[i].name);
+            }
+            return 0;
+        case 'v':
+            verbose = true;
+            break;
+        case 'h':
+            printusage(argv[0]);
+            return 0;
+        default:
+            abort();
+        }
+    if (optind >= argc) {
+        printusage(argv[0]);
+        return -1;
+    }
+    char *dirname = argv[optind];
+    report_record_flags(argc, argv, optind);
+
+    std::vector<const registered_backend *> backends;
+    if (backendlist == NULL) {
+        for (size_t i = 0; i < backend_registry().size(); i++) {
+            backends.push_back(&backend_registry()[i]);
+        }
+    } else {
+        for (char *name = strtok(backendlist, ","); name != NULL;
+             name = strtok(NULL, ",")) {
+            const registered_backend *rb = find_backend(name);
+            if (rb == NULL) {
+                printf("Unknown backend %s (try -l).\n", name);
+                return -1;
+            }
+            backends.push_back(rb);
+        }
+    }
+
+    size_t count;
+    size_t *howmany = NULL;
+    uint32_t **numbers =
+        read_all_integer_files(dirname, extension, &howmany, &count);
+    if (numbers == NULL) {
+        printf(
+            "I could not find or load any data file with extension %s in "
+            "directory %s.\n",
+            extension, dirname);
+        return -1;
+    }
+    if(verbose) printf("Loaded %d bitmaps from directory %s \n", (int)count, dirname);
+    const benchmark_dataset ds = make_benchmark_dataset(numbers, howmany, count);
+
+    for (size_t b = 0; b < backends.size(); b++) {
+        if (report_format == REPORT_TEXT) printf("# %s\n", backends[b]->name);
+        backends[b]->run(ds, verbose, data);
+        benchmark_report(backends[b]->name, dirname, data, 14, ds.count,
+                         ds.totalcard, ds.successivecard);
+        perf_counters_print();
+        phase_stats_print();
+        parallel_results_print();
+    }
+
+    for (int i = 0; i < (int)count; ++i) {
+        free(numbers[i]);
+        numbers[i] = NULL;  // paranoid
+    }
+    free(howmany);
+    free(numbers);
+
+    return 0;
+}
@@ -11,15 +11,17 @@
 
 #include "anh_moffat_clustered.h"
 void printusage(const char *command) {
-  printf(" %s -N number -M maxval \n", command);
+  printf(" %s -N number -M maxval [-H ranges]\n", command);
+  printf("the -H flag spreads the values over that many ranges of the high 32 bits, for 64-bit benchmarks\n");
 }
 int main(int argc, char ** argv) {
 
   int c;
   uint32_t N = 0;
   uint32_t M = 0;
+  uint32_t H = 0;
 
-  while ((c = getopt(argc, argv, "hN:M:")) != -1)
+  while ((c = getopt(argc, argv, "hN:M:H:")) != -1)
     switch (c) {
     case 'h':
       printusage(argv[0]);
@@ -30,6 +32,9 @@ int main(int argc, char ** argv) {
     case 'M':
       M = atoi(optarg);
       break;
+    case 'H':
+      H = atoi(optarg);
+      break;
     default:
       abort();
     }
@@ -47,7 +52,16 @@ int main(int argc, char ** argv) {
 
   vector<uint32_t> v = cdg.generate(N, M);
   for(size_t i = 0; i < v.size(); i++) {
-    std::cout << v[i];
+    if(H > 0) {
+      // cut [0, M) into H ranges and move range k to k * 2^30 / H in the
+      // high 32 bits: the order, and the values shared by two files, are
+      // kept, and the values stay below 2^62 so that the quartile queries
+      // (3 * maxvalue / 4) do not overflow
+      uint64_t range = (uint64_t)v[i] * H / M;
+      std::cout << ((range * ((UINT64_C(1) << 30) / H)) << 32 | v[i]);
+    } else {
+      std::cout << v[i];
+    }
     if(i + 1 < v.size()) std::cout<<",";
     std::cout.flush();
   }